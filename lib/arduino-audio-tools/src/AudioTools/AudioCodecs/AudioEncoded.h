@@ -331,6 +331,8 @@ class EncodedAudioStream : public ReformatBaseStream {
   bool begin() override {
     // is_output_notify = false;
     setupReader();
+    // avoid allocations in readBytes()
+    if (getStream() != nullptr) reader.preallocate(DEFAULT_BUFFER_SIZE);
     ReformatBaseStream::begin();
     return enc_out.begin(audioInfo());
   }
@@ -0,0 +1,445 @@
+#pragma once
+#include "AudioTools/AudioCodecs/HeaderParserMP3.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/Disk/AudioSource.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Result of a AudioSeekTable lookup
+ * @ingroup codecs
+ */
+struct SeekPosition {
+  /// file position from which we continue to read
+  uint64_t offset = 0;
+  /// number of decoded samples (per channel) that need to be dropped
+  uint64_t skip = 0;
+};
+
+/**
+ * @brief Determines the file position for a sample using the native structure
+ * of the format:
+ * - WAV: the position is calculated from the start of the data chunk
+ * - MP3: we build a sparse frame index with the help of the frame headers. The
+ *   index is built lazily: it is only extended up to the requested position.
+ *   The headers are read via a buffer, so that we do not need a file access
+ *   for each frame. We start some frames before the requested frame, so that
+ *   the decoder can fill its bit reservoir.
+ * - FLAC: we use the SEEKTABLE metadata block
+ *
+ * After a decoder reset the header() needs to be written to the decoder
+ * before the data starting from the offset. The table holds the information
+ * of one file: use an AudioSeekTableCache to keep the tables of several
+ * files. The file is accessed via AudioSource::seek(), which moves the read
+ * position: the caller needs to restore it with AudioSource::position() if
+ * the lookup fails.
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioSeekTable {
+ public:
+  enum Format { Unknown, WAV, MP3, FLAC };
+
+  AudioSeekTable() = default;
+
+  /// Parses the file header: returns false if the format is not supported
+  bool begin(AudioSource &source, Stream &stream) {
+    TRACED();
+    end();
+    setInput(source, stream);
+    uint8_t data[12];
+    if (readAt(0, data, 12) != 12) return false;
+    if (memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0) {
+      format = setupWAV() ? WAV : Unknown;
+    } else if (memcmp(data, "fLaC", 4) == 0) {
+      format = setupFLAC() ? FLAC : Unknown;
+    } else {
+      format = setupMP3(data) ? MP3 : Unknown;
+    }
+    LOGI("seek table format: %d, sample rate: %d", format, sample_rate);
+    return format != Unknown;
+  }
+
+  /// Releases the index
+  void end() {
+    format = Unknown;
+    sample_rate = 0;
+    header_data.resize(0);
+    frame_pos.resize(0);
+    flac_points.resize(0);
+    read_buffer.resize(0);
+    read_buffer_len = 0;
+  }
+
+  /// Defines the source and stream of the file: a cached table needs to be
+  /// updated when the file was opened again
+  void setInput(AudioSource &source, Stream &stream) {
+    p_source = &source;
+    p_stream = &stream;
+  }
+
+  /// Returns true if the table can be used
+  bool isValid() { return format != Unknown; }
+
+  operator bool() { return isValid(); }
+
+  Format getFormat() { return format; }
+
+  /// Sample rate of the file
+  int sampleRate() { return sample_rate; }
+
+  /// Converts a time in milliseconds to the sample number
+  uint64_t timeToSample(uint32_t ms) {
+    return (uint64_t)ms * sample_rate / 1000;
+  }
+
+  /// Data which needs to be written to the decoder after a reset
+  const uint8_t *header() { return header_data.data(); }
+
+  /// Size of the header() in bytes: 0 if the decoder does not need a header
+  int headerSize() { return header_data.size(); }
+
+  /// Determines the file position for the indicated sample (per channel)
+  bool find(uint64_t sample, SeekPosition &result) {
+    switch (format) {
+      case WAV:
+        return findWAV(sample, result);
+      case MP3:
+        return findMP3(sample, result);
+      case FLAC:
+        return findFLAC(sample, result);
+      default:
+        return false;
+    }
+  }
+
+  /// Number of mp3 frames between two index entries (default 32)
+  void setIndexInterval(int frames) { index_interval = frames; }
+
+  /// Number of mp3 frames which are decoded before the requested frame
+  /// (default 4)
+  void setPrerollFrames(int frames) { preroll_frames = frames; }
+
+  /// Size of the buffer which is used to read the mp3 frame headers (default
+  /// 2048)
+  void setReadBufferSize(int bytes) { read_buffer_size = bytes; }
+
+ protected:
+  struct FlacSeekPoint {
+    uint64_t sample;
+    uint64_t offset;
+  };
+  AudioSource *p_source = nullptr;
+  Stream *p_stream = nullptr;
+  Format format = Unknown;
+  int sample_rate = 0;
+  Vector<uint8_t> header_data{0};
+  // wav
+  uint64_t data_offset = 0;
+  uint64_t data_size = 0;
+  int block_align = 0;
+  // mp3: position of every index_interval frame
+  Vector<uint32_t> frame_pos{0};
+  int index_interval = 32;
+  int preroll_frames = 4;
+  int samples_per_frame = 0;
+  uint32_t scan_frame = 0;  // next frame which is not indexed yet
+  uint32_t scan_pos = 0;
+  bool is_scan_complete = false;
+  // buffered access to the mp3 frame headers
+  Vector<uint8_t> read_buffer{0};
+  int read_buffer_size = 2048;
+  uint32_t read_buffer_pos = 0;
+  int read_buffer_len = 0;
+  // flac
+  Vector<FlacSeekPoint> flac_points{0};
+  uint64_t first_frame = 0;
+
+  size_t readAt(uint64_t pos, uint8_t *data, size_t len) {
+    if (!p_source->seek(pos)) return 0;
+    return p_stream->readBytes(data, len);
+  }
+
+  /// Reads the 4 byte mp3 frame header at the indicated position: the data is
+  /// provided from the read buffer, which is only refilled if necessary
+  bool readFrameHeader(uint32_t pos, HeaderParserMP3::FrameInfo &info) {
+    if (pos < read_buffer_pos || pos + 4 > read_buffer_pos + read_buffer_len) {
+      if (read_buffer.size() < read_buffer_size)
+        read_buffer.resize(read_buffer_size);
+      read_buffer_pos = pos;
+      read_buffer_len = readAt(pos, read_buffer.data(), read_buffer_size);
+      if (read_buffer_len < 4) return false;
+    }
+    return HeaderParserMP3::readFrameInfo(
+        read_buffer.data() + (pos - read_buffer_pos), info);
+  }
+
+  static uint32_t readLE32(const uint8_t *data) {
+    return (uint32_t)data[3] << 24 | (uint32_t)data[2] << 16 |
+           (uint32_t)data[1] << 8 | data[0];
+  }
+
+  static uint64_t readBE(const uint8_t *data, int bytes) {
+    uint64_t result = 0;
+    for (int j = 0; j < bytes; j++) result = result << 8 | data[j];
+    return result;
+  }
+
+  static void writeLE32(uint8_t *data, uint32_t value) {
+    for (int j = 0; j < 4; j++) data[j] = value >> (8 * j);
+  }
+
+  /// Finds the fmt and data chunk and creates a minimal header for the decoder
+  bool setupWAV() {
+    uint64_t pos = 12;
+    uint8_t chunk[8];
+    uint8_t fmt[40];
+    int fmt_len = 0;
+    while (readAt(pos, chunk, 8) == 8) {
+      uint32_t len = readLE32(chunk + 4);
+      if (memcmp(chunk, "fmt ", 4) == 0) {
+        fmt_len = min((int)len, (int)sizeof(fmt));
+        if (fmt_len < 16 || readAt(pos + 8, fmt, fmt_len) != fmt_len)
+          return false;
+        sample_rate = readLE32(fmt + 4);
+        block_align = fmt[12] | fmt[13] << 8;
+      } else if (memcmp(chunk, "data", 4) == 0) {
+        if (fmt_len == 0 || block_align == 0) return false;
+        data_offset = pos + 8;
+        data_size = len;
+        // RIFF, fmt and data chunk header
+        header_data.resize(12 + 8 + fmt_len + 8);
+        uint8_t *hdr = header_data.data();
+        memcpy(hdr, "RIFF", 4);
+        writeLE32(hdr + 4, header_data.size() - 8 + len);
+        memcpy(hdr + 8, "WAVE", 4);
+        memcpy(hdr + 12, "fmt ", 4);
+        writeLE32(hdr + 16, fmt_len);
+        memcpy(hdr + 20, fmt, fmt_len);
+        memcpy(hdr + 20 + fmt_len, "data", 4);
+        writeLE32(hdr + 24 + fmt_len, len);
+        return true;
+      }
+      pos += 8 + len + (len & 1);
+    }
+    return false;
+  }
+
+  bool findWAV(uint64_t sample, SeekPosition &result) {
+    uint64_t pos = sample * block_align;
+    if (pos >= data_size) return false;
+    // the decoder expects the remaining size in the data chunk
+    writeLE32(header_data.data() + header_data.size() - 4, data_size - pos);
+    result.offset = data_offset + pos;
+    result.skip = 0;
+    return true;
+  }
+
+  /// Finds the first frame after the ID3 tag
+  bool setupMP3(const uint8_t *start) {
+    uint32_t pos = 0;
+    if (memcmp(start, "ID3", 3) == 0) {
+      pos = 10 + ((start[6] & 0x7F) << 21 | (start[7] & 0x7F) << 14 |
+                  (start[8] & 0x7F) << 7 | (start[9] & 0x7F));
+      if (start[5] & 0x10) pos += 10;
+    }
+    // find 2 consecutive frames to avoid false syncs
+    uint8_t data[512];
+    HeaderParserMP3::FrameInfo info, next;
+    for (int block = 0; block < 8; block++) {
+      int len = readAt(pos, data, sizeof(data));
+      if (len < 4) return false;
+      for (int j = 0; j < len - 3; j++) {
+        if (!HeaderParserMP3::readFrameInfo(data + j, info)) continue;
+        uint8_t hdr[4];
+        uint32_t frame = pos + j;
+        if (readAt(frame + info.frame_length, hdr, 4) == 4 &&
+            HeaderParserMP3::readFrameInfo(hdr, next) &&
+            next.sample_rate == info.sample_rate) {
+          sample_rate = info.sample_rate;
+          samples_per_frame = info.samples_per_frame;
+          scan_frame = 0;
+          scan_pos = frame;
+          is_scan_complete = false;
+          return true;
+        }
+      }
+      pos += len - 3;
+    }
+    return false;
+  }
+
+  /// Reads the frame headers until we have indexed the indicated frame
+  bool extendIndex(uint32_t frame) {
+    HeaderParserMP3::FrameInfo info;
+    while (scan_frame <= frame && !is_scan_complete) {
+      if (!readFrameHeader(scan_pos, info)) {
+        LOGI("mp3 index complete with %u frames", (unsigned)scan_frame);
+        is_scan_complete = true;
+        break;
+      }
+      if (scan_frame % index_interval == 0) frame_pos.push_back(scan_pos);
+      scan_pos += info.frame_length;
+      scan_frame++;
+    }
+    return frame < scan_frame;
+  }
+
+  /// Determines the position of the frame from the nearest index entry
+  bool framePosition(uint32_t frame, uint32_t &pos) {
+    if (!extendIndex(frame)) return false;
+    pos = frame_pos[frame / index_interval];
+    HeaderParserMP3::FrameInfo info;
+    for (uint32_t j = 0; j < frame % index_interval; j++) {
+      if (!readFrameHeader(pos, info)) return false;
+      pos += info.frame_length;
+    }
+    return true;
+  }
+
+  bool findMP3(uint64_t sample, SeekPosition &result) {
+    uint32_t frame = sample / samples_per_frame;
+    uint32_t start = frame > preroll_frames ? frame - preroll_frames : 0;
+    uint32_t pos = 0;
+    if (!extendIndex(frame) || !framePosition(start, pos)) return false;
+    result.offset = pos;
+    result.skip = sample - (uint64_t)start * samples_per_frame;
+    return true;
+  }
+
+  /// Reads the STREAMINFO and SEEKTABLE metadata blocks
+  bool setupFLAC() {
+    uint64_t pos = 4;
+    uint8_t block[4];
+    uint8_t info[34];
+    bool is_last = false;
+    bool has_info = false;
+    while (!is_last && readAt(pos, block, 4) == 4) {
+      is_last = block[0] & 0x80;
+      int type = block[0] & 0x7F;
+      uint32_t len = readBE(block + 1, 3);
+      if (type == 0 && len == 34) {
+        if (readAt(pos + 4, info, 34) != 34) return false;
+        sample_rate = readBE(info + 10, 3) >> 4;
+        has_info = true;
+      } else if (type == 3) {
+        uint8_t point[18];
+        for (uint32_t j = 0; j < len / 18; j++) {
+          if (readAt(pos + 4 + j * 18, point, 18) != 18) return false;
+          uint64_t sample = readBE(point, 8);
+          // skip placeholder points
+          if (sample == 0xFFFFFFFFFFFFFFFFULL) continue;
+          flac_points.push_back({sample, readBE(point + 8, 8)});
+        }
+      }
+      pos += 4 + len;
+    }
+    if (!has_info) return false;
+    first_frame = pos;
+    // the decoder only needs the STREAMINFO
+    header_data.resize(4 + 4 + 34);
+    uint8_t *hdr = header_data.data();
+    memcpy(hdr, "fLaC", 4);
+    uint8_t streaminfo_header[4] = {0x80, 0, 0, 34};
+    memcpy(hdr + 4, streaminfo_header, 4);
+    memcpy(hdr + 8, info, 34);
+    if (flac_points.size() == 0) LOGW("No FLAC SEEKTABLE: seeking not supported");
+    return flac_points.size() > 0;
+  }
+
+  bool findFLAC(uint64_t sample, SeekPosition &result) {
+    int found = -1;
+    for (int j = 0; j < flac_points.size(); j++) {
+      if (flac_points[j].sample > sample) break;
+      found = j;
+    }
+    if (found < 0) return false;
+    result.offset = first_frame + flac_points[found].offset;
+    result.skip = sample - flac_points[found].sample;
+    return true;
+  }
+};
+
+/**
+ * @brief Keeps the AudioSeekTable of the last files (default 4), so that
+ * switching between files does not need to rebuild the index. The tables are
+ * identified by the file name: when the cache is full, the least recently
+ * used table is replaced.
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioSeekTableCache {
+ public:
+  AudioSeekTableCache() = default;
+
+  ~AudioSeekTableCache() { clear(); }
+
+  /// Defines the max number of files for which we keep the table
+  void setMaxFiles(int count) {
+    max_files = count < 1 ? 1 : count;
+    while (entries.size() > max_files) {
+      delete entries[entries.size() - 1];
+      entries.resize(entries.size() - 1);
+    }
+  }
+
+  /// Number of mp3 frames between two index entries of new tables
+  void setIndexInterval(int frames) { index_interval = frames; }
+
+  /// Number of mp3 frames which are decoded before the requested frame
+  void setPrerollFrames(int frames) { preroll_frames = frames; }
+
+  /// Provides the table of the indicated file: it is built if it is not
+  /// available yet. Returns nullptr if the format is not supported.
+  AudioSeekTable *get(const char *name, AudioSource &source, Stream &stream) {
+    const char *key = name != nullptr ? name : "";
+    use_count++;
+    // files without name are not cached
+    for (auto entry : entries) {
+      if (*key != 0 && entry->table && entry->name.equals(key)) {
+        entry->last_used = use_count;
+        entry->table.setInput(source, stream);
+        return &entry->table;
+      }
+    }
+    // use a new or the least recently used entry
+    Entry *entry = nullptr;
+    if (entries.size() < max_files) {
+      entry = new Entry();
+      entries.push_back(entry);
+    } else {
+      entry = entries[0];
+      for (auto e : entries) {
+        if (e->last_used < entry->last_used) entry = e;
+      }
+    }
+    entry->name = key;
+    entry->last_used = use_count;
+    entry->table.setIndexInterval(index_interval);
+    entry->table.setPrerollFrames(preroll_frames);
+    if (!entry->table.begin(source, stream)) return nullptr;
+    return &entry->table;
+  }
+
+  /// Releases all tables
+  void clear() {
+    for (auto entry : entries) delete entry;
+    entries.clear();
+  }
+
+ protected:
+  struct Entry {
+    Str name;
+    AudioSeekTable table;
+    uint32_t last_used = 0;
+  };
+  Vector<Entry *> entries;
+  int max_files = 4;
+  int index_interval = 32;
+  int preroll_frames = 4;
+  uint32_t use_count = 0;
+};
+
+}  // namespace audio_tools
@@ -35,6 +35,8 @@ public:
   bool begin() override {
     TRACED();
     active = true;
+    // avoid allocations in write()
+    setupLazy();
     bool rc = p_dec->begin();
     return rc;
   }
@@ -301,6 +301,50 @@ class HeaderParserMP3 {
   // provides the parsed MP3 frame header
   FrameHeader getFrameHeader() { return header; }
 
+  /// Information of a single frame which is determined from the header bytes
+  struct FrameInfo {
+    int frame_length = 0;
+    int sample_rate = 0;
+    int samples_per_frame = 0;
+    int channels = 0;
+  };
+
+  /// Decodes the 4 byte frame header directly from the bytes: returns false
+  /// if this is not a valid frame header
+  static bool readFrameInfo(const uint8_t* data, FrameInfo& info) {
+    // kbit/s for MPEG1 layer 1,2,3 and MPEG2/2.5 layer 1 and layer 2,3
+    static const uint16_t bitrates[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}};
+    static const uint16_t rates[3] = {44100, 48000, 32000};
+    if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) return false;
+    int version = (data[1] >> 3) & 3;  // 0: 2.5, 2: MPEG2, 3: MPEG1
+    int layer = 4 - ((data[1] >> 1) & 3);
+    int bitrate_idx = data[2] >> 4;
+    int rate_idx = (data[2] >> 2) & 3;
+    int padding = (data[2] >> 1) & 1;
+    if (version == 1 || layer == 4 || rate_idx == 3) return false;
+    if (bitrate_idx == 0 || bitrate_idx == 15) return false;
+    bool is_v1 = version == 3;
+    int table = is_v1 ? layer - 1 : (layer == 1 ? 3 : 4);
+    long bitrate = bitrates[table][bitrate_idx] * 1000L;
+    int sample_rate = rates[rate_idx] >> (is_v1 ? 0 : (version == 2 ? 1 : 2));
+    if (layer == 1) {
+      info.samples_per_frame = 384;
+      info.frame_length = (12 * bitrate / sample_rate + padding) * 4;
+    } else {
+      info.samples_per_frame = layer == 3 && !is_v1 ? 576 : 1152;
+      info.frame_length =
+          info.samples_per_frame / 8 * bitrate / sample_rate + padding;
+    }
+    info.sample_rate = sample_rate;
+    info.channels = ((data[3] >> 6) & 3) == 3 ? 1 : 2;
+    return true;
+  }
+
   /// Finds the mp3/aac sync word
   int findSyncWord(const uint8_t* buf, size_t nBytes, uint8_t synch = 0xFF,
                    uint8_t syncl = 0xF0) {
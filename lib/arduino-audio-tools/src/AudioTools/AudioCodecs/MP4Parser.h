@@ -118,6 +118,10 @@ class MP4Parser {
     box.id = 0;
     box.is_incremental = false;
     box.is_complete = true;
+    box_in_progress = false;
+    box_bytes_received = 0;
+    box_bytes_expected = 0;
+    is_error = false;
     return true;
   }
 
@@ -406,7 +410,7 @@ protected:
       box.available = available_payload;
       box.level = box_level;
       box.file_offset = incremental_offset;
-      box.seq = 0;
+      box.seq = box_seq++;
       box.is_incremental = true;
       box.is_complete = false;
       box.is_container = false;
@@ -422,12 +426,13 @@ protected:
   /**
    * @brief Continue filling an incremental box. Returns false if not enough
    * data.
-   * @return False if more data was processed, true otherwise.
+   * @return True if the box is complete and the parsing can continue with the
+   * remaining data, false if we need more data.
    */
   bool continueIncrementalBox() {
     size_t to_read = std::min((size_t)box_bytes_expected - box_bytes_received,
                               (size_t)buffer.available());
-    if (to_read == 0) return true;
+    if (to_read == 0) return false;
     strcpy(box.type, box_type);
     box.id = ++this->box.id;
     box.data = buffer.data();
@@ -439,7 +444,7 @@ protected:
     box.is_complete = (box_bytes_received + to_read == box_bytes_expected);
     box.is_container = false;
     box.is_incremental = true;
-    box.seq = ++box_seq;
+    box.seq = box_seq++;  // 0 for the first reported data
     processCallback(box);
     box_bytes_received += to_read;
     // fileOffset += to_read;
@@ -449,7 +454,7 @@ protected:
     if (box_bytes_received >= box_bytes_expected) {
       box_in_progress = false;
     }
-    return false;
+    return !box_in_progress;
   }
 
   /**
@@ -530,7 +535,8 @@ protected:
       // pure containers
       static const char* containers_str[] = {
           "moov", "trak", "mdia", "minf", "stbl", "edts", "dinf", "udta",
-          "ilst", "moof", "traf", "mfra", "tref", "iprp", "sinf", "schi"};
+          "ilst", "moof", "traf", "mfra", "tref", "iprp", "sinf", "schi",
+          "----"};
       for (const char* c : containers_str) {
         ContainerInfo info;
         info.name = c;
@@ -569,10 +575,12 @@ protected:
    * @return true if valid, false otherwise.
    */
   bool isValidType(const char* type, int offset = 0) const {
+    if (type == nullptr) return false;
+    // freeform ilst item e.g. iTunSMPB
+    if (strncmp(type + offset, "----", 4) == 0) return true;
     // Check if the type is a valid 4-character string
-    return (type != nullptr && isalnum(type[offset]) &&
-            isalnum(type[offset + 1]) && isalnum(type[offset + 2]) &&
-            isalnum(type[offset + 3]));
+    return (isalnum(type[offset]) && isalnum(type[offset + 1]) &&
+            isalnum(type[offset + 2]) && isalnum(type[offset + 3]));
   }
 
   /**
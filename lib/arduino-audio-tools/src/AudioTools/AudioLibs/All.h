@@ -10,6 +10,7 @@
 #include "AudioSTK.h"
 #include "Concurrency.h"
 #include "FFTEffects.h"
+#include "FFTMFCC.h"
 #include "HLSStream.h"
 #include "I2SCodecStream.h"
 #include "LEDOutput.h"
@@ -88,8 +88,30 @@ class FFTDriverCmsisFFT : public FFTDriver {
             return true;
         }
 
+        /// The rfft result is packed: bin 0 and len/2 are real and share the first entry
+        bool getSpectrumBin(int pos, FFTBin &bin) override {
+            if (pos<0 || pos>len/2) return false;
+            if (pos==0 || pos==len/2){
+                bin.real = pos==0 ? output[0] : output[1];
+                bin.img = 0.0f;
+                return true;
+            }
+            return getBin(pos, bin);
+        }
+
+        bool setSpectrumBin(int pos, float real, float img) override {
+            if (pos<0 || pos>len/2) return false;
+            if (pos==0 || pos==len/2){
+                output[pos==0 ? 0 : 1] = real;
+                return true;
+            }
+            return setBin(pos, real, img);
+        }
+
         bool isReverseFFT() override {return true;}
 
+        int length() override { return len; }
+
         bool isValid() override{ return status==ARM_MATH_SUCCESS; }
 
 	    arm_rfft_fast_instance_f32 fft_instance;
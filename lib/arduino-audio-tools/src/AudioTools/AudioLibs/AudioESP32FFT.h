@@ -47,26 +47,51 @@ class FFTDriverESP32FFT : public FFTDriver {
 
         /// magnitude w/o sqrt
         float magnitudeFast(int idx) override {
-            return (pow(p_fft_object->output[2*idx],2) + pow(p_fft_object->output[2*idx+1],2));
+            FFTBin bin;
+            if (!getSpectrumBin(idx, bin)) return 0.0f;
+            return bin.real*bin.real + bin.img*bin.img;
         }
 
         float getValue(int idx) { return p_fft_object->input[idx];}
 
+        /// The output holds len floats: only the bins 0..len/2-1 are available
         bool setBin(int pos, float real, float img) override {
-            if (pos>=len) return false;
+            if (pos<0 || pos>=len/2) return false;
             p_fft_object->output[2*pos] = real;
             p_fft_object->output[2*pos+1] = img;
             return true;
         }
         bool getBin(int pos, FFTBin &bin) override { 
-            if (pos>=len) return false;
+            if (pos<0 || pos>=len/2) return false;
             bin.real = p_fft_object->output[2*pos];
             bin.img = p_fft_object->output[2*pos+1];
             return true;
         }
 
+        /// The rfft result is packed: bin 0 and len/2 are real and share the first entry
+        bool getSpectrumBin(int pos, FFTBin &bin) override {
+            if (pos<0 || pos>len/2) return false;
+            if (pos==0 || pos==len/2){
+                bin.real = p_fft_object->output[pos==0 ? 0 : 1];
+                bin.img = 0.0f;
+                return true;
+            }
+            return getBin(pos, bin);
+        }
+
+        bool setSpectrumBin(int pos, float real, float img) override {
+            if (pos<0 || pos>len/2) return false;
+            if (pos==0 || pos==len/2){
+                p_fft_object->output[pos==0 ? 0 : 1] = real;
+                return true;
+            }
+            return setBin(pos, real, img);
+        }
+
         bool isReverseFFT() override {return true;}
 
+        int length() override { return len; }
+
         bool isValid() override{ return p_fft_object!=nullptr; }
 
         fft_config_t *p_fft_object=nullptr;
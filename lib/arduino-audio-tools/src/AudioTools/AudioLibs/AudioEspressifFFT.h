@@ -119,6 +119,8 @@ class FFTDriverEspressifFFT : public FFTDriver {
 
         bool isReverseFFT() override {return true;}
 
+        int length() override { return len; }
+
         bool isValid() override{ return fft_data.data()!=nullptr && ret==ESP_OK; }
 
         esp_err_t ret;
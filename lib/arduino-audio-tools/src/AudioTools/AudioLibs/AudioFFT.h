@@ -1,6 +1,8 @@
 #pragma once
 
+#include "AudioTools/CoreAudio/FFTDriver.h"
 #include "AudioTools/AudioLibs/FFT/FFTWindows.h"
+#include "AudioTools/AudioLibs/FFT/MelFilterBank.h"
 #include "AudioTools/CoreAudio/AudioStreams.h"
 #include "AudioTools/CoreAudio/MusicalNotes.h"
 
@@ -61,28 +63,6 @@ struct AudioFFTConfig : public AudioInfo {
   void *ref = nullptr;
 };
 
-/// And individual FFT Bin
-struct FFTBin {
-  float real;
-  float img;
-
-  FFTBin() = default;
-
-  FFTBin(float r, float i) {
-    real = r;
-    img = i;
-  }
-
-  void multiply(float f) {
-    real *= f;
-    img *= f;
-  }
-
-  void conjugate() { img = -img; }
-
-  void clear() { real = img = 0.0f; }
-};
-
 /// Inverse FFT Overlapp Add
 class FFTInverseOverlapAdder {
  public:
@@ -147,39 +127,6 @@ class FFTInverseOverlapAdder {
   float rfft_max = 0;
 };
 
-/**
- * @brief Abstract Class which defines the basic FFT functionality
- * @ingroup fft
- * @author Phil Schatzmann
- * @copyright GPLv3
- */
-class FFTDriver {
- public:
-  virtual bool begin(int len) = 0;
-  virtual void end() = 0;
-  /// Sets the real value
-  virtual void setValue(int pos, float value) = 0;
-  /// Perform FFT
-  virtual void fft() = 0;
-  /// Calculate the magnitude (fft result) at index (sqr(i² + r²))
-  virtual float magnitude(int idx) = 0;
-  /// Calculate the magnitude w/o sqare root
-  virtual float magnitudeFast(int idx) = 0;
-  virtual bool isValid() = 0;
-  /// Returns true if reverse FFT is supported
-  virtual bool isReverseFFT() { return false; }
-  /// Calculate reverse FFT
-  virtual void rfft() { LOGE("Not implemented"); }
-  /// Get result value from Reverse FFT
-  virtual float getValue(int pos) = 0;
-  /// sets the value of a bin
-  virtual bool setBin(int idx, float real, float img) { return false; }
-  /// sets the value of a bin
-  bool setBin(int pos, FFTBin &bin) { return setBin(pos, bin.real, bin.img); }
-  /// gets the value of a bin
-  virtual bool getBin(int pos, FFTBin &bin) { return false; }
-};
-
 /**
  * @brief Executes FFT using audio data privded by write() and/or an inverse FFT
  * where the samples are made available via readBytes(). The Driver which is
@@ -288,6 +235,8 @@ class AudioFFTBase : public AudioStream {
     rfft_data.resize(0);
     rfft_add.resize(0);
     step_data.resize(0);
+    mel_bins.resize(0);
+    mel_filter.end();
   }
 
   /// Provide the audio data as FFT input
@@ -391,69 +340,18 @@ class AudioFFTBase : public AudioStream {
     }
   }
 
-  /// Convert the FFT result to MEL spectrum
+  /// Convert the FFT result to MEL spectrum: the filters are only
+  /// calculated when the parameters change.
   float *toMEL(int n_bins, float min_freq = 0.0f, float max_freq = 0.0f) {
-    // calculate mel bins
     if (n_bins <= 0) n_bins = size();
     if (min_freq <= 0.0f) min_freq = frequency(0);
     if (max_freq <= 0.0f) max_freq = frequency(size() - 1);
-    mel_bins.resize(n_bins);
-
-    // Convert min and max frequencies to MEL scale
-    float min_mel = 2595.0f * log10(1.0f + (min_freq / 700.0f));
-    float max_mel = 2595.0f * log10(1.0f + (max_freq / 700.0f));
-
-    // Create equally spaced points in the MEL scale
-    Vector<float> mel_points;
-    mel_points.resize(n_bins + 2);  // +2 for the endpoints
-
-    float mel_step = (max_mel - min_mel) / (n_bins + 1);
-    for (int i = 0; i < n_bins + 2; i++) {
-      mel_points[i] = min_mel + i * mel_step;
+    if (!mel_filter.begin(n_bins, cfg.length, cfg.sample_rate, min_freq,
+                          max_freq)) {
+      return nullptr;
     }
-
-    // Convert MEL points back to frequency
-    Vector<float> freq_points;
-    freq_points.resize(n_bins + 2);
-    for (int i = 0; i < n_bins + 2; i++) {
-      freq_points[i] = 700.0f * (pow(10.0f, mel_points[i] / 2595.0f) - 1.0f);
-    }
-
-    // Convert frequency points to FFT bin indices
-    Vector<int> bin_indices;
-    bin_indices.resize(n_bins + 2);
-    for (int i = 0; i < n_bins + 2; i++) {
-      bin_indices[i] = round(freq_points[i] * cfg.length / cfg.sample_rate);
-      // Ensure bin index is within valid range
-      if (bin_indices[i] >= bins) bin_indices[i] = bins - 1;
-      if (bin_indices[i] < 0) bin_indices[i] = 0;
-    }
-
-    // Create and apply triangular filters
-    for (int i = 0; i < n_bins; i++) {
-      float mel_sum = 0.0f;
-
-      int start_bin = bin_indices[i];
-      int mid_bin = bin_indices[i + 1];
-      int end_bin = bin_indices[i + 2];
-
-      // Apply first half of triangle filter (ascending)
-      for (int j = start_bin; j < mid_bin; j++) {
-        if (j >= bins) break;
-        float weight = (j - start_bin) / float(mid_bin - start_bin);
-        mel_sum += magnitude(j) * weight;
-      }
-
-      // Apply second half of triangle filter (descending)
-      for (int j = mid_bin; j < end_bin; j++) {
-        if (j >= bins) break;
-        float weight = (end_bin - j) / float(end_bin - mid_bin);
-        mel_sum += magnitude(j) * weight;
-      }
-
-      mel_bins[i] = mel_sum;
-    }
-
+    mel_bins.resize(n_bins);
+    mel_filter.process(magnitudes(), mel_bins.data());
     return mel_bins.data();
   }
 
@@ -649,6 +547,7 @@ class AudioFFTBase : public AudioStream {
   Vector<float> l_magnitudes{0};
   Vector<float> step_data{0};
   Vector<float> mel_bins{0};
+  MelFilterBank mel_filter;
   SingleBuffer<uint8_t> stride_buffer{0};
   RingBuffer<uint8_t> rfft_data{0};
   bool has_rfft_data = false;
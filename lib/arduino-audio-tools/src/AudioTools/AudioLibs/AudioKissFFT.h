@@ -36,6 +36,7 @@ class FFTDriverKissFFT : public FFTDriver {
         }
         void setValue(int idx, float value) override {
             k_data[idx].r  = value; 
+            k_data[idx].i  = 0.0f;
         }
 
         void fft() override {
@@ -62,6 +63,8 @@ class FFTDriverKissFFT : public FFTDriver {
 
         bool isReverseFFT() override {return true;}
 
+        int length() override { return len; }
+
         float getValue(int idx) override { return k_data[idx].r; }
 
         bool setBin(int pos, FFTBin &bin)  { return FFTDriver::setBin(pos, bin);}
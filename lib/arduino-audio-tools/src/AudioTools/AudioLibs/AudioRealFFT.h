@@ -79,6 +79,24 @@ class FFTDriverRealFFT : public FFTDriver {
             return true;
         }
 
+        /// The result is packed in v_f: real values 0..len/2 followed by the
+        /// negative imaginary values of 1..len/2-1
+        bool getSpectrumBin(int pos, FFTBin &bin) override {
+            if (pos<0 || pos>len/2) return false;
+            bin.real = v_f[pos];
+            bin.img = (pos==0 || pos==len/2) ? 0.0f : -v_f[len/2+pos];
+            return true;
+        }
+
+        bool setSpectrumBin(int pos, float real, float img) override {
+            if (pos<0 || pos>len/2) return false;
+            v_f[pos] = real;
+            if (pos>0 && pos<len/2) v_f[len/2+pos] = -img;
+            return true;
+        }
+
+        int length() override { return len; }
+
         ffft::FFTReal <float> *p_fft_object=nullptr;
         Vector<float> v_x{0}; // real
         Vector<float> v_f{0}; // complex
@@ -0,0 +1,253 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/BaseStream.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Read only file stream which maps the file into memory: The data is
+ * accessed like in a MemoryStream, so peekRead() provides the file content
+ * w/o any copy and seek() is just a pointer update. We give the kernel
+ * read-ahead hints with madvise(): the access is declared as sequential and
+ * the next readAhead() bytes are requested in advance.
+ *
+ * Files which are bigger than setMaxMapSize(), non-regular files (e.g. pipes)
+ * and files which can not be mapped are read with buffered read() calls. In
+ * this case peekRead() provides the content of the internal buffer.
+ * @ingroup io
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MappedFileStream : public AudioStream {
+ public:
+  MappedFileStream() = default;
+
+  /// Constructor which opens the file
+  MappedFileStream(const char *path) { begin(path); }
+
+  ~MappedFileStream() { end(); }
+
+  /// Opens the file
+  bool begin(const char *path) {
+    TRACED();
+    end();
+    file_path = path;
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      LOGE("Could not open %s", path);
+      return false;
+    }
+    struct stat st;
+    is_regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    file_size = is_regular ? st.st_size : 0;
+    if (is_regular && file_size > 0 && file_size <= max_map_size) {
+      void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        map = (const uint8_t *)addr;
+        madvise(addr, file_size, is_sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+      } else {
+        LOGW("mmap failed for %s: using buffered reads", path);
+      }
+    }
+    if (map == nullptr) {
+      buffer.resize(buffer_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+      if (is_regular && is_sequential)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    LOGI("%s: %lu bytes, mapped: %s", path, (unsigned long)file_size,
+         map != nullptr ? "true" : "false");
+    return begin();
+  }
+
+  /// Moves to the beginning of the file
+  bool begin() override {
+    if (fd < 0) return false;
+    return seek(0);
+  }
+
+  /// Unmaps and closes the file
+  void end() override {
+    if (map != nullptr) munmap((void *)map, file_size);
+    if (fd >= 0) ::close(fd);
+    map = nullptr;
+    fd = -1;
+    file_size = 0;
+    pos = 0;
+    buffer_start = 0;
+    buffer_len = 0;
+    is_eof = false;
+  }
+
+  /// Returns true if the file is open
+  bool isOpen() { return fd >= 0; }
+
+  /// Returns true if the file is accessed via mmap
+  bool isMapped() { return map != nullptr; }
+
+  /// Provides the file content if it is mapped: nullptr otherwise
+  const uint8_t *data() { return map; }
+
+  /// File size in bytes: 0 for non-regular files
+  size_t size() { return file_size; }
+
+  /// Current read position
+  size_t position() { return pos; }
+
+  /// Provides the file name
+  const char *name() { return file_path.c_str(); }
+
+  /// Moves the read position
+  bool seek(size_t newPos) {
+    if (fd < 0) return false;
+    if (is_regular && newPos > file_size) return false;
+    if (map == nullptr) {
+      // keep the buffer if the position is inside of it
+      if (newPos < buffer_start || newPos > buffer_start + buffer_len) {
+        if (lseek(fd, newPos, SEEK_SET) < 0) return false;
+        buffer_start = newPos;
+        buffer_len = 0;
+      }
+      is_eof = false;
+    }
+    pos = newPos;
+    next_hint = pos;
+    readAheadHint();
+    return true;
+  }
+
+  int available() override {
+    if (fd < 0) return 0;
+    if (is_regular) {
+      size_t result = file_size - pos;
+      return result > INT32_MAX ? INT32_MAX : result;
+    }
+    // non-regular files: we only know the buffered data
+    if (pos == buffer_start + buffer_len) fillBuffer();
+    return buffer_start + buffer_len - pos;
+  }
+
+  size_t readBytes(uint8_t *data, size_t len) override {
+    size_t count = 0;
+    while (count < len) {
+      const uint8_t *src = nullptr;
+      size_t n = peekRead(&src, len - count);
+      if (n == 0) break;
+      memcpy(data + count, src, n);
+      commitRead(n);
+      count += n;
+    }
+    return count;
+  }
+
+  /// Provides direct access to the file content
+  size_t peekRead(const uint8_t **data, size_t len) override {
+    if (fd < 0) return 0;
+    if (map != nullptr) {
+      size_t result = min(len, file_size - pos);
+      *data = map + pos;
+      return result;
+    }
+    if (pos == buffer_start + buffer_len && !fillBuffer()) return 0;
+    *data = buffer.data() + (pos - buffer_start);
+    return min(len, (size_t)(buffer_start + buffer_len - pos));
+  }
+
+  /// Consumes the data provided by peekRead()
+  size_t commitRead(size_t len) override {
+    size_t end = map != nullptr ? file_size : buffer_start + buffer_len;
+    size_t result = min(len, end - pos);
+    pos += result;
+    if (pos >= next_hint) readAheadHint();
+    return result;
+  }
+
+  int read() override {
+    int result = peek();
+    if (result >= 0) commitRead(1);
+    return result;
+  }
+
+  int peek() override {
+    const uint8_t *src = nullptr;
+    if (peekRead(&src, 1) != 1) return -1;
+    return *src;
+  }
+
+  /// The file is read only
+  size_t write(const uint8_t *data, size_t len) override { return 0; }
+
+  int availableForWrite() override { return 0; }
+
+  operator bool() override { return fd >= 0 && available() > 0; }
+
+  /// Bigger files are read with buffered reads (default 16 GB on 64 bit
+  /// and 256 MB on 32 bit systems): call before begin()
+  void setMaxMapSize(uint64_t size) { max_map_size = size; }
+
+  /// Buffer size for the buffered reads (default 64k): call before begin()
+  void setBufferSize(size_t size) { buffer_size = size; }
+
+  /// Number of bytes which are requested from the kernel in advance of
+  /// the read position (default 256k): 0 disables the hints.
+  void setReadAhead(size_t bytes) { read_ahead = bytes; }
+
+  /// Provides the read ahead size in bytes
+  size_t readAhead() { return read_ahead; }
+
+  /// Defines if the file is read sequentially (default true): use false for
+  /// random access e.g. for indexing. Call before begin().
+  void setSequential(bool flag) { is_sequential = flag; }
+
+ protected:
+  std::string file_path;
+  int fd = -1;
+  const uint8_t *map = nullptr;
+  size_t file_size = 0;
+  size_t pos = 0;
+  size_t next_hint = 0;
+  size_t read_ahead = 256 * 1024;
+  uint64_t max_map_size = sizeof(void *) > 4 ? 16ull << 30 : 256ul << 20;
+  bool is_regular = false;
+  bool is_sequential = true;
+  bool is_eof = false;
+  // buffered reads
+  Vector<uint8_t> buffer{0};
+  size_t buffer_size = 64 * 1024;
+  size_t buffer_start = 0;
+  size_t buffer_len = 0;
+
+  /// Reads the next block: the buffer must be consumed
+  bool fillBuffer() {
+    if (is_eof || buffer.size() == 0) return false;
+    ssize_t len = ::read(fd, buffer.data(), buffer.size());
+    if (len <= 0) {
+      is_eof = true;
+      return false;
+    }
+    buffer_start = pos;
+    buffer_len = len;
+    return true;
+  }
+
+  /// Requests the next read_ahead bytes from the kernel
+  void readAheadHint() {
+    if (map == nullptr || read_ahead == 0 || !is_sequential) return;
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t start = pos / page_size * page_size;
+    if (start >= file_size) return;
+    size_t len = min(read_ahead + (pos - start), file_size - start);
+    madvise((void *)(map + start), len, MADV_WILLNEED);
+    next_hint = pos + read_ahead / 2;
+  }
+};
+
+}  // namespace audio_tools
@@ -152,7 +152,7 @@ class Stream : public Print {
   size_t readBytesUntil(char terminator, char *buffer, size_t length) {
 	for (int j=0;j<length;j++){
 		int val = read();
-		if (val == -1) return j-1;
+		if (val == -1) return j;
 		if (val == terminator) return j;
 		buffer[j] = val;
 	}
@@ -0,0 +1,149 @@
+/**
+ * @file MelFilterBank.h
+ * @author Phil Schatzmann
+ * @brief Precalculated triangular mel filters which are applied to a FFT
+ * spectrum
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <math.h>
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Triangular mel filter bank which is calculated only once in begin():
+ * For each filter we store the first bin and the weights of the bins which
+ * are not 0, so applying the filters is just a sparse dot product with the
+ * spectrum and each bin is touched at most twice.
+ * @ingroup fft
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MelFilterBank {
+ public:
+  MelFilterBank() = default;
+
+  /// Calculates the filters for a fft of the indicated length: if the
+  /// parameters did not change we keep the existing filters.
+  bool begin(int melBins, int fftLength, float sampleRate, float minFreq,
+             float maxFreq) {
+    if (melBins <= 0 || fftLength <= 0 || sampleRate <= 0 ||
+        maxFreq <= minFreq) {
+      LOGE("Invalid mel filter parameters");
+      return false;
+    }
+    if (melBins == mel_bins && fftLength == fft_length &&
+        sampleRate == sample_rate && minFreq == min_freq &&
+        maxFreq == max_freq) {
+      return true;
+    }
+    mel_bins = melBins;
+    fft_length = fftLength;
+    sample_rate = sampleRate;
+    min_freq = minFreq;
+    max_freq = maxFreq;
+    setup();
+    return true;
+  }
+
+  /// Releases the memory
+  void end() {
+    mel_bins = 0;
+    fft_length = 0;
+    start_bins.resize(0);
+    offsets.resize(0);
+    weights.resize(0);
+  }
+
+  /// Applies the filters to the spectrum (indexed by bin) and writes melBins
+  /// values to the result
+  void process(const float *spectrum, float *result) {
+    for (int i = 0; i < mel_bins; i++) {
+      const float *w = weights.data() + offsets[i];
+      const float *s = spectrum + start_bins[i];
+      int count = offsets[i + 1] - offsets[i];
+      float sum = 0.0f;
+      for (int j = 0; j < count; j++) {
+        sum += w[j] * s[j];
+      }
+      result[i] = sum;
+    }
+  }
+
+  /// Number of mel bins
+  int size() { return mel_bins; }
+
+  /// First fft bin which is used by any filter
+  int startBin() { return mel_bins > 0 ? start_bins[0] : 0; }
+
+  /// Fft bin after the last one which is used by any filter
+  int endBin() { return end_bin; }
+
+  /// Converts a frequency to the mel scale
+  static float toMel(float freq) {
+    return 2595.0f * log10f(1.0f + freq / 700.0f);
+  }
+
+  /// Converts a mel value to the frequency
+  static float toFrequency(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+  }
+
+ protected:
+  int mel_bins = 0;
+  int fft_length = 0;
+  float sample_rate = 0;
+  float min_freq = 0;
+  float max_freq = 0;
+  int end_bin = 0;
+  Vector<int> start_bins{0};
+  Vector<int> offsets{0};  // start of the weights of each filter (+ end)
+  Vector<float> weights{0};
+
+  void setup() {
+    int bins = fft_length / 2;
+    float bin_width = sample_rate / fft_length;
+    // edges of the triangles in fft bin units
+    Vector<float> edges;
+    edges.resize(mel_bins + 2);
+    float min_mel = toMel(min_freq);
+    float mel_step = (toMel(max_freq) - min_mel) / (mel_bins + 1);
+    for (int i = 0; i < mel_bins + 2; i++) {
+      edges[i] = toFrequency(min_mel + i * mel_step) / bin_width;
+    }
+
+    start_bins.resize(mel_bins);
+    offsets.resize(mel_bins + 1);
+    weights.resize(0);
+    end_bin = 0;
+    for (int i = 0; i < mel_bins; i++) {
+      float left = edges[i];
+      float center = edges[i + 1];
+      float right = edges[i + 2];
+      int first = max(0, (int)ceilf(left));
+      int last = min(bins - 1, (int)ceilf(right) - 1);
+      offsets[i] = weights.size();
+      if (first > last) {
+        // the filter is narrower than a bin: use the nearest bin
+        first = last = min(bins - 1, (int)roundf(center));
+        weights.push_back(1.0f);
+      } else {
+        for (int j = first; j <= last; j++) {
+          float w = j < center ? (j - left) / (center - left)
+                               : (right - j) / (right - center);
+          weights.push_back(w > 0.0f ? w : 0.0f);
+        }
+      }
+      start_bins[i] = first;
+      end_bin = max(end_bin, last + 1);
+    }
+    offsets[mel_bins] = weights.size();
+    LOGI("mel filters: %d, weights: %d", mel_bins, (int)weights.size());
+  }
+};
+
+}  // namespace audio_tools
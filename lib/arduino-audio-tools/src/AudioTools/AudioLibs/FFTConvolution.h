@@ -0,0 +1,360 @@
+#pragma once
+
+#include "AudioTools/AudioLibs/AudioRealFFT.h"  // default driver
+#include "AudioTools/CoreAudio/AudioOutput.h"
+#include "AudioTools/CoreAudio/AudioStreams.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Configuration for FFTConvolutionStream
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct FFTConvolutionConfig : public AudioInfo {
+  FFTConvolutionConfig() {
+    bits_per_sample = 16;
+    channels = 2;
+  }
+  /// partition length in frames (power of 2): the fft length is twice this
+  /// value and the latency is block_size frames
+  int block_size = 256;
+};
+
+/**
+ * @brief Convolution of the audio data with a long impulse response (e.g. for
+ * speaker correction or reverb) using a uniformly partitioned overlap-save
+ * algorithm: The impulse response is split into partitions of block_size
+ * samples which are transformed once in begin(). For each block we execute one
+ * fft, multiply the spectra with the frequency domain delay line and execute
+ * one reverse fft. So the cost per sample grows with log(N) instead of N.
+ *
+ * Any FFTDriver which supports the reverse fft can be used (e.g.
+ * FFTDriverKissFFT): by default we use FFTDriverRealFFT. The output is delayed
+ * by latency() frames. The coefficients are only referenced and need to be
+ * valid until begin() has been called.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FFTConvolutionStream : public ModifyingStream {
+ public:
+  FFTConvolutionStream() = default;
+
+  /// Constructor which assigns Print output
+  FFTConvolutionStream(Print &out) { setOutput(out); }
+
+  /// Constructor which assigns Stream input or output
+  FFTConvolutionStream(Stream &io) { setStream(io); }
+
+  /// Constructor which assigns Print output
+  FFTConvolutionStream(AudioOutput &out) {
+    Print *p_print = &out;
+    setOutput(*p_print);
+    addNotifyAudioChange(out);
+  }
+
+  /// Constructor which assigns Stream input or output
+  FFTConvolutionStream(AudioStream &io) {
+    Stream *p_stream = &io;
+    setStream(*p_stream);
+    addNotifyAudioChange(io);
+  }
+
+  /// Defines/Changes the input & output
+  void setStream(Stream &in) override {
+    p_in = &in;
+    p_out = p_in;
+  }
+
+  /// Defines/Changes the output target
+  void setOutput(Print &out) override { p_out = &out; }
+
+  /// Defines the fft implementation: call before begin()
+  void setDriver(FFTDriver &driver) { p_driver = &driver; }
+
+  FFTConvolutionConfig defaultConfig() {
+    FFTConvolutionConfig c;
+    return c;
+  }
+
+  /// Defines the impulse response which is used for all channels
+  bool setCoefficients(const float *coef, int len) {
+    coef_ptr.resize(1);
+    coef_len.resize(1);
+    coef_ptr[0] = coef;
+    coef_len[0] = len;
+    return len > 0;
+  }
+
+  /// Defines the impulse response which is used for all channels
+  template <size_t N>
+  bool setCoefficients(const float (&coef)[N]) {
+    return setCoefficients(coef, N);
+  }
+
+  /// Defines the impulse response for an individual channel
+  bool setCoefficients(int channel, const float *coef, int len) {
+    if (channel < 0) return false;
+    if (coef_ptr.size() <= channel) {
+      coef_ptr.resize(channel + 1);
+      coef_len.resize(channel + 1);
+    }
+    coef_ptr[channel] = coef;
+    coef_len[channel] = len;
+    return len > 0;
+  }
+
+  bool begin(FFTConvolutionConfig cfg) {
+    cfg_block_size = cfg.block_size;
+    setAudioInfo(cfg);
+    return begin();
+  }
+
+  bool begin() override {
+    TRACED();
+    is_active = false;
+    block_size = cfg_block_size;
+    if (block_size <= 0 || (block_size & (block_size - 1)) != 0) {
+      LOGE("block_size must be a power of 2: %d", block_size);
+      return false;
+    }
+    if (coef_ptr.size() == 0) {
+      LOGE("No coefficients");
+      return false;
+    }
+    if (coef_ptr.size() > 1 && coef_ptr.size() < info.channels) {
+      LOGE("Coefficients missing for %d channels", info.channels);
+      return false;
+    }
+    if (info.channels <= 0) return false;
+    if (!p_driver->begin(2 * block_size) || !p_driver->isReverseFFT()) {
+      LOGE("FFT driver not available");
+      return false;
+    }
+
+    bins = block_size + 1;
+    partitions = 1;
+    for (int j = 0; j < coef_len.size(); j++) {
+      int p = (coef_len[j] + block_size - 1) / block_size;
+      if (p > partitions) partitions = p;
+    }
+    int channels = info.channels;
+    int spectra_count = coef_ptr.size() == 1 ? 1 : channels;
+    spectra.resize(spectra_count * partitions * bins * 2);
+    fdl.resize(channels * partitions * bins * 2);
+    acc.resize(bins * 2);
+    input.resize(channels * block_size * 2);
+    output.resize(channels * block_size);
+    reset();
+
+    float scale = 1.0f / reverseScale();
+    for (int j = 0; j < spectra_count; j++) {
+      setupSpectra(j, scale);
+    }
+    LOGI("partitions: %d, block_size: %d", partitions, block_size);
+    is_active = true;
+    return true;
+  }
+
+  void end() override {
+    is_active = false;
+    p_driver->end();
+  }
+
+  /// Clears the delay lines: coefficients are kept
+  void reset() {
+    memset(fdl.data(), 0, fdl.size() * sizeof(float));
+    memset(input.data(), 0, input.size() * sizeof(float));
+    memset(output.data(), 0, output.size() * sizeof(float));
+    fdl_head = 0;
+    pos = 0;
+  }
+
+  /// Defines the partition size in frames: call before begin()
+  void setBlockSize(int frames) { cfg_block_size = frames; }
+
+  /// Provides the delay of the output in frames
+  int latency() { return block_size; }
+
+  /// Provides the number of partitions of the impulse response
+  int partitionCount() { return partitions; }
+
+  void setAudioInfo(AudioInfo newInfo) override {
+    bool changed = info.channels != newInfo.channels ||
+                   info.bits_per_sample != newInfo.bits_per_sample;
+    ModifyingStream::setAudioInfo(newInfo);
+    if (changed && is_active) begin();
+  }
+
+  size_t readBytes(uint8_t *data, size_t len) override {
+    if (data == nullptr || p_in == nullptr) {
+      LOGE("NPE");
+      return 0;
+    }
+    size_t result = p_in->readBytes(data, len);
+    processInPlace(data, result);
+    return result;
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    if (data == nullptr || p_out == nullptr) {
+      LOGE("NPE");
+      return 0;
+    }
+    processInPlace((uint8_t *)data, len);
+    return p_out->write(data, len);
+  }
+
+  int available() override { return p_in == nullptr ? 0 : p_in->available(); }
+
+  int availableForWrite() override {
+    return p_out == nullptr ? 0 : p_out->availableForWrite();
+  }
+
+  bool isInPlace() override { return true; }
+
+  void processInPlace(uint8_t *data, size_t len) override {
+    if (!is_active) return;
+    switch (info.bits_per_sample) {
+      case 8:
+        process<int8_t>((int8_t *)data, len);
+        break;
+      case 16:
+        process<int16_t>((int16_t *)data, len / sizeof(int16_t));
+        break;
+      case 24:
+        process<int24_t>((int24_t *)data, len / sizeof(int24_t));
+        break;
+      case 32:
+        process<int32_t>((int32_t *)data, len / sizeof(int32_t));
+        break;
+      default:
+        LOGE("Unsupported bits: %d", info.bits_per_sample);
+    }
+  }
+
+ protected:
+  Stream *p_in = nullptr;
+  Print *p_out = nullptr;
+  FFTDriverRealFFT default_driver;
+  FFTDriver *p_driver = &default_driver;
+  Vector<const float *> coef_ptr{0};
+  Vector<int> coef_len{0};
+  // partition spectra: [spectrum][partition][bin] as real, img
+  Vector<float> spectra{0};
+  // frequency domain delay line: [channel][partition][bin] as real, img
+  Vector<float> fdl{0};
+  Vector<float> acc{0};
+  // time domain: previous and current block per channel
+  Vector<float> input{0};
+  Vector<float> output{0};
+  int cfg_block_size = 256;
+  int block_size = 0;
+  int bins = 0;
+  int partitions = 0;
+  int fdl_head = 0;
+  int pos = 0;
+  bool is_active = false;
+
+  template <typename T>
+  void process(T *data, size_t samples) {
+    int channels = info.channels;
+    size_t frames = samples / channels;
+    for (size_t j = 0; j < frames; j++) {
+      T *frame = data + j * channels;
+      for (int ch = 0; ch < channels; ch++) {
+        input[(ch * 2 + 1) * block_size + pos] = static_cast<float>(frame[ch]);
+        frame[ch] = NumberConverter::clipT<T>(output[ch * block_size + pos]);
+      }
+      if (++pos == block_size) {
+        for (int ch = 0; ch < channels; ch++) processBlock(ch);
+        fdl_head = (fdl_head + 1) % partitions;
+        pos = 0;
+      }
+    }
+  }
+
+  /// fft of the last 2 blocks, multiply accumulate with the delay line and
+  /// reverse fft: the last half is the result
+  void processBlock(int ch) {
+    float *in = input.data() + ch * 2 * block_size;
+    int len = 2 * block_size;
+    for (int j = 0; j < len; j++) p_driver->setValue(j, in[j]);
+    p_driver->fft();
+
+    FFTBin bin;
+    int stride = bins * 2;
+    float *x = fdl.data() + (ch * partitions + fdl_head) * stride;
+    for (int k = 0; k < bins; k++) {
+      p_driver->getSpectrumBin(k, bin);
+      x[k * 2] = bin.real;
+      x[k * 2 + 1] = bin.img;
+    }
+
+    memset(acc.data(), 0, acc.size() * sizeof(float));
+    int spectrum = coef_ptr.size() == 1 ? 0 : ch;
+    const float *h = spectra.data() + spectrum * partitions * stride;
+    for (int p = 0; p < partitions; p++) {
+      int slot = (fdl_head - p + partitions) % partitions;
+      const float *xp = fdl.data() + (ch * partitions + slot) * stride;
+      const float *hp = h + p * stride;
+      for (int k = 0; k < stride; k += 2) {
+        acc[k] += xp[k] * hp[k] - xp[k + 1] * hp[k + 1];
+        acc[k + 1] += xp[k] * hp[k + 1] + xp[k + 1] * hp[k];
+      }
+    }
+
+    for (int k = 0; k < bins; k++) {
+      p_driver->setSpectrumBin(k, acc[k * 2], acc[k * 2 + 1]);
+    }
+    p_driver->rfft();
+    float *out = output.data() + ch * block_size;
+    for (int j = 0; j < block_size; j++) {
+      out[j] = p_driver->getValue(block_size + j);
+    }
+    // keep the current block as history
+    memmove(in, in + block_size, block_size * sizeof(float));
+  }
+
+  /// Transforms the zero padded partitions of the impulse response
+  void setupSpectra(int idx, float scale) {
+    const float *coef = coef_ptr[idx];
+    int len = coef_len[idx];
+    int stride = bins * 2;
+    FFTBin bin;
+    for (int p = 0; p < partitions; p++) {
+      for (int j = 0; j < 2 * block_size; j++) {
+        int n = p * block_size + j;
+        float value = j < block_size && n < len && coef != nullptr ? coef[n] : 0.0f;
+        p_driver->setValue(j, value);
+      }
+      p_driver->fft();
+      float *hp = spectra.data() + (idx * partitions + p) * stride;
+      for (int k = 0; k < bins; k++) {
+        p_driver->getSpectrumBin(k, bin);
+        hp[k * 2] = bin.real * scale;
+        hp[k * 2 + 1] = bin.img * scale;
+      }
+    }
+  }
+
+  /// Determines the gain of fft followed by the reverse fft (which is usually
+  /// not normalized) so that we can compensate it in the spectra
+  float reverseScale() {
+    int len = 2 * block_size;
+    for (int j = 0; j < len; j++) p_driver->setValue(j, j == 0 ? 1.0f : 0.0f);
+    p_driver->fft();
+    FFTBin bin;
+    for (int k = 0; k < bins; k++) {
+      p_driver->getSpectrumBin(k, bin);
+      p_driver->setSpectrumBin(k, bin.real, bin.img);
+    }
+    p_driver->rfft();
+    float result = p_driver->getValue(0);
+    return result == 0.0f ? 1.0f : result;
+  }
+};
+
+}  // namespace audio_tools
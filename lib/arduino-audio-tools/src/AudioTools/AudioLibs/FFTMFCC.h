@@ -0,0 +1,185 @@
+#pragma once
+#include "AudioTools/AudioLibs/AudioFFT.h"
+#include "AudioTools/AudioLibs/FFT/MelFilterBank.h"
+
+namespace audio_tools {
+
+class FFTMFCC;
+
+/**
+ * @brief Configuration for FFTMFCC
+ * @ingroup fft
+ */
+struct FFTMFCCConfig {
+  /// Number of mel filters
+  int mel_bins = 40;
+  /// Number of cepstral coefficients (0 = only provide the log mel energies)
+  int coefficients = 13;
+  /// Lowest frequency of the mel filters
+  float min_freq = 20.0f;
+  /// Highest frequency of the mel filters (0 = sample_rate / 2)
+  float max_freq = 0.0f;
+  /// Added to the mel energy before the log to avoid log(0)
+  float log_floor = 1.0e-6f;
+  /// Callback which is called with each new feature frame (every fft stride)
+  void (*callback)(FFTMFCC &mfcc) = nullptr;
+  /// Optional reference for the callback
+  void *ref = nullptr;
+};
+
+/**
+ * @brief Calculates the log mel energies and the mel frequency cepstral
+ * coefficients (MFCC) from the result of an AudioFFTBase, e.g. as input for
+ * keyword spotting. The mel filters and the DCT are precalculated in
+ * begin(), the filters are applied to the power spectrum (so we do not need
+ * any square root) and the result is provided via callback after each fft,
+ * which is every stride samples.
+ *
+ * This is using the fft callback, so call begin() after the begin() of the
+ * fft: a callback which was defined in the fft config is still called after
+ * the MFCC have been calculated.
+ * @ingroup fft
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FFTMFCC {
+ public:
+  FFTMFCC(AudioFFTBase &fft) { p_fft = &fft; }
+
+  FFTMFCCConfig defaultConfig() {
+    FFTMFCCConfig result;
+    return result;
+  }
+
+  bool begin(FFTMFCCConfig config) {
+    cfg = config;
+    return begin();
+  }
+
+  bool begin() {
+    TRACED();
+    AudioFFTConfig &fft_cfg = p_fft->config();
+    if (cfg.mel_bins <= 0 || cfg.coefficients > cfg.mel_bins) {
+      LOGE("Invalid mel_bins: %d / coefficients: %d", cfg.mel_bins,
+           cfg.coefficients);
+      return false;
+    }
+    if (!setupFilters()) return false;
+    // precalculate the orthonormal DCT-II
+    int n = cfg.mel_bins;
+    dct.resize(cfg.coefficients * n);
+    for (int k = 0; k < cfg.coefficients; k++) {
+      float scale = sqrtf((k == 0 ? 1.0f : 2.0f) / n);
+      for (int m = 0; m < n; m++) {
+        dct[k * n + m] = scale * cosf(PI * k * (m + 0.5f) / n);
+      }
+    }
+    mel.resize(n);
+    mfcc.resize(cfg.coefficients);
+    frame_count = 0;
+    // keep the callback of the user (but not our own from a prior begin)
+    if (fft_cfg.callback != fftCallback) {
+      user_callback = fft_cfg.callback;
+      user_ref = fft_cfg.ref;
+    }
+    fft_cfg.ref = this;
+    fft_cfg.callback = fftCallback;
+    return true;
+  }
+
+  void end() {
+    // restore the callback of the user
+    if (p_fft->config().callback == fftCallback) {
+      p_fft->config().callback = user_callback;
+      p_fft->config().ref = user_ref;
+    }
+    user_callback = nullptr;
+    user_ref = nullptr;
+    filter.end();
+    power.resize(0);
+    dct.resize(0);
+    mel.resize(0);
+    mfcc.resize(0);
+  }
+
+  /// log mel energies of the last frame (size: mel_bins)
+  float *melEnergies() { return mel.data(); }
+
+  /// Cepstral coefficients of the last frame (size: coefficients)
+  float *coefficients() { return mfcc.data(); }
+
+  /// Number of mel bins
+  int melSize() { return cfg.mel_bins; }
+
+  /// Number of coefficients
+  int size() { return cfg.coefficients; }
+
+  /// Number of processed frames
+  uint32_t frameCount() { return frame_count; }
+
+  /// Provides the fft which is used as input
+  AudioFFTBase &fft() { return *p_fft; }
+
+  FFTMFCCConfig &config() { return cfg; }
+
+ protected:
+  AudioFFTBase *p_fft = nullptr;
+  FFTMFCCConfig cfg;
+  MelFilterBank filter;
+  Vector<float> power{0};
+  Vector<float> dct{0};
+  Vector<float> mel{0};
+  Vector<float> mfcc{0};
+  uint32_t frame_count = 0;
+  void (*user_callback)(AudioFFTBase &fft) = nullptr;
+  void *user_ref = nullptr;
+
+  bool setupFilters() {
+    AudioFFTConfig &fft_cfg = p_fft->config();
+    float max_freq =
+        cfg.max_freq > 0.0f ? cfg.max_freq : fft_cfg.sample_rate / 2.0f;
+    if (!filter.begin(cfg.mel_bins, fft_cfg.length, fft_cfg.sample_rate,
+                      cfg.min_freq, max_freq)) {
+      return false;
+    }
+    power.resize(filter.endBin());
+    return true;
+  }
+
+  static void fftCallback(AudioFFTBase &fft) {
+    FFTMFCC *self = (FFTMFCC *)fft.config().ref;
+    self->process();
+    // chain the callback of the user with its own reference
+    if (self->user_callback != nullptr) {
+      fft.config().ref = self->user_ref;
+      self->user_callback(fft);
+      fft.config().ref = self;
+    }
+  }
+
+  void process() {
+    // the sample rate might have changed
+    if (!setupFilters()) return;
+    FFTDriver *driver = p_fft->driver();
+    for (int j = filter.startBin(); j < filter.endBin(); j++) {
+      power[j] = driver->magnitudeFast(j);
+    }
+    filter.process(power.data(), mel.data());
+    int n = cfg.mel_bins;
+    for (int m = 0; m < n; m++) {
+      mel[m] = logf(mel[m] + cfg.log_floor);
+    }
+    for (int k = 0; k < cfg.coefficients; k++) {
+      const float *row = dct.data() + k * n;
+      float sum = 0.0f;
+      for (int m = 0; m < n; m++) {
+        sum += row[m] * mel[m];
+      }
+      mfcc[k] = sum;
+    }
+    frame_count++;
+    if (cfg.callback != nullptr) cfg.callback(*this);
+  }
+};
+
+}  // namespace audio_tools
@@ -27,9 +27,16 @@ class PIDController {
     this->kp = kp;
     this->kd = kd;
     this->ki = ki;
+    reset();
     return true;
   }
 
+  /// Clears the integral and the last error
+  void reset() {
+    integral = 0.0f;
+    preerror = 0.0f;
+  }
+
   // target = desired process value
   // measured = current process value:
   // returns new process value
@@ -53,11 +60,15 @@ class PIDController {
     // Calculate total output
     float output = pout + Iout + dout;
 
-    // Restrict to max/min
-    if (output > max)
+    // Restrict to max/min: we stop the integration while we are saturated
+    // (anti windup)
+    if (output > max) {
       output = max;
-    else if (output < min)
+      if (error > 0) integral -= error * dt;
+    } else if (output < min) {
       output = min;
+      if (error < 0) integral -= error * dt;
+    }
 
     // Save error to previous error
     preerror = error;
@@ -65,6 +76,10 @@ class PIDController {
     return output;
   }
 
+  /// Provides the integral term of the last calculation: in a stable state
+  /// this is the value which compensates a constant disturbance.
+  float integralOutput() { return ki * integral; }
+
  protected:
   float dt = 1.0f;
   float max = 0.0f;
@@ -1,4 +1,81 @@
 #pragma once
 // Forward Error Corrections
 #include "AudioTools/Communication/ReedSolomonFEC.h"
-#include "AudioTools/Communication/HammingFEC.h"
\ No newline at end of file
+#include "AudioTools/Communication/HammingFEC.h"
+#include "AudioTools/CoreAudio/AudioStreams.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Measures the encoding and decoding speed of a FEC stream class
+ * e.g. FECBenchmark<ReedSolomonFEC<223, 32, 4>> benchmark; benchmark.run();
+ * The data is encoded into memory and decoded again, so the result does not
+ * include any transmission. The encoded data is kept in RAM, so use a size
+ * which fits into the available memory.
+ * @ingroup fec
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <class FEC>
+class FECBenchmark {
+ public:
+  /// Encodes and decodes size bytes: returns true if the decoded data is
+  /// identical with the original data
+  bool run(size_t size = 64 * 1024) {
+    // determine the encoded size
+    MemoryStream encoded(size * 3 + 1024, RAM);
+    encoded.begin();
+    uint8_t data[chunk_size];
+    for (int j = 0; j < chunk_size; j++) data[j] = j * 7 + 3;
+
+    FEC encoder(encoded);
+    uint32_t start = micros();
+    for (size_t pos = 0; pos < size; pos += chunk_size) {
+      encoder.write(data, min(size - pos, (size_t)chunk_size));
+    }
+    encode_us = micros() - start;
+    encoded_bytes = encoded.available();
+
+    FEC decoder(encoded);
+    uint8_t result[chunk_size];
+    bool ok = true;
+    decoded_bytes = 0;
+    start = micros();
+    while (true) {
+      size_t len = decoder.readBytes(result, chunk_size);
+      if (len == 0) break;
+      for (size_t j = 0; j < len; j++) {
+        if (result[j] != data[(decoded_bytes + j) % chunk_size]) ok = false;
+      }
+      decoded_bytes += len;
+    }
+    decode_us = micros() - start;
+    LOGI("encode: %.2f MB/s, decode: %.2f MB/s, overhead: %.1f%%",
+         encodeMBs(size), decodeMBs(), overhead(size));
+    return ok && decoded_bytes > 0;
+  }
+
+  /// Encoding throughput in MB/s of the last run
+  float encodeMBs(size_t size) {
+    return encode_us == 0 ? 0.0f : (float)size / encode_us;
+  }
+
+  /// Decoding throughput in MB/s of the last run
+  float decodeMBs() {
+    return decode_us == 0 ? 0.0f : (float)decoded_bytes / decode_us;
+  }
+
+  /// Additional data in % of the original data
+  float overhead(size_t size) {
+    return 100.0f * ((float)encoded_bytes - size) / size;
+  }
+
+ protected:
+  static const int chunk_size = 256;
+  uint32_t encode_us = 0;
+  uint32_t decode_us = 0;
+  size_t encoded_bytes = 0;
+  size_t decoded_bytes = 0;
+};
+
+}  // namespace audio_tools
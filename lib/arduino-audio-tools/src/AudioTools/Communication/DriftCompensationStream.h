@@ -0,0 +1,273 @@
+#pragma once
+#include "AudioTools/AudioLibs/PIDController.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioStreams.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Configuration for the DriftCompensationStream
+ * @ingroup communications
+ */
+struct DriftCompensationConfig : public AudioInfo {
+  DriftCompensationConfig() {
+    sample_rate = 44100;
+    channels = 2;
+    bits_per_sample = 16;
+  }
+  /// Fill level of the source which we try to keep: 0 uses the average level
+  /// which we measure during the first filter_ms after the start.
+  float target_ms = 0.0f;
+  /// Max correction of the sample rate in ppm
+  float max_ppm = 1000.0f;
+  /// Interval (in audio time) in which we update the correction
+  int update_ms = 100;
+  /// Time constant of the low pass filter for the fill level: this removes
+  /// the saw tooth which is caused by the arriving packets
+  int filter_ms = 2000;
+  /// Proportional gain: ppm per ms of fill level error
+  float kp = 100.0f;
+  /// Integral gain: ppm per ms of fill level error and second
+  float ki = 10.0f;
+};
+
+/**
+ * @brief Compensates the clock drift between a sender and a receiver: The
+ * receiver writes the data into a buffer (e.g. a QueueStream, UDPStream in
+ * framed mode or the output of the AudioSyncReader) and the output reads
+ * it with the sample rate of its own clock. If the two clocks differ by a
+ * few ppm, the buffer slowly fills up or runs empty.
+ *
+ * We measure the fill level (available()) of the source, average it over
+ * update_ms and let a PI controller adjust the resampling ratio, so that
+ * the fill level and therefore the latency stays at the target. The
+ * integral part of the controller is the estimated clock offset in ppm.
+ *
+ * The resampler uses a fixed point position with 32 fractional bits and a
+ * cubic hermite interpolation, so that the ratio can be changed in steps
+ * of a fraction of a ppm without any clicks. With the default gains the
+ * loop settles in about 20 seconds.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DriftCompensationStream : public AudioStream {
+ public:
+  DriftCompensationStream() = default;
+
+  /// Constructor with the source (buffer) of the data
+  DriftCompensationStream(Stream &source) { setStream(source); }
+
+  /// Constructor with the source (buffer) of the data
+  DriftCompensationStream(AudioStream &source) {
+    setStream(source);
+    setAudioInfo(source.audioInfo());
+  }
+
+  /// Defines the source (buffer) of the data
+  void setStream(Stream &source) { p_source = &source; }
+
+  DriftCompensationConfig defaultConfig() {
+    DriftCompensationConfig result;
+    if (audioInfo()) result.copyFrom(audioInfo());
+    return result;
+  }
+
+  bool begin(DriftCompensationConfig config) {
+    cfg = config;
+    setAudioInfo(config);
+    return begin();
+  }
+
+  bool begin() override {
+    TRACED();
+    cfg.copyFrom(audioInfo());
+    frame_size = cfg.channels * bytesPerSample();
+    if (p_source == nullptr || frame_size <= 0 || cfg.sample_rate <= 0) {
+      LOGE("Invalid setup");
+      return false;
+    }
+    update_frames = cfg.sample_rate * cfg.update_ms / 1000;
+    pid.begin(cfg.update_ms / 1000.0f, cfg.max_ppm, -cfg.max_ppm, cfg.kp,
+              cfg.ki, 0.0f);
+    target_ms = cfg.target_ms;
+    is_target_defined = target_ms > 0.0f;
+    setCorrection(0.0f);
+    pos = 0;
+    fill_sum = 0;
+    fill_frames = 0;
+    fill_ms = 0.0f;
+    settle_count = 0;
+    // we start with some silence as history for the interpolation
+    work.resize(workCapacity() * frame_size);
+    memset(work.data(), 0, work.size());
+    work_frames = history_frames;
+    return true;
+  }
+
+  /// Provides the resampled data
+  size_t readBytes(uint8_t *data, size_t len) override {
+    if (p_source == nullptr || frame_size == 0) return 0;
+    switch (cfg.bits_per_sample) {
+      case 16:
+        return readT<int16_t>(data, len);
+      case 24:
+        return readT<int24_t>(data, len);
+      case 32:
+        return readT<int32_t>(data, len);
+      default:
+        TRACEE();
+    }
+    return 0;
+  }
+
+  /// Writes the data to the source (buffer)
+  size_t write(const uint8_t *data, size_t len) override {
+    if (p_source == nullptr) return 0;
+    return p_source->write(data, len);
+  }
+
+  int available() override {
+    return p_source == nullptr ? 0 : p_source->available();
+  }
+
+  int availableForWrite() override {
+    return p_source == nullptr ? 0 : p_source->availableForWrite();
+  }
+
+  /// Estimated clock offset of the sender relative to the receiver in ppm:
+  /// this follows the fill level noise, so average it for reporting
+  float ppm() { return pid.integralOutput(); }
+
+  /// Currently applied correction in ppm
+  float correctionPpm() { return correction_ppm; }
+
+  /// Currently applied resampling step size
+  float stepSize() { return 1.0f + correction_ppm * 1.0e-6f; }
+
+  /// Filtered fill level of the source in ms
+  float fillMs() { return fill_ms; }
+
+  /// Fill level which we try to keep in ms
+  float targetMs() { return target_ms; }
+
+ protected:
+  static const int history_frames = 3;
+  static const int input_frames = 512;
+  DriftCompensationConfig cfg;
+  Stream *p_source = nullptr;
+  PIDController pid;
+  Vector<uint8_t> work{0};  // unconsumed input frames
+  int work_frames = 0;
+  int frame_size = 0;
+  uint64_t pos = 0;   // 32.32 fixed point position in work
+  uint64_t step = 0;  // 32.32 fixed point step size
+  float correction_ppm = 0.0f;
+  float target_ms = 0.0f;
+  bool is_target_defined = false;
+  float fill_ms = 0.0f;
+  int settle_count = 0;
+  uint64_t fill_sum = 0;
+  int fill_frames = 0;
+  int update_frames = 0;
+
+  int workCapacity() { return history_frames + input_frames; }
+
+  int bytesPerSample() {
+    return cfg.bits_per_sample == 24 ? sizeof(int24_t)
+                                     : cfg.bits_per_sample / 8;
+  }
+
+  void setCorrection(float ppm) {
+    correction_ppm = ppm;
+    step = (1ull << 32) + (int64_t)(ppm * 1.0e-6 * 4294967296.0);
+  }
+
+  template <typename T>
+  size_t readT(uint8_t *data, size_t len) {
+    const int channels = cfg.channels;
+    T *out = (T *)data;
+    T *work_data = (T *)work.data();
+    int frames_out = len / frame_size;
+    int result = 0;
+    int source_frames = p_source->available() / frame_size;
+    while (result < frames_out) {
+      // we need 4 frames from pos for each output frame
+      uint64_t last = pos + (uint64_t)(frames_out - result - 1) * step;
+      int needed = min((int)(last >> 32) + 4, workCapacity()) - work_frames;
+      int n = 0;
+      if (needed > 0) {
+        n = p_source->readBytes((uint8_t *)(work_data + work_frames * channels),
+                                needed * frame_size) /
+            frame_size;
+        work_frames += n;
+      }
+      int start = result;
+      while (result < frames_out && (int)(pos >> 32) + 3 < work_frames) {
+        float frac = (uint32_t)pos / 4294967296.0f;
+        T *y = work_data + (pos >> 32) * channels;
+        for (int ch = 0; ch < channels; ch++) {
+          out[result * channels + ch] = interpolate<T>(y + ch, channels, frac);
+        }
+        result++;
+        pos += step;
+      }
+      // remove the consumed frames
+      int consumed = pos >> 32;
+      work_frames -= consumed;
+      memmove((void *)work_data, work_data + consumed * channels,
+              work_frames * channels * sizeof(T));
+      pos -= (uint64_t)consumed << 32;
+      if (n == 0 && result == start) break;
+    }
+    updateCorrection(source_frames, result);
+    return result * frame_size;
+  }
+
+  /// Cubic hermite (catmull-rom) interpolation between the 2nd and 3rd frame
+  template <typename T>
+  T interpolate(T *y, int channels, float frac) {
+    float ym1 = y[0];
+    float y0 = y[channels];
+    float y1 = y[2 * channels];
+    float y2 = y[3 * channels];
+    float c1 = 0.5f * (y1 - ym1);
+    float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+    float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+    return NumberConverter::clipT<T>(((c3 * frac + c2) * frac + c1) * frac +
+                                     y0);
+  }
+
+  /// Averages the fill level and updates the correction every update_ms
+  void updateCorrection(int sourceFrames, int frames) {
+    fill_sum += (uint64_t)sourceFrames * frames;
+    fill_frames += frames;
+    if (fill_frames < update_frames || fill_frames == 0) return;
+    float level_ms = 1000.0f * fill_sum / fill_frames / cfg.sample_rate;
+    fill_sum = 0;
+    fill_frames = 0;
+    float alpha = cfg.filter_ms > cfg.update_ms
+                      ? (float)cfg.update_ms / cfg.filter_ms
+                      : 1.0f;
+    if (!is_target_defined) {
+      // we wait for data and use the filtered level after filter_ms as target
+      if (settle_count == 0) {
+        if (level_ms <= 0.0f) return;
+        fill_ms = level_ms;
+      }
+      fill_ms += alpha * (level_ms - fill_ms);
+      if (++settle_count * cfg.update_ms < cfg.filter_ms) return;
+      target_ms = fill_ms;
+      is_target_defined = true;
+      LOGI("target fill level: %d ms", (int)target_ms);
+      return;
+    }
+    fill_ms += alpha * (level_ms - fill_ms);
+    // a too full buffer needs a bigger step size
+    setCorrection(pid.calculate(fill_ms, target_ms));
+    LOGD("fill: %f ms, correction: %f ppm, drift: %f ppm", fill_ms,
+         correction_ppm, ppm());
+  }
+};
+
+}  // namespace audio_tools
@@ -23,8 +23,26 @@ namespace gf {
 
 /* GF tables pre-calculated for 0x11d primitive polynomial */
 
-const uint8_t exp[255] = {
-    0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
+/* exp[i] == exp[i % 255]: the table is extended to 512 entries so that
+ * we can use exp[log[x] + log[y]] w/o any modulo operation */
+const uint8_t exp[512] = {
+    0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
+    0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x3, 0x6, 0xc, 0x18, 0x30, 0x60, 0xc0,
+    0x9d, 0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23,
+    0x46, 0x8c, 0x5, 0xa, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1,
+    0x5f, 0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0xf, 0x1e, 0x3c, 0x78, 0xf0,
+    0xfd, 0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2,
+    0xd9, 0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0xd, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce,
+    0x81, 0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc,
+    0x85, 0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54,
+    0xa8, 0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73,
+    0xe6, 0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff,
+    0xe3, 0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xc8, 0x8d, 0x7, 0xe, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6,
+    0x51, 0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x9,
+    0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0xb, 0x16,
+    0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x1,
+    0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
     0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x3, 0x6, 0xc, 0x18, 0x30, 0x60, 0xc0, 0x9d,
     0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23, 0x46,
     0x8c, 0x5, 0xa, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1, 0x5f,
@@ -39,7 +57,7 @@ const uint8_t exp[255] = {
     0x19, 0x32, 0x64, 0xc8, 0x8d, 0x7, 0xe, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6, 0x51,
     0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x9, 0x12,
     0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0xb, 0x16, 0x2c,
-    0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e
+    0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x1, 0x2
 };
 
 const uint8_t log[256] = {
@@ -91,7 +109,7 @@ inline uint8_t sub(uint8_t x, uint8_t y) {
 inline uint8_t mul(uint16_t x, uint16_t y){
     if (x == 0 || y == 0)
         return 0;
-    return exp[(log[x] + log[y]) % 255];
+    return exp[log[x] + log[y]];
 }
 
 /* @brief Division in Galois Fields
@@ -101,7 +119,7 @@ inline uint8_t mul(uint16_t x, uint16_t y){
 inline uint8_t div(uint8_t x, uint8_t y){
     assert(y != 0);
     if(x == 0) return 0;
-    return exp[(log[x] + 255 - log[y]) % 255];
+    return exp[log[x] + 255 - log[y]];
 }
 
 /* @brief X in power Y w
@@ -120,7 +138,43 @@ inline uint8_t pow(uint8_t x, intmax_t power){
  * @param x - number
  * @return inversion of x */
 inline uint8_t inverse(uint8_t x){
-    return exp[(255 - log[x]) % 255]; /* == div(1, x); */
+    return exp[255 - log[x]]; /* == div(1, x); */
+}
+
+/* @brief Multiplication with a value which is given by its logarithm:
+ * this saves one table lookup if the same value is used multiple times
+ * @param x     - operand
+ * @param log_y - log[y] of the second operand (y != 0)
+ * @return x * y */
+inline uint8_t mul_log(uint8_t x, uint8_t log_y){
+    if (x == 0) return 0;
+    return exp[log[x] + log_y];
+}
+
+/* @brief Multiplication table for a fixed factor: row[x] == x * y
+ * @param y   - factor
+ * @param row - output table with 256 entries */
+inline void mul_table(uint8_t y, uint8_t *row){
+    if (y == 0) {
+        memset(row, 0, 256);
+        return;
+    }
+    for(int x = 0; x < 256; x++){
+        row[x] = mul_log(x, log[y]);
+    }
+}
+
+/* @brief Adds a scaled block: dst[i] ^= src[i] * y
+ * @param dst - destination
+ * @param src - source
+ * @param y   - factor
+ * @param len - number of bytes */
+inline void mul_add(uint8_t *dst, const uint8_t *src, uint8_t y, size_t len){
+    if (y == 0) return;
+    const uint8_t log_y = log[y];
+    for(size_t i = 0; i < len; i++){
+        dst[i] ^= mul_log(src[i], log_y);
+    }
 }
 
 /* ##########################
@@ -66,52 +66,46 @@ public:
      void EncodeBlock(const void* src, void* dst) {
         assert(msg_length + ecc_length < 256);
 
-        /* Generator cache, it dosn't change for one template parameters */
-        static uint8_t generator_cache[ecc_length+1] = {0};
+        /* Generator cache, it dosn't change for one template parameters:
+         * we keep the log of the coefficients, so that each tap of the
+         * shift register is a single table lookup */
+        static uint8_t generator_log[ecc_length] = {0};
+        static bool    generator_zero[ecc_length] = {0};
         static bool    generator_cached = false;
 
-        /* Allocating memory on stack for polynomials storage */
-        uint8_t stack_memory[MSG_CNT * msg_length + POLY_CNT * ecc_length * 2];
-        this->memory = stack_memory;
-
         const uint8_t* src_ptr = (const uint8_t*) src;
         uint8_t* dst_ptr = (uint8_t*) dst;
 
-        Poly *msg_in  = &polynoms[ID_MSG_IN];
-        Poly *msg_out = &polynoms[ID_MSG_OUT];
-        Poly *gen     = &polynoms[ID_GENERATOR];
-
-        // Weird shit, but without resetting msg_in it simply doesn't work
-        msg_in->Reset();
-        msg_out->Reset();
-
-        // Using cached generator or generating new one
-        if(generator_cached) {
-            gen->Set(generator_cache, sizeof(generator_cache));
-        } else {
+        if(!generator_cached) {
+            /* Allocating memory on stack for polynomials storage */
+            uint8_t stack_memory[MSG_CNT * msg_length + POLY_CNT * ecc_length * 2];
+            this->memory = stack_memory;
             GeneratorPoly();
-            memcpy(generator_cache, gen->ptr(), gen->length);
+            Poly *gen = &polynoms[ID_GENERATOR];
+            for(uint8_t j = 0; j < ecc_length; j++) {
+                generator_zero[j] = gen->at(j+1) == 0;
+                generator_log[j] = gf::log[gen->at(j+1)];
+            }
             generator_cached = true;
         }
 
-        // Copying input message to internal polynomial
-        msg_in->Set(src_ptr, msg_length);
-        msg_out->Set(src_ptr, msg_length);
-        msg_out->length = msg_in->length + ecc_length;
-
-        // Here all the magic happens
-        uint8_t coef = 0; // cache
+        // Division by the generator with a linear feedback shift register
+        uint8_t rem[ecc_length] = {0};
         for(uint8_t i = 0; i < msg_length; i++){
-            coef = msg_out->at(i);
+            const uint8_t coef = src_ptr[i] ^ rem[0];
+            memmove(rem, rem + 1, ecc_length - 1);
+            rem[ecc_length - 1] = 0;
             if(coef != 0){
-                for(uint32_t j = 1; j < gen->length; j++){
-                    msg_out->at(i+j) ^= gf::mul(gen->at(j), coef);
+                const uint8_t log_coef = gf::log[coef];
+                for(uint8_t j = 0; j < ecc_length; j++){
+                    if(!generator_zero[j])
+                        rem[j] ^= gf::exp[log_coef + generator_log[j]];
                 }
             }
         }
 
         // Copying ECC to the output buffer
-        memcpy(dst_ptr, msg_out->ptr()+msg_length, ecc_length * sizeof(uint8_t));
+        memcpy(dst_ptr, rem, ecc_length * sizeof(uint8_t));
     }
 
     /* @brief Message encoding
@@ -146,6 +140,16 @@ public:
 
         bool ok;
 
+        /* Fast path: the block is valid if the ecc of the message matches */
+        if(erase_pos == NULL) {
+            uint8_t check[ecc_length];
+            EncodeBlock(src_ptr, check);
+            if(memcmp(check, ecc_ptr, ecc_length) == 0) {
+                memcpy(dst_ptr, src_ptr, msg_length);
+                return 0;
+            }
+        }
+
         /* Allocation memory on stack */
         uint8_t stack_memory[MSG_CNT * msg_length + POLY_CNT * ecc_length * 2];
         this->memory = stack_memory;
@@ -294,8 +298,14 @@ private:
         Poly *synd = &polynoms[ID_SYNDROMES];
         synd->length = ecc_length+1;
         synd->at(0) = 0;
+        /* Horner scheme with the root 2^(i-1) given by its logarithm */
+        const uint8_t *data = msg->ptr();
         for(uint8_t i = 1; i < ecc_length+1; i++){
-            synd->at(i) = gf::poly_eval(msg, gf::pow(2, i-1));
+            uint8_t y = data[0];
+            for(uint8_t j = 1; j < msg->length; j++){
+                y = gf::mul_log(y, i-1) ^ data[j];
+            }
+            synd->at(i) = y;
         }
     }
 
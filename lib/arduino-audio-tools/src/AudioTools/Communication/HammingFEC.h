@@ -1,29 +1,36 @@
 #pragma once
 #include "AudioToolsConfig.h"
 #include "AudioTools/CoreAudio/BaseStream.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdbool.h>
-#include <math.h>
+#include <stdint.h>
 #include <string.h>
 
 namespace audio_tools {
 
 /**
- * @brief Hamming forware error correction. Inspired by
+ * @brief Hamming forward error correction (extended hamming code / SECDED):
+ * each block_t carries the message bits and the parity bits, so we can
+ * correct one wrong bit and detect two wrong bits per block_t. Inspired by
  * https://github.com/nasserkessas/hamming-codes
- * 
- * Hamming<1024,uint16_t> hamming; // block_ts of 1k with block_tsize 16bits = 31.25% redundency
- * 
+ *
+ * HammingFEC<1024,uint16_t> hamming; // 1k message with block_t size 16bits = 31.25% redundancy
+ *
  * Block size (bits)	Redundant bits	Redundancy percentage
- * 4	3	75%
  * 8	4	50%
  * 16	5	31.25%
  * 32	6	18.75%
  * 64	7	10.94%
- * 
+ *
+ * The bit at position i of a block_t is bit i of the codeword: the
+ * parity bits are at position 0 (overall parity) and at the powers of 2.
+ * The message bits are moved into the remaining positions with one
+ * shift per range between two powers of 2 and the parity bits are
+ * calculated with one popcount per parity bit, so we process a whole
+ * word at a time instead of single bits.
  * @ingroup fec
+ * @author Phil Schatzmann
+ * @copyright GPLv3
 */
 
 template <int bytecount, class block_t>
@@ -32,285 +39,186 @@ class HammingFEC : public BaseStream {
     HammingFEC(Stream &stream){
         p_stream = &stream;
         p_print = &stream;
+        setup();
     }
 
     HammingFEC(Print &print){
         p_print = &print;
+        setup();
     }
 
     int availableForWrite() override {
-        return bytecount;
+        return bytecount - raw_len;
     }
-    
+
     size_t write(const uint8_t* data, size_t len)override{
         if (p_print==nullptr) return 0;
-        for (int j=0;j<len;j++){
-            raw.write(data[j]);
-            if(raw.availableForWrite()==0){
-                encode(raw.data(), raw.size());
-                raw.reset();
+        size_t result = 0;
+        while (result < len){
+            int n = min((int)(len - result), bytecount - raw_len);
+            memcpy(raw.data() + raw_len, data + result, n);
+            raw_len += n;
+            result += n;
+            if (raw_len == bytecount){
+                encode();
+                raw_len = 0;
             }
         }
         return len;
     }
 
     int available() override{
-        return bytecount;
+        return raw_pos < raw_len ? raw_len - raw_pos : bytecount;
     }
 
     size_t readBytes(uint8_t* data, size_t len)override{
         if (p_stream==nullptr) return 0;
-        if (encoded.isEmpty()){
-            // read encoded data from surce
-            p_stream->readBytes(encoded.data(), encodedSize());
-            encoded.setAvailable(encodedSize());
-            // decode data
-            if(decode((block_t*)encoded.data(), bytecount)){
-                raw.setAvailable(bytecount);
-            }
-        }
-        return raw.readArray(data, len);
+        if (raw_pos >= raw_len && !readEncoded()) return 0;
+        int n = min((int)len, raw_len - raw_pos);
+        memcpy(data, raw.data() + raw_pos, n);
+        raw_pos += n;
+        return n;
     }
 
-  protected:
-    SingleBuffer<uint8_t> raw{bytecount};
-    SingleBuffer<uint8_t> encoded{encodedSize()};
-    Stream* p_stream = nullptr;
-    Print* p_print = nullptr;
-
-    int getBlocks(){
-        // Amount of bits in a block_t //
-        int bits = sizeof(block_t) * 8;
-
-        // Amount of bits per block_t used to carry the message //
-        int messageBits = bits - log2(bits) - 1;
-
-        // Amount of block_ts needed to encode message //
-        int block_ts = ceil((float) bytecount / messageBits);
-
-        return block_ts;
-    } 
-
-    int encodedSize(){
-        return getBlocks()+1*sizeof(block_t);
-    }
-   
-    int encode(uint8_t *input, int len) {
-
-        // Amount of bits in a block_t //
-        int bits = sizeof(block_t) * 8;
-
-        // Amount of bits per block_t used to carry the message //
-        int messageBits = bits - log2(bits) - 1;
-
-        // Amount of block_ts needed to encode message //
-        int block_ts = ceil((float) len / messageBits);
+    /// Size of the encoded data in bytes
+    static constexpr int encodedSize() { return blockCount() * sizeof(block_t); }
 
-        // Array of encoded block_ts //
-        block_t encoded[block_ts+1];
+    /// Number of corrected single bit errors
+    uint32_t corrected() { return corrected_count; }
 
-        // Loop through each block_t //
-        for (int i = 0; i < block_ts+1; i++) {
+    /// Number of blocks with multiple errors which could not be corrected
+    uint32_t errors() { return error_count; }
 
-            // Final encoded block_t variable //
-            block_t thisBlock = 0;
-            
-            // Amount of "skipped" bits (used for parity) //
-            int skipped = 0;
-
-            // Count of how many bits are "on" //
-            int onCount = 0;
-            
-            // Array of "on" bits //
-            int onList[bits];
-
-            // Loop through each message bit in this block_t to populate final block_t //
-            for (int j = 0; j < bits; j++) {
-
-                // Skip bit if reserved for parity bit //
-                if ((j & (j - 1)) == 0) { // Check if j is a power of two or 0
-                    skipped++;
-                    continue;
-                }
-
-                bool thisBit;
-                
-                if (i != block_ts) {
-
-                    // Current overall bit number //
-                    int currentBit = i*messageBits + (j-skipped);
-                    
-                    // Current uint8_tacter //
-                    int currentChar = currentBit/(sizeof(uint8_t)*8); // int division
-                    
-                    // Value of current bit //
-                    thisBit = currentBit < len*sizeof(uint8_t)*8 ? getCharBit(input[currentChar], currentBit-currentChar*8) : 0;
-                }
-
-                else {
-                    thisBit = getBit(len/8, j-skipped+(sizeof(block_t)*8-messageBits));
-                }
-
-            // If bit is "on", add to onList and onCount //
-                if (thisBit) {
-                    onList[onCount] = j;
-                    onCount++;
-                }
-                
-                // Populate final message block_t //
-                thisBlock = modifyBit(thisBlock, j, thisBit);
-            }
-
-            // Calculate values of parity bits //
-            block_t parityBits = multipleXor(onList, onCount);
-
-            // Loop through skipped bits (parity bits) //
-            for (int k = 1; k < skipped; k++) { // skip bit 0
-
-                // If bit is "on", add to onCount
-                if (getBit(parityBits, sizeof(block_t)*8-skipped+k)) {
-                    onCount++;
-                }
+  protected:
+    static constexpr int bits = sizeof(block_t) * 8;
+    static constexpr int parity_bits =
+        bits == 8 ? 4 : bits == 16 ? 5 : bits == 32 ? 6 : 7;
+    static constexpr int message_bits = bits - parity_bits;
+    static constexpr int blockCount() {
+        return (bytecount * 8 + message_bits - 1) / message_bits;
+    }
+    Vector<uint8_t> raw{0};
+    Vector<block_t> encoded{0};
+    block_t masks[7];
+    int raw_len = 0;
+    int raw_pos = 0;
+    int encoded_len = 0;
+    uint32_t corrected_count = 0;
+    uint32_t error_count = 0;
+    Stream* p_stream = nullptr;
+    Print* p_print = nullptr;
 
-                // Add parity bit to final block_t //
-                thisBlock = modifyBit(thisBlock, (int) pow(2, skipped-k-1) , getBit(parityBits, sizeof(block_t)*8-skipped+k));
+    void setup() {
+        raw.resize(bytecount + 8);  // the bit reader reads ahead
+        encoded.resize(blockCount());
+        // masks[k] selects all positions which are checked by parity bit 2^k
+        for (int k = 0; k < parity_bits - 1; k++){
+            masks[k] = 0;
+            for (int pos = 1; pos < bits; pos++){
+                if (pos & (1 << k)) masks[k] |= (block_t)1 << pos;
             }
-
-            // Add overall parity bit (total parity of onCount) //
-            thisBlock = modifyBit(thisBlock, 0, onCount & 1);
-
-            // Add block_t to encoded block_ts //
-            encoded[i] = thisBlock;
         }
-        
-        // Write encoded message to file /
-        return p_print->write((const uint8_t*)encoded, sizeof(block_t)*block_ts+1);
     }
 
-    bool decode(block_t input[], int len) {
-        uint8_t* output = (uint8_t*)raw.data();
-        
-        // Amount of bits in a block_t //
-        int bits = sizeof(block_t) * 8;
-
-        for (int b = 0; b < (len/sizeof(block_t)); b++) {
-
-            // Count of how many bits are "on" //
-            int onCount = 0;
-            
-            // Array of "on" bits //
-            int onList[bits];
-
-            // Populate onCount and onList //
-            for (int i = 1; i < bits; i++) {
-                getBit(input[b], i);
-                if (getBit(input[b], i)) {
-                    onList[onCount] = i;
-                    onCount++;
-                }
-            }
-
-            // Check for single errors //
-            int errorLoc = multipleXor(onList, onCount);
-
-            if (errorLoc) {
-                
-                // Check for multiple errors //
-                if (!(onCount & 1 ^ getBit(input[b], 0))) { // last bit of onCount (total parity) XOR first bit of block_t (parity bit)
-                    LOGE("\nMore than one error detected. Aborting.\n");
-                    return false;
-                }
-                
-                // Flip error bit //
-                else {
-                    input[b] = toggleBit(input[b], (bits-1) - errorLoc);
-                                    }
-            }
-        }
-
-        // Amount of bits per block_t used to carry the message //
-        int messageBits = bits - log2(bits) - 1;
-
-        int currentBit, currentChar;
-
-        int uint8_ts = 0;
-
-        for (int i = 0; i < len/sizeof(block_t); i++) {
-
-            // Initialise variable to store amount of parity bits passed //
-            int skipped = 0;
-
-            // Loop through each message bit in this block_t to populate final block_t //
-            for (int j = 0; j < bits; j++) {
-
-                // Skip bit if reserved for parity bit //
-                if ((j & (j - 1)) == 0) { // Check if j is a power of two or 0
-                    skipped++;
-                    continue;
-                }
-
-                // Current overall bit number //
-                currentBit = i*messageBits + (j-skipped);
-
-                // Current uint8_tacter //
-                currentChar = currentBit/(sizeof(uint8_t)*8); // int division
-
-                // Value of current bit //
-                bool thisBit = getBit(input[i], j);
-
-                if (i != len/sizeof(block_t)-1) {
-                
-                    // Populate final decoded uint8_tacter //
-                    output[currentChar] = modifyCharBit(output[currentChar], currentBit-currentChar*sizeof(uint8_t)*8, thisBit);
-                }
-
-                else {
-                    uint8_ts = modifyBit(uint8_ts, j-skipped+(sizeof(block_t)*8-messageBits), thisBit);
-                }
+    static int parity(block_t value) {
+        return __builtin_popcountll((uint64_t)value) & 1;
+    }
 
-            }
+    /// Moves the message bits into the positions which are not a power of 2
+    static block_t deposit(uint64_t message) {
+        block_t result = 0;
+        for (int p = 2; p < bits; p <<= 1){
+            int len = p - 1;
+            result |= (block_t)(message & ((1ull << len) - 1)) << (p + 1);
+            message >>= len;
         }
-
-
-        return uint8_ts;
+        return result;
     }
 
-    int multipleXor(int *indicies, int len) {
-        int val = indicies[0];
-        for (int i = 1; i < len; i++) {
-            val = val ^ indicies[i];
+    /// Collects the message bits: inverse of deposit()
+    static uint64_t extract(block_t block) {
+        uint64_t result = 0;
+        int shift = 0;
+        for (int p = 2; p < bits; p <<= 1){
+            int len = p - 1;
+            result |= ((uint64_t)(block >> (p + 1)) & ((1ull << len) - 1)) << shift;
+            shift += len;
         }
-        return val;
+        return result;
     }
 
-    block_t modifyBit(block_t n, int p, bool b) {
-        return ((n & ~(1 << (sizeof(block_t)*8-1-p))) | (b << (sizeof(block_t)*8-1-p)));
+    block_t encodeBlock(uint64_t message) {
+        block_t block = deposit(message);
+        for (int k = 0; k < parity_bits - 1; k++){
+            if (parity(block & masks[k])) block |= (block_t)1 << (1 << k);
+        }
+        return block | (block_t)parity(block);
     }
 
-    uint8_t modifyCharBit(uint8_t n, int p, bool b) {
-        return ((n & ~(1 << (sizeof(uint8_t)*8-1-p))) | (b << (sizeof(uint8_t)*8-1-p)));
+    /// Corrects single bit errors: returns false for multiple errors
+    bool decodeBlock(block_t &block) {
+        int syndrome = 0;
+        for (int k = 0; k < parity_bits - 1; k++){
+            syndrome |= parity(block & masks[k]) << k;
+        }
+        bool odd = parity(block);
+        if (syndrome != 0 && !odd) return false;
+        if (odd) {
+            // single error: position 0 is the overall parity bit
+            block ^= (block_t)1 << syndrome;
+            corrected_count++;
+        }
+        return true;
     }
 
-    bool getBit(block_t b, int i) {
-        return (b << i) & (int) pow(2, (sizeof(block_t)*8-1));
+    /// Reads message_bits bits starting at the indicated bit position
+    uint64_t readBits(const uint8_t *data, int bitPos) {
+        const uint8_t *ptr = data + bitPos / 8;
+        uint64_t value = 0;
+        for (int j = 0; j < 8; j++) value |= (uint64_t)ptr[j] << (8 * j);
+        value >>= bitPos % 8;
+        return value & ((1ull << message_bits) - 1);
     }
 
-    bool getCharBit(uint8_t b, int i) {
-        return (b << i) & (int) pow(2, (sizeof(uint8_t)*8-1));
+    /// Writes message_bits bits starting at the indicated bit position: the
+    /// target must be cleared
+    void writeBits(uint8_t *data, int bitPos, uint64_t value) {
+        uint8_t *ptr = data + bitPos / 8;
+        value <<= bitPos % 8;
+        int bytes = (bitPos % 8 + message_bits + 7) / 8;
+        for (int j = 0; j < bytes; j++) ptr[j] |= value >> (8 * j);
     }
 
-    block_t toggleBit(block_t b, int i) {
-        return b ^ (1 << i);
+    void encode() {
+        memset(raw.data() + bytecount, 0, 8);
+        for (int i = 0; i < blockCount(); i++){
+            encoded[i] = encodeBlock(readBits(raw.data(), i * message_bits));
+        }
+        p_print->write((const uint8_t*)encoded.data(), encodedSize());
     }
 
-    int inList(uint8_t **list, uint8_t *testString, int listLen) {
-        for (int i = 0; i < listLen; i++) {
-            if (strcmp(list[i], testString) == 0) {
-                return i;
+    bool readEncoded() {
+        uint8_t *data = (uint8_t*)encoded.data();
+        while (encoded_len < encodedSize()){
+            int n = p_stream->readBytes(data + encoded_len,
+                                        encodedSize() - encoded_len);
+            if (n <= 0) return false;
+            encoded_len += n;
+        }
+        encoded_len = 0;
+        memset(raw.data(), 0, raw.size());
+        for (int i = 0; i < blockCount(); i++){
+            block_t block = encoded[i];
+            if (!decodeBlock(block)) {
+                error_count++;
+                LOGE("More than one error detected in block %d", i);
             }
+            writeBits(raw.data(), i * message_bits, extract(block));
         }
-        return 0;
+        raw_len = bytecount;
+        raw_pos = 0;
+        return true;
     }
 };
 
-} // ns
\ No newline at end of file
+} // ns
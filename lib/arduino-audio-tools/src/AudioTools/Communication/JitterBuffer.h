@@ -0,0 +1,520 @@
+#pragma once
+#include <math.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioTypes.h"
+
+namespace audio_tools {
+
+/// How missing packets are replaced in the JitterBuffer
+enum class JitterConcealment : uint8_t {
+  /// missing samples are replaced by 0
+  Silence,
+  /// the last packet is repeated with a fade out
+  Repeat,
+  /// the last pitch period is repeated with a fade out
+  Waveform
+};
+
+/**
+ * @brief Configuration for the JitterBuffer: the AudioInfo is used to
+ * convert the timestamps (in frames) to time and for the concealment, which
+ * is only supported for 16 bit PCM data. For encoded data use a
+ * bits_per_sample of 0 and the byte rate as sample_rate: the timestamps are
+ * then the byte positions and gaps are skipped.
+ * @ingroup communications
+ */
+struct JitterBufferConfig : public AudioInfo {
+  JitterBufferConfig() {
+    sample_rate = 44100;
+    channels = 2;
+    bits_per_sample = 16;
+  }
+  /// max number of packets which can be buffered: rounded up to a power of 2
+  /// so that the slots stay valid when the sequence number wraps
+  int max_packets = 32;
+  /// max size of a packet in bytes
+  int max_packet_size = 1500;
+  /// delay which is used until we have a jitter estimate
+  int start_delay_ms = 60;
+  /// lower limit for the adaptive delay
+  int min_delay_ms = 20;
+  /// upper limit for the adaptive delay
+  int max_delay_ms = 300;
+  /// longer gaps are not concealed but skipped
+  int max_conceal_ms = 120;
+  JitterConcealment concealment = JitterConcealment::Waveform;
+};
+
+/**
+ * @brief Adaptive jitter buffer for packets with a sequence number and a
+ * timestamp (in frames) like RTP: The packets are sorted by their sequence
+ * number and are provided with readBytes() after the target delay has been
+ * buffered. The target delay follows the interarrival jitter (RFC 3550) and
+ * is increased after an underrun. If the buffer gets too long, single packets
+ * are dropped.
+ *
+ * Missing packets are concealed by repeating the last pitch period (or the
+ * last packet) with a fade out; packets which arrive after their playout time
+ * are counted as late and dropped. At discontinuities we crossfade.
+ *
+ * All memory is allocated in begin(). The buffer is not thread safe: call
+ * write() and readBytes() from the same task.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class JitterBuffer {
+ public:
+  JitterBuffer() = default;
+
+  JitterBufferConfig defaultConfig() {
+    JitterBufferConfig result;
+    return result;
+  }
+
+  /// Allocates the memory and resets the state
+  bool begin(JitterBufferConfig config) {
+    cfg = config;
+    return begin();
+  }
+
+  bool begin() {
+    TRACED();
+    if (cfg.max_packets <= 0 || cfg.max_packet_size <= 0 ||
+        cfg.sample_rate <= 0) {
+      LOGE("Invalid config");
+      return false;
+    }
+    frame_size = cfg.bits_per_sample > 0
+                     ? cfg.channels * (cfg.bits_per_sample / 8)
+                     : 0;
+    slots = 1;
+    while (slots < cfg.max_packets && slots < 32768) slots <<= 1;
+    packets.resize(slots);
+    storage.resize(slots * cfg.max_packet_size);
+    if (isPCM16()) {
+      int sr = cfg.sample_rate;
+      min_lag = sr / 400;   // 2.5 ms
+      max_lag = sr / 66;    // 15 ms
+      window = sr / 200;    // 5 ms
+      overlap = sr / 1000;  // 1 ms
+      history_frames = max(max_lag + window, cfg.max_packet_size / frame_size);
+      history.resize(history_frames * cfg.channels);
+      pitch.resize(history_frames * cfg.channels);
+      memset(history.data(), 0, history.size() * sizeof(int16_t));
+    }
+    reset();
+    is_active = true;
+    return true;
+  }
+
+  /// Releases the memory
+  void end() {
+    is_active = false;
+    packets.resize(0);
+    storage.resize(0);
+    history.resize(0);
+    pitch.resize(0);
+  }
+
+  /// Restarts with an empty buffer: the statistics are kept
+  void reset() {
+    for (auto &packet : packets) packet.is_valid = false;
+    has_next = false;
+    is_primed = false;
+    has_transit = false;
+    read_pos = 0;
+    conceal_left = 0;
+    xfade_left = 0;
+    history_len = 0;
+    jitter = 0.0f;
+    target_ms = cfg.start_delay_ms;
+  }
+
+  /// Adds a packet which has arrived now
+  bool write(uint16_t seq, uint32_t timestamp, const uint8_t *data,
+             size_t len) {
+    return write(seq, timestamp, data, len, millis());
+  }
+
+  /// Adds a packet with the indicated arrival time: PCM data which is not
+  /// frame aligned is truncated to full frames
+  bool write(uint16_t seq, uint32_t timestamp, const uint8_t *data,
+             size_t len, uint32_t arrivalMs) {
+    if (!is_active || len > (size_t)cfg.max_packet_size) return false;
+    if (frame_size > 0 && len % frame_size != 0) {
+      LOGW("Packet %u not frame aligned: %d bytes", (unsigned)seq, (int)len);
+      len = len / frame_size * frame_size;
+    }
+    if (len == 0) return false;
+    received_count++;
+    uint32_t frames = frame_size > 0 ? len / frame_size : len;
+    if (frames > 0) packet_ms = frames * 1000.0f / cfg.sample_rate;
+    updateJitter(timestamp, arrivalMs);
+    if (!has_next) {
+      next_seq = seq;
+      play_ts = timestamp;
+      end_ts = timestamp;
+      has_next = true;
+    }
+    int16_t diff = seq - next_seq;
+    if (diff < 0 || (diff == 0 && read_pos > 0)) {
+      late_count++;
+      return false;
+    }
+    if (diff >= slots) {
+      LOGW("Packet %u too far ahead: resync", (unsigned)seq);
+      lost_count += diff;
+      reset();
+      return write(seq, timestamp, data, len, arrivalMs);
+    }
+    Packet &packet = packets[seq & (slots - 1)];
+    if (packet.is_valid && packet.seq == seq) return true;  // duplicate
+    packet.seq = seq;
+    packet.timestamp = timestamp;
+    packet.len = len;
+    packet.is_valid = true;
+    memcpy(packetData(packet), data, len);
+    if ((int32_t)(timestamp + frames - end_ts) > 0) end_ts = timestamp + frames;
+    return true;
+  }
+
+  /// Number of bytes which can be read
+  int available() {
+    if (!is_active || !has_next) return 0;
+    if (!is_primed && bufferedMs() < target_ms) return 0;
+    return max(bufferedFrames(), 0) * max(frame_size, 1);
+  }
+
+  /// Provides the data in the order of the sequence numbers
+  size_t readBytes(uint8_t *data, size_t len) {
+    if (!is_active || !has_next) return 0;
+    if (!is_primed) {
+      if (bufferedMs() < target_ms) return 0;
+      is_primed = true;
+    }
+    int fs = max(frame_size, 1);
+    len = len / fs * fs;
+    size_t result = 0;
+    while (result < len) {
+      if (conceal_left > 0) {
+        int frames = min(conceal_left, (int)((len - result) / fs));
+        if (frames == 0) break;
+        fill(data + result, frames);
+        conceal_left -= frames;
+        play_ts += frames;
+        result += frames * fs;
+        if (conceal_left == 0) xfade_left = overlap;
+        continue;
+      }
+      Packet *p_packet = find(next_seq);
+      if (p_packet != nullptr) {
+        if (read_pos == 0 && isTooLong()) {
+          drop(p_packet);
+          continue;
+        }
+        int n = min(p_packet->len - read_pos, (int)(len - result));
+        memcpy(data + result, packetData(*p_packet) + read_pos, n);
+        if (isPCM16()) {
+          int16_t *samples = (int16_t *)(data + result);
+          if (xfade_left > 0) crossfade(samples, n / fs);
+          addHistory(samples, n / fs);
+        }
+        read_pos += n;
+        result += n;
+        play_ts = p_packet->timestamp + read_pos / fs;
+        if (read_pos >= p_packet->len) {
+          p_packet->is_valid = false;
+          next_seq++;
+          read_pos = 0;
+        }
+        continue;
+      }
+      // the next packet is missing
+      Packet *p_later = findLater();
+      if (p_later == nullptr) {
+        if (result == 0) underrun();
+        break;
+      }
+      lost_count += (uint16_t)(p_later->seq - next_seq);
+      next_seq = p_later->seq;
+      read_pos = 0;
+      int32_t gap = p_later->timestamp - play_ts;
+      if (gap > 0 && gap <= maxConcealFrames() && frame_size > 0) {
+        conceal_left = gap;
+        concealed_count += gap;
+        startFill();
+      } else {
+        // discontinuity
+        play_ts = p_later->timestamp;
+        if (isPCM16()) {
+          startFill();
+          xfade_left = overlap;
+        }
+      }
+    }
+    return result;
+  }
+
+  /// Number of received packets
+  uint32_t received() { return received_count; }
+
+  /// Number of packets which arrived after their playout time
+  uint32_t late() { return late_count; }
+
+  /// Number of packets which were missing at their playout time
+  uint32_t lost() { return lost_count; }
+
+  /// Number of frames which were filled by the concealment
+  uint32_t concealed() { return concealed_count; }
+
+  /// Number of packets which were dropped to reduce the delay
+  uint32_t dropped() { return dropped_count; }
+
+  /// Number of times the buffer was empty
+  uint32_t underruns() { return underrun_count; }
+
+  /// Interarrival jitter in ms
+  float jitterMs() { return jitter * 1000.0f / cfg.sample_rate; }
+
+  /// Current target delay in ms
+  float targetDelayMs() { return target_ms; }
+
+  /// Buffered audio in ms
+  float bufferedMs() { return bufferedFrames() * 1000.0f / cfg.sample_rate; }
+
+  /// Returns true after the target delay was reached
+  bool isPrimed() { return is_primed; }
+
+ protected:
+  struct Packet {
+    uint16_t seq = 0;
+    uint32_t timestamp = 0;
+    int len = 0;
+    bool is_valid = false;
+  };
+  JitterBufferConfig cfg;
+  Vector<Packet> packets{0};
+  int slots = 0;  // number of packets: power of 2
+  Vector<uint8_t> storage{0};
+  int frame_size = 0;
+  bool is_active = false;
+  bool is_primed = false;
+  bool has_next = false;
+  uint16_t next_seq = 0;
+  uint32_t play_ts = 0;  // timestamp of the next frame to output
+  uint32_t end_ts = 0;   // end of the latest packet
+  int read_pos = 0;
+  // statistics
+  uint32_t received_count = 0;
+  uint32_t late_count = 0;
+  uint32_t lost_count = 0;
+  uint32_t concealed_count = 0;
+  uint32_t dropped_count = 0;
+  uint32_t underrun_count = 0;
+  // delay
+  bool has_transit = false;
+  int32_t last_transit = 0;
+  float jitter = 0.0f;  // in frames
+  float packet_ms = 0.0f;
+  float target_ms = 60.0f;
+  // concealment
+  Vector<int16_t> history{0};
+  Vector<int16_t> pitch{0};
+  int history_frames = 0;
+  int history_len = 0;
+  int min_lag = 0;
+  int max_lag = 0;
+  int window = 0;
+  int overlap = 0;
+  int fill_lag = 0;
+  int fill_pos = 0;
+  int conceal_left = 0;
+  int xfade_left = 0;
+
+  bool isPCM16() { return cfg.bits_per_sample == 16; }
+
+  uint8_t *packetData(Packet &packet) {
+    return storage.data() + (packet.seq & (slots - 1)) * cfg.max_packet_size;
+  }
+
+  int bufferedFrames() {
+    if (!has_next) return 0;
+    return (int32_t)(end_ts - play_ts) + conceal_left;
+  }
+
+  int maxConcealFrames() {
+    return (int64_t)cfg.max_conceal_ms * cfg.sample_rate / 1000;
+  }
+
+  Packet *find(uint16_t seq) {
+    Packet &packet = packets[seq & (slots - 1)];
+    return packet.is_valid && packet.seq == seq ? &packet : nullptr;
+  }
+
+  /// Finds the next available packet after next_seq
+  Packet *findLater() {
+    for (int j = 1; j < slots; j++) {
+      Packet *p_packet = find(next_seq + j);
+      if (p_packet != nullptr) return p_packet;
+    }
+    return nullptr;
+  }
+
+  /// Interarrival jitter as defined in RFC 3550
+  void updateJitter(uint32_t timestamp, uint32_t arrivalMs) {
+    int32_t arrival = (int64_t)arrivalMs * cfg.sample_rate / 1000;
+    int32_t transit = arrival - (int32_t)timestamp;
+    if (has_transit) {
+      int32_t d = transit - last_transit;
+      if (d < 0) d = -d;
+      jitter += (d - jitter) / 16.0f;
+    }
+    last_transit = transit;
+    has_transit = true;
+    // increase fast, decrease slowly
+    float target = packet_ms + 4.0f * jitterMs();
+    if (target > target_ms) {
+      target_ms = target;
+    } else {
+      target_ms += (target - target_ms) / 256.0f;
+    }
+    limitTarget();
+  }
+
+  void limitTarget() {
+    if (target_ms < cfg.min_delay_ms) target_ms = cfg.min_delay_ms;
+    if (target_ms > cfg.max_delay_ms) target_ms = cfg.max_delay_ms;
+  }
+
+  void underrun() {
+    underrun_count++;
+    is_primed = false;
+    target_ms += packet_ms;
+    limitTarget();
+    LOGI("underrun: target delay %d ms", (int)target_ms);
+  }
+
+  /// The buffer is too long if we have more then 2 packets above the target
+  bool isTooLong() {
+    return bufferedMs() > target_ms + 2 * packet_ms + cfg.min_delay_ms &&
+           find(next_seq + 1) != nullptr;
+  }
+
+  void drop(Packet *p_packet) {
+    dropped_count++;
+    p_packet->is_valid = false;
+    next_seq++;
+    Packet *p_next = find(next_seq);
+    play_ts = p_next->timestamp;
+    if (isPCM16()) {
+      startFill();
+      xfade_left = overlap;
+    }
+  }
+
+  void addHistory(const int16_t *samples, int frames) {
+    int ch = cfg.channels;
+    if (frames >= history_frames) {
+      memcpy(history.data(), samples + (frames - history_frames) * ch,
+             history_frames * ch * sizeof(int16_t));
+    } else {
+      memmove(history.data(), history.data() + frames * ch,
+              (history_frames - frames) * ch * sizeof(int16_t));
+      memcpy(history.data() + (history_frames - frames) * ch, samples,
+             frames * ch * sizeof(int16_t));
+    }
+    history_len = min(history_len + frames, history_frames);
+  }
+
+  /// Determines the period which is repeated and copies it from the history
+  void startFill() {
+    fill_pos = 0;
+    fill_lag = 0;
+    if (!isPCM16() || cfg.concealment == JitterConcealment::Silence) return;
+    if (cfg.concealment == JitterConcealment::Waveform &&
+        history_len >= max_lag + window) {
+      fill_lag = findLag();
+    } else {
+      fill_lag = min(history_len, packet_ms > 0
+                                      ? (int)(packet_ms * cfg.sample_rate / 1000)
+                                      : history_len);
+    }
+    if (fill_lag <= 0) return;
+    int ch = cfg.channels;
+    memcpy(pitch.data(), history.data() + (history_frames - fill_lag) * ch,
+           fill_lag * ch * sizeof(int16_t));
+  }
+
+  /// Finds the lag with the max normalized correlation of the last window
+  int findLag() {
+    int ch = cfg.channels;
+    const int16_t *x = history.data();
+    int end = history_frames;
+    float best = -1.0e30f;
+    int result = max_lag;
+    for (int lag = min_lag; lag <= max_lag; lag++) {
+      float corr = 0.0f;
+      float energy = 1.0f;
+      for (int i = end - window; i < end; i++) {
+        float ref = x[(i - lag) * ch];
+        corr += x[i * ch] * ref;
+        energy += ref * ref;
+      }
+      float score = corr / sqrtf(energy);
+      if (score > best) {
+        best = score;
+        result = lag;
+      }
+    }
+    return result;
+  }
+
+  /// Gain of the concealment: we start to fade out after 10ms and reach 0
+  /// after 60ms
+  float fillGain() {
+    int start = cfg.sample_rate / 100;
+    int len = cfg.sample_rate / 20;
+    if (fill_pos < start) return 1.0f;
+    float gain = 1.0f - (float)(fill_pos - start) / len;
+    return gain > 0.0f ? gain : 0.0f;
+  }
+
+  /// Provides the sample of the indicated channel of the concealment
+  int16_t fillSample(int channel) {
+    if (fill_lag <= 0) return 0;
+    return pitch[(fill_pos % fill_lag) * cfg.channels + channel] * fillGain();
+  }
+
+  /// Provides the next frame of the concealment
+  void nextFill(int16_t *frame) {
+    for (int c = 0; c < cfg.channels; c++) frame[c] = fillSample(c);
+    fill_pos++;
+  }
+
+  void fill(uint8_t *data, int frames) {
+    if (!isPCM16()) {
+      memset(data, 0, frames * frame_size);
+      return;
+    }
+    int16_t *samples = (int16_t *)data;
+    for (int j = 0; j < frames; j++) nextFill(samples + j * cfg.channels);
+    addHistory(samples, frames);
+  }
+
+  /// Fades from the concealment to the received data
+  void crossfade(int16_t *samples, int frames) {
+    int ch = cfg.channels;
+    for (int j = 0; j < frames && xfade_left > 0; j++, xfade_left--) {
+      float w = (float)(overlap - xfade_left) / overlap;
+      for (int c = 0; c < ch; c++) {
+        int16_t &sample = samples[j * ch + c];
+        sample = sample * w + fillSample(c) * (1.0f - w);
+      }
+      fill_pos++;
+    }
+  }
+};
+
+}  // namespace audio_tools
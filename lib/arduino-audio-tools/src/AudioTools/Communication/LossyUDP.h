@@ -0,0 +1,129 @@
+#pragma once
+#include <Udp.h>
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+
+namespace audio_tools {
+
+/**
+ * @brief UDP wrapper which simulates a bad network for testing: outgoing
+ * packets are dropped, duplicated or swapped with the next packet with the
+ * indicated probabilities (in %). Everything else is forwarded to the
+ * wrapped UDP object, e.g.
+ *
+ * WiFiUDP udp; LossyUDP lossy(udp); UDPStream sender(lossy);
+ * lossy.setDropRate(5); sender.setFramed(true); sender.begin(IPAddress(127,0,0,1), 8000);
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class LossyUDP : public UDP {
+ public:
+  LossyUDP(UDP &udp) { p_udp = &udp; }
+
+  /// Probability in % that a packet is not sent
+  void setDropRate(int percent) { drop_rate = percent; }
+
+  /// Probability in % that a packet is sent twice
+  void setDuplicateRate(int percent) { duplicate_rate = percent; }
+
+  /// Probability in % that a packet is sent after the next packet
+  void setReorderRate(int percent) { reorder_rate = percent; }
+
+  /// Number of dropped packets
+  uint32_t dropped() { return dropped_count; }
+
+  uint8_t begin(uint16_t port) override { return p_udp->begin(port); }
+
+  uint8_t beginMulticast(IPAddress ip, uint16_t port) override {
+    return p_udp->beginMulticast(ip, port);
+  }
+
+  void stop() override {
+    held.resize(0);
+    p_udp->stop();
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port) override {
+    remote_ip = ip;
+    remote_port = port;
+    host = nullptr;
+    current.resize(0);
+    return 1;
+  }
+
+  int beginPacket(const char *host, uint16_t port) override {
+    this->host = host;
+    remote_port = port;
+    current.resize(0);
+    return 1;
+  }
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    int pos = current.size();
+    current.resize(pos + len);
+    memcpy(current.data() + pos, data, len);
+    return len;
+  }
+
+  int endPacket() override {
+    if (isHit(drop_rate)) {
+      dropped_count++;
+      return 1;
+    }
+    if (held.size() == 0 && isHit(reorder_rate)) {
+      // send it after the next packet
+      held.resize(current.size());
+      memcpy(held.data(), current.data(), current.size());
+      return 1;
+    }
+    send(current);
+    if (isHit(duplicate_rate)) send(current);
+    if (held.size() > 0) {
+      send(held);
+      held.resize(0);
+    }
+    return 1;
+  }
+
+  int parsePacket() override { return p_udp->parsePacket(); }
+  int available() override { return p_udp->available(); }
+  int read() override { return p_udp->read(); }
+  int read(unsigned char *buffer, size_t len) override {
+    return p_udp->read(buffer, len);
+  }
+  int read(char *buffer, size_t len) override {
+    return p_udp->read(buffer, len);
+  }
+  int peek() override { return p_udp->peek(); }
+  void flush() override { p_udp->flush(); }
+  IPAddress remoteIP() override { return p_udp->remoteIP(); }
+  uint16_t remotePort() override { return p_udp->remotePort(); }
+
+ protected:
+  UDP *p_udp = nullptr;
+  IPAddress remote_ip;
+  const char *host = nullptr;
+  uint16_t remote_port = 0;
+  Vector<uint8_t> current{0};
+  Vector<uint8_t> held{0};
+  int drop_rate = 0;
+  int duplicate_rate = 0;
+  int reorder_rate = 0;
+  uint32_t dropped_count = 0;
+
+  bool isHit(int percent) { return percent > 0 && random(100) < percent; }
+
+  void send(Vector<uint8_t> &data) {
+    if (host != nullptr) {
+      p_udp->beginPacket(host, remote_port);
+    } else {
+      p_udp->beginPacket(remote_ip, remote_port);
+    }
+    p_udp->write(data.data(), data.size());
+    p_udp->endPacket();
+  }
+};
+
+}  // namespace audio_tools
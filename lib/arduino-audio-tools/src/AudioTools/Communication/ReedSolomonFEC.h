@@ -2,69 +2,150 @@
 
 #include "AudioToolsConfig.h"
 #include "AudioTools/CoreAudio/BaseStream.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
 #include "FEC/ReedSolomon/rs.hpp"
 
 namespace audio_tools {
 
 /**
- * @brief Forward error correction using Reed-Solomon: 
- * write is encoding and readBytes does the decoding.
+ * @brief Forward error correction using Reed-Solomon:
+ * write is encoding and readBytes does the decoding. Each codeword
+ * consists of bytecount data bytes and additional_bytes parity bytes, so we
+ * can correct up to additional_bytes/2 wrong bytes per codeword.
+ *
+ * With interleave > 1 we collect that many codewords and send them column
+ * by column, so a burst error of up to interleave * additional_bytes/2
+ * bytes is spread over all codewords and can still be corrected.
+ *
+ * The encoding uses a table driven shift register and the decoding checks
+ * the syndromes with log/antilog tables: only blocks with errors go through
+ * the full error correction.
  * @ingroup fec
  * @author Phil Schatzmann
  * @copyright GPLv3
  **/
-template <int bytecount, int additional_bytes>
+template <int bytecount, int additional_bytes, int interleave = 1>
 class ReedSolomonFEC : public BaseStream {
   public:
 
     ReedSolomonFEC(Stream &stream){
         p_stream = &stream;
         p_print = &stream;
+        setup();
     }
 
     ReedSolomonFEC(Print &print){
         p_print = &print;
+        setup();
     }
 
     int availableForWrite() override {
-        return bytecount;
+        return dataSize() - raw_len;
     }
-    
+
     size_t write(const uint8_t* data, size_t len) override {
         if (p_print==nullptr) return 0;
-        for (int j=0;j<len;j++){
-            raw.write(data[j]);
-            if(raw.availableForWrite()==0){
-                rs.Encode(raw.data(), encoded.data());
-                p_print->write(encoded.data(), bytecount+additional_bytes);
-                raw.reset();
+        size_t result = 0;
+        while (result < len){
+            int n = min((int)(len - result), dataSize() - raw_len);
+            memcpy(raw.data() + raw_len, data + result, n);
+            raw_len += n;
+            result += n;
+            if (raw_len == dataSize()){
+                encodeFrame();
+                raw_len = 0;
             }
         }
         return len;
     }
 
     int available()override {
-        return bytecount;
+        return raw_pos < raw_len ? raw_len - raw_pos : dataSize();
     }
 
     size_t readBytes(uint8_t* data, size_t len) override{
         if (p_stream==nullptr) return 0;
-        if (encoded.isEmpty()){
-            int read_len = bytecount + additional_bytes;
-            p_stream->readBytes(encoded.data(), read_len);
-            encoded.setAvailable(read_len);
-        }
-        return encoded.readArray(data, len);
+        if (raw_pos >= raw_len && !decodeFrame()) return 0;
+        int n = min((int)len, raw_len - raw_pos);
+        memcpy(data, raw.data() + raw_pos, n);
+        raw_pos += n;
+        return n;
     }
 
+    /// Number of codewords which could not be corrected
+    uint32_t errors() { return error_count; }
+
+    /// Number of codewords which were received
+    uint32_t blocks() { return block_count; }
 
   protected:
-    SingleBuffer<uint8_t> raw{bytecount};
-    SingleBuffer<uint8_t> encoded{bytecount+additional_bytes};
+    static const int codeword_size = bytecount + additional_bytes;
+    Vector<uint8_t> raw{0};
+    Vector<uint8_t> encoded{0};
+    Vector<uint8_t> codeword{0};
+    int raw_len = 0;
+    int raw_pos = 0;
+    int encoded_len = 0;
+    uint32_t error_count = 0;
+    uint32_t block_count = 0;
     RS::ReedSolomon<bytecount, additional_bytes> rs;
     Stream* p_stream = nullptr;
     Print* p_print = nullptr;
 
+    void setup() {
+        raw.resize(dataSize());
+        encoded.resize(frameSize());
+        codeword.resize(codeword_size);
+    }
+
+    static int dataSize() { return bytecount * interleave; }
+
+    static int frameSize() { return codeword_size * interleave; }
+
+    void encodeFrame() {
+        if (interleave == 1){
+            rs.Encode(raw.data(), encoded.data());
+        } else {
+            for (int k = 0; k < interleave; k++){
+                rs.Encode(raw.data() + k * bytecount, codeword.data());
+                for (int j = 0; j < codeword_size; j++){
+                    encoded[j * interleave + k] = codeword[j];
+                }
+            }
+        }
+        p_print->write(encoded.data(), frameSize());
+    }
+
+    /// Reads a complete frame and decodes it
+    bool decodeFrame() {
+        while (encoded_len < frameSize()){
+            int n = p_stream->readBytes(encoded.data() + encoded_len,
+                                        frameSize() - encoded_len);
+            if (n <= 0) return false;
+            encoded_len += n;
+        }
+        encoded_len = 0;
+        for (int k = 0; k < interleave; k++){
+            uint8_t *src = encoded.data();
+            if (interleave > 1){
+                for (int j = 0; j < codeword_size; j++){
+                    codeword[j] = encoded[j * interleave + k];
+                }
+                src = codeword.data();
+            }
+            block_count++;
+            if (rs.Decode(src, raw.data() + k * bytecount) != 0){
+                // provide the uncorrected data
+                memcpy(raw.data() + k * bytecount, src, bytecount);
+                error_count++;
+                LOGW("Uncorrectable block %u", (unsigned) block_count);
+            }
+        }
+        raw_len = dataSize();
+        raw_pos = 0;
+        return true;
+    }
+
 };
 
-}
\ No newline at end of file
+}
@@ -6,6 +6,7 @@
 #endif
 #include "AudioTools/CoreAudio/BaseStream.h"
 #include "AudioTools/CoreAudio/Buffers.h"
+#include "AudioTools/Communication/JitterBuffer.h"
 
 namespace audio_tools {
 
@@ -14,6 +15,11 @@ namespace audio_tools {
  * AudioSource and AudioSink. By default the WiFiUDP object is used and we login
  * to wifi if the ssid and password is provided and we are not already
  * connected.
+ *
+ * With setFramed(true) each packet gets a RTP like header with a sequence
+ * number and a timestamp and the receiver passes the packets through a
+ * JitterBuffer which restores the order and conceals lost packets. To test
+ * this on loopback, send via a LossyUDP which drops and reorders packets.
  * @ingroup communications
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -51,6 +57,10 @@ public:
    * of the next package
    */
   int available() override {
+    if (is_framed) {
+      receivePackets();
+      return jitter_buffer.available();
+    }
     int size = p_udp->available();
     // if the curren package is used up we prvide the info for the next
     if (size == 0) {
@@ -102,6 +112,7 @@ public:
   /// Replys will be sent to the initial remote caller
   size_t write(const uint8_t *data, size_t len) override {
     TRACED();
+    if (is_framed) return writeFramed(data, len);
     p_udp->beginPacket(remoteIP(), remotePort());
     size_t result = p_udp->write(data, len);
     p_udp->endPacket();
@@ -111,6 +122,10 @@ public:
   /// Reads bytes using WiFi::readBytes
   size_t readBytes(uint8_t *data, size_t len) override {
     TRACED();
+    if (is_framed) {
+      receivePackets();
+      return jitter_buffer.readBytes(data, len);
+    }
     size_t avail = available();
     size_t bytes_read = 0;
     if (avail > 0) {
@@ -124,6 +139,24 @@ public:
 
   void setPassword(const char *pwd) { this->password = pwd; }
 
+  /// Activates the framing with sequence numbers and timestamps: the
+  /// config defines the audio format and the jitter buffer of the receiver.
+  /// Both sides must use the same setting. Call before begin().
+  bool setFramed(bool flag, JitterBufferConfig cfg = JitterBufferConfig()) {
+    is_framed = flag;
+    if (!flag) {
+      jitter_buffer.end();
+      packet.resize(0);
+      return true;
+    }
+    frame_cfg = cfg;
+    packet.resize(header_size + cfg.max_packet_size);
+    return jitter_buffer.begin(cfg);
+  }
+
+  /// Provides access to the jitter buffer e.g. for the statistics
+  JitterBuffer &jitterBuffer() { return jitter_buffer; }
+
 protected:
   WiFiUDP default_udp;
   UDP *p_udp = &default_udp;
@@ -131,6 +164,85 @@ protected:
   IPAddress remote_address_ext;
   const char *ssid = nullptr;
   const char *password = nullptr;
+  // framing
+  static const int header_size = 12;
+  static const int max_payload = 1480;
+  bool is_framed = false;
+  JitterBufferConfig frame_cfg;
+  JitterBuffer jitter_buffer;
+  Vector<uint8_t> packet{0};
+  uint16_t send_seq = 0;
+  uint32_t send_timestamp = 0;
+  uint32_t ssrc = 0x41554454;  // "AUDT"
+
+  /// Splits the data into frame aligned packets with a RTP header
+  size_t writeFramed(const uint8_t *data, size_t len) {
+    int frame_size = frameSize();
+    int max_len = frame_cfg.max_packet_size < max_payload
+                      ? frame_cfg.max_packet_size
+                      : max_payload;
+    max_len = max_len / frame_size * frame_size;
+    size_t result = 0;
+    while (len - result >= (size_t)frame_size) {
+      int n = min((size_t)max_len, (len - result) / frame_size * frame_size);
+      uint8_t *header = packet.data();
+      header[0] = 0x80;  // version 2
+      header[1] = 96;    // dynamic payload type
+      writeU16(header + 2, send_seq);
+      writeU32(header + 4, send_timestamp);
+      writeU32(header + 8, ssrc);
+      memcpy(header + header_size, data + result, n);
+      p_udp->beginPacket(remoteIP(), remotePort());
+      p_udp->write(header, header_size + n);
+      p_udp->endPacket();
+      send_seq++;
+      send_timestamp += n / frame_size;
+      result += n;
+    }
+    return result;
+  }
+
+  /// Moves all received packets into the jitter buffer
+  void receivePackets() {
+    int size;
+    while ((size = p_udp->parsePacket()) > 0) {
+      int len = p_udp->read(packet.data(), packet.size());
+      if (len <= header_size || (packet[0] & 0xC0) != 0x80 ||
+          (len - header_size) % frameSize() != 0) {
+        LOGW("Invalid packet with %d bytes", size);
+        continue;
+      }
+      uint16_t seq = readU16(packet.data() + 2);
+      uint32_t timestamp = readU32(packet.data() + 4);
+      jitter_buffer.write(seq, timestamp, packet.data() + header_size,
+                          len - header_size);
+    }
+  }
+
+  /// Size of a frame in bytes: 1 for encoded data
+  int frameSize() {
+    return frame_cfg.bits_per_sample > 0
+               ? frame_cfg.channels * frame_cfg.bits_per_sample / 8
+               : 1;
+  }
+
+  static void writeU16(uint8_t *ptr, uint16_t value) {
+    ptr[0] = value >> 8;
+    ptr[1] = value;
+  }
+
+  static void writeU32(uint8_t *ptr, uint32_t value) {
+    writeU16(ptr, value >> 16);
+    writeU16(ptr + 2, value);
+  }
+
+  static uint16_t readU16(const uint8_t *ptr) {
+    return (uint16_t)ptr[0] << 8 | ptr[1];
+  }
+
+  static uint32_t readU32(const uint8_t *ptr) {
+    return (uint32_t)readU16(ptr) << 16 | readU16(ptr + 2);
+  }
 
   void printIP(){
       Serial.print(WiFi.localIP());
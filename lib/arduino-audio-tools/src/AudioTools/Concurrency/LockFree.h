@@ -1,3 +1,5 @@
 #pragma once
 #include "AudioTools/Concurrency/LockFree/QueueLockFree.h"
 #include "AudioTools/Concurrency/LockFree/ListLockFree.h"
+#include "AudioTools/Concurrency/LockFree/RingBufferLockFree.h"
+#include "AudioTools/Concurrency/LockFree/OutputMixerLockFree.h"
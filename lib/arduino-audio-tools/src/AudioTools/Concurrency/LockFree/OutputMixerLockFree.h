@@ -0,0 +1,77 @@
+#pragma once
+#include "AudioTools/Concurrency/LockFree/RingBufferLockFree.h"
+#include "AudioTools/CoreAudio/AudioOutput.h"
+
+namespace audio_tools {
+
+/**
+ * @brief OutputMixer which can be fed concurrently: each input stream is
+ * written by its own producer task with write(idx, data, len) into a
+ * RingBufferLockFree and a single mixer task calls process() to mix the
+ * available data to the final output. So there is no need to write the
+ * inputs in a round robin fashion.
+ * If an input can not deliver data in time while the other inputs are
+ * filling up, it is mixed as silence and the underrunCount() is increased.
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <typename T>
+class OutputMixerLockFree : public OutputMixer<T> {
+ public:
+  OutputMixerLockFree() { setup(); }
+
+  OutputMixerLockFree(Print &finalOutput, int outputStreamCount)
+      : OutputMixer<T>(finalOutput, outputStreamCount) {
+    setup();
+  }
+
+  /// Mixes the available data to the final output: to be called by the
+  /// (single) mixer task. Returns the number of written bytes.
+  size_t process() {
+    if (!this->is_active) return 0;
+    int samples = this->availableSamples();
+    if (samples == 0) {
+      // some inputs are empty: mix the others only when they fill up
+      int max_samples = this->availableSamplesMax();
+      int limit = (this->size_bytes / sizeof(T)) * underrun_percent / 100;
+      if (max_samples > 0 && max_samples >= limit) samples = max_samples;
+    }
+    if (samples == 0) return 0;
+    return this->mix(samples);
+  }
+
+  /// Defines the fill level in % of the other buffers at which an empty input
+  /// is treated as underrun and mixed as silence (default 50)
+  void setUnderrunPercent(int percent) { underrun_percent = percent; }
+
+  /// Not supported: use write(idx, data, len) from the producer tasks
+  size_t write(const uint8_t *data, size_t len) override {
+    LOGE("Use write(idx, data, len)");
+    return 0;
+  }
+
+  /// Write the data for an individual stream idx: to be called by the
+  /// producer task of this input. Returns the number of bytes which fitted
+  /// into the buffer, so the producer can retry the rest later.
+  size_t write(int idx, const uint8_t *data, size_t len) {
+    BaseBuffer<T> *p_buffer = this->getBuffer(idx);
+    if (p_buffer == nullptr) return 0;
+    return p_buffer->writeArray((const T *)data, len / sizeof(T)) * sizeof(T);
+  }
+
+ protected:
+  int underrun_percent = 50;
+
+  void setup() {
+    this->setAutoIndex(false);
+    this->setCreateBufferCallback(create_buffer_lock_free);
+  }
+
+  static BaseBuffer<T> *create_buffer_lock_free(int size) {
+    return new RingBufferLockFree<T>(size / sizeof(T));
+  }
+};
+
+}  // namespace audio_tools
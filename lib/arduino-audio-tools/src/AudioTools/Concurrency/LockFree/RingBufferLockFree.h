@@ -0,0 +1,166 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <cstddef>
+
+#include "AudioTools/CoreAudio/Buffers.h"
+
+#ifndef CACHE_LINE_SIZE
+#  define CACHE_LINE_SIZE 64
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Single producer, single consumer lock free ring buffer. The capacity
+ * is rounded up to a power of 2, so that we can use a mask instead of a
+ * modulo. The read and write positions are atomic and are kept in separate
+ * cache lines. readArray() and writeArray() copy the data with max 2 memcpy.
+ * Only one task is allowed to write and only one task is allowed to read!
+ * @ingroup buffers
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <typename T>
+class RingBufferLockFree : public BaseBuffer<T> {
+ public:
+  RingBufferLockFree(int size = 0, Allocator &allocator = DefaultAllocator) {
+    vector.setAllocator(allocator);
+    resize(size);
+  }
+
+  /// Resizes the buffer to the next power of 2: this is not thread safe!
+  bool resize(int size) override {
+    size_t new_size = 1;
+    while (new_size < (size_t)size) new_size <<= 1;
+    if (size <= 0) new_size = 0;
+    if (new_size != capacity_value) {
+      LOGI("resize: %d", (int)new_size);
+      vector.resize(new_size);
+      capacity_value = new_size;
+      capacity_mask = new_size == 0 ? 0 : new_size - 1;
+    }
+    head_pos.store(0, std::memory_order_relaxed);
+    tail_pos.store(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// reads a single value (consumer)
+  bool read(T &result) override { return readArray(&result, 1) == 1; }
+
+  /// peeks the actual entry from the buffer (consumer)
+  bool peek(T &result) override {
+    size_t tail = tail_pos.load(std::memory_order_relaxed);
+    if (head_pos.load(std::memory_order_acquire) == tail) return false;
+    result = vector.data()[tail & capacity_mask];
+    return true;
+  }
+
+  /// writes a single value (producer)
+  bool write(T data) override { return writeArray(&data, 1) == 1; }
+
+  /// reads multiple values with max 2 memcpy (consumer)
+  int readArray(T data[], int len) override {
+    if (data == nullptr || len <= 0) return 0;
+    size_t tail = tail_pos.load(std::memory_order_relaxed);
+    size_t head = head_pos.load(std::memory_order_acquire);
+    size_t n = min((size_t)len, head - tail);
+    if (n == 0) return 0;
+    size_t idx = tail & capacity_mask;
+    size_t first = min(n, capacity_value - idx);
+    memcpy(data, vector.data() + idx, first * sizeof(T));
+    memcpy(data + first, vector.data(), (n - first) * sizeof(T));
+    tail_pos.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  /// writes multiple values with max 2 memcpy (producer)
+  int writeArray(const T data[], int len) override {
+    if (data == nullptr || len <= 0) return 0;
+    size_t head = head_pos.load(std::memory_order_relaxed);
+    size_t tail = tail_pos.load(std::memory_order_acquire);
+    size_t n = min((size_t)len, capacity_value - (head - tail));
+    if (n == 0) return 0;
+    size_t idx = head & capacity_mask;
+    size_t first = min(n, capacity_value - idx);
+    memcpy(vector.data() + idx, data, first * sizeof(T));
+    memcpy(vector.data(), data + first, (n - first) * sizeof(T));
+    head_pos.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  /// Removes the next len entries w/o copying them (consumer)
+  int clearArray(int len) override {
+    if (len <= 0) return 0;
+    size_t tail = tail_pos.load(std::memory_order_relaxed);
+    size_t head = head_pos.load(std::memory_order_acquire);
+    size_t n = min((size_t)len, head - tail);
+    tail_pos.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  /// Provides the address of the next entry to read (consumer)
+  T *readAddress(int &len) override {
+    size_t tail = tail_pos.load(std::memory_order_relaxed);
+    size_t head = head_pos.load(std::memory_order_acquire);
+    size_t idx = tail & capacity_mask;
+    len = min(head - tail, capacity_value - idx);
+    return vector.data() + idx;
+  }
+
+  /// Provides the address of the next entry to write (producer)
+  T *writeAddress(int &len) override {
+    size_t head = head_pos.load(std::memory_order_relaxed);
+    size_t tail = tail_pos.load(std::memory_order_acquire);
+    size_t idx = head & capacity_mask;
+    len = min(capacity_value - (head - tail), capacity_value - idx);
+    return vector.data() + idx;
+  }
+
+  /// Confirms that len entries have been written via writeAddress() (producer)
+  int commitWrite(int len) override {
+    if (len <= 0) return 0;
+    size_t head = head_pos.load(std::memory_order_relaxed);
+    size_t tail = tail_pos.load(std::memory_order_acquire);
+    size_t n = min((size_t)len, capacity_value - (head - tail));
+    head_pos.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  /// Removes all data: to be called by the consumer
+  void reset() override {
+    tail_pos.store(head_pos.load(std::memory_order_acquire),
+                   std::memory_order_release);
+  }
+
+  /// provides the number of entries that are available to read
+  int available() override {
+    size_t tail = tail_pos.load(std::memory_order_acquire);
+    return head_pos.load(std::memory_order_acquire) - tail;
+  }
+
+  /// provides the number of entries that are available to write
+  int availableForWrite() override { return capacity_value - available(); }
+
+  /// checks if the buffer is full
+  bool isFull() override { return availableForWrite() == 0; }
+
+  /// returns the address of the start of the physical buffer
+  T *address() override { return vector.data(); }
+
+  /// Provides the (power of 2) capacity
+  size_t size() override { return capacity_value; }
+
+ protected:
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_pos{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_pos{0};
+  alignas(CACHE_LINE_SIZE) Vector<T> vector{0};
+  size_t capacity_value = 0;
+  size_t capacity_mask = 0;
+};
+
+}  // namespace audio_tools
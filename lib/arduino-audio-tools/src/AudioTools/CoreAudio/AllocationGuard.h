@@ -0,0 +1,216 @@
+#pragma once
+#include "AudioToolsConfig.h"
+#include "AudioTools/CoreAudio/AudioLogger.h"
+#include "AudioTools/CoreAudio/AudioRuntime.h"
+
+/**
+ * Debug support to verify that the audio processing does not allocate any
+ * memory after begin(): define USE_ALLOCATION_GUARD and call
+ * AllocationGuard::begin() when all objects have been started. Allocations
+ * via an Allocator which happen in a guarded scope (StreamCopy::copyBytes(),
+ * Pipeline::write() and Pipeline::readBytes()) are recorded with their call
+ * site. On the desktop you can define ALLOCATION_GUARD_INTERPOSE in one
+ * translation unit to also record new/delete and (with glibc) malloc.
+ */
+#ifdef USE_ALLOCATION_GUARD
+#include <atomic>
+#include <new>
+#ifdef __GLIBC__
+#include <execinfo.h>
+#endif
+#define ALLOCATION_GUARD_SCOPE() \
+  audio_tools::AllocationGuard::Scope allocation_guard_scope
+#define ALLOCATION_GUARD_CHECK(size) \
+  audio_tools::AllocationGuard::onAllocation(size, __builtin_return_address(0))
+#else
+#define ALLOCATION_GUARD_SCOPE()
+#define ALLOCATION_GUARD_CHECK(size)
+#endif
+
+#ifdef USE_ALLOCATION_GUARD
+
+namespace audio_tools {
+
+/**
+ * @brief Records the memory allocations in the audio processing while it is
+ * active. With begin(true) the processing is stopped on the first
+ * allocation. The recording itself does not allocate any memory.
+ * @ingroup memorymgmt
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocationGuard {
+ public:
+  /// Call site of an allocation
+  struct Site {
+    void *caller = nullptr;
+    size_t max_size = 0;
+    uint32_t count = 0;
+  };
+
+  /// Marks the calling thread as being in the audio processing
+  struct Scope {
+    Scope() { depth()++; }
+    ~Scope() { depth()--; }
+  };
+
+  /// Starts the recording: call after all begin() calls
+  static void begin(bool stopOnAllocation = false) {
+    State &s = state();
+    lock();
+    s.site_count = 0;
+    s.total = 0;
+    unlock();
+    s.is_stop = stopOnAllocation;
+    s.is_active = true;
+  }
+
+  /// Stops the recording
+  static void end() { state().is_active = false; }
+
+  /// Returns true if the recording is active
+  static bool isActive() { return state().is_active; }
+
+  /// Number of recorded allocations
+  static uint32_t count() { return state().total; }
+
+  /// Number of different call sites
+  static int siteCount() { return state().site_count; }
+
+  /// Provides the call site information
+  static Site site(int idx) {
+    lock();
+    Site result = state().sites[idx];
+    unlock();
+    return result;
+  }
+
+  /// Logs the recorded call sites
+  static void report() {
+    LOGI("allocations in audio processing: %u", (unsigned)count());
+    for (int j = 0; j < siteCount(); j++) {
+      Site info = site(j);
+      LOGW("%u allocations of up to %zu bytes from %p", (unsigned)info.count,
+           info.max_size, info.caller);
+#ifdef __GLIBC__
+      // writes directly to stderr w/o allocating memory
+      backtrace_symbols_fd(&info.caller, 1, 2);
+#endif
+    }
+  }
+
+  /// Records the allocation if it happens in a guarded scope
+  static void onAllocation(size_t size, void *caller) {
+    State &s = state();
+    if (!s.is_active || depth() == 0 || inHook()) return;
+    inHook() = true;
+    s.total++;
+    lock();
+    int idx = 0;
+    while (idx < s.site_count && s.sites[idx].caller != caller) idx++;
+    if (idx == s.site_count && idx < max_sites) {
+      s.sites[idx] = Site();
+      s.sites[idx].caller = caller;
+      s.site_count++;
+    }
+    if (idx < s.site_count) {
+      s.sites[idx].count++;
+      if (size > s.sites[idx].max_size) s.sites[idx].max_size = size;
+    }
+    unlock();
+    if (s.is_stop) {
+      LOGE("Allocation of %zu bytes in audio processing from %p", size,
+           caller);
+      stop();
+    }
+    inHook() = false;
+  }
+
+ protected:
+  static const int max_sites = 32;
+  struct State {
+    std::atomic<bool> is_active{false};
+    std::atomic<uint32_t> total{0};
+    std::atomic_flag is_locked = ATOMIC_FLAG_INIT;
+    bool is_stop = false;
+    Site sites[max_sites];
+    int site_count = 0;
+  };
+
+  static State &state() {
+    static State s;
+    return s;
+  }
+
+  static int &depth() {
+    static thread_local int value = 0;
+    return value;
+  }
+
+  static bool &inHook() {
+    static thread_local bool value = false;
+    return value;
+  }
+
+  static void lock() {
+    while (state().is_locked.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+
+  static void unlock() { state().is_locked.clear(std::memory_order_release); }
+};
+
+}  // namespace audio_tools
+
+#ifdef ALLOCATION_GUARD_INTERPOSE
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size) {
+  audio_tools::AllocationGuard::onAllocation(size,
+                                             __builtin_return_address(0));
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+  audio_tools::AllocationGuard::onAllocation(n * size,
+                                             __builtin_return_address(0));
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+  audio_tools::AllocationGuard::onAllocation(size,
+                                             __builtin_return_address(0));
+  return __libc_realloc(ptr, size);
+}
+#define ALLOCATION_GUARD_MALLOC __libc_malloc
+#else
+#define ALLOCATION_GUARD_MALLOC malloc
+#endif
+
+void *operator new(size_t size) {
+  audio_tools::AllocationGuard::onAllocation(size,
+                                             __builtin_return_address(0));
+  void *result = ALLOCATION_GUARD_MALLOC(size == 0 ? 1 : size);
+  if (result == nullptr) throw std::bad_alloc();
+  return result;
+}
+
+void *operator new[](size_t size) {
+  audio_tools::AllocationGuard::onAllocation(size,
+                                             __builtin_return_address(0));
+  void *result = ALLOCATION_GUARD_MALLOC(size == 0 ? 1 : size);
+  if (result == nullptr) throw std::bad_alloc();
+  return result;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+#endif
+#endif
@@ -12,4 +12,5 @@
 #include "AudioTools/CoreAudio/AudioBasic/Collections/QueueFromVector.h"
 #include "AudioTools/CoreAudio/AudioBasic/Collections/BitVector.h"
 #include "AudioTools/CoreAudio/AudioBasic/Collections/Slice.h"
-#include "AudioTools/CoreAudio/AudioBasic/Collections/PriorityQueue.h"
\ No newline at end of file
+#include "AudioTools/CoreAudio/AudioBasic/Collections/PriorityQueue.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/AllocatorRegion.h"
@@ -4,6 +4,7 @@
 #include "AudioToolsConfig.h"
 #include "AudioTools/CoreAudio/AudioLogger.h"
 #include "AudioTools/CoreAudio/AudioRuntime.h"
+#include "AudioTools/CoreAudio/AllocationGuard.h"
 
 namespace audio_tools {
 
@@ -68,6 +69,7 @@ class Allocator {
 
   /// Allocates memory
   virtual void* allocate(size_t size) {
+    ALLOCATION_GUARD_CHECK(size);
     void* result = do_allocate(size);
     if (result == nullptr) {
       LOGE("Allocateation failed for %zu bytes", size);
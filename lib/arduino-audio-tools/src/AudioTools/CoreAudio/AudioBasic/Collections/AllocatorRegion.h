@@ -0,0 +1,326 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Allocator.h"
+#include "AudioTools/CoreAudio/AudioTypes.h"
+#if defined(ESP32) && defined(ARDUINO)
+#include "esp_heap_caps.h"
+#endif
+
+namespace audio_tools {
+
+/// Allocates memory from the heap in internal RAM or PSRAM: if PSRAM is not
+/// available we use the internal RAM. @ingroup memorymgmt
+inline void *allocateHeap(size_t size, MemoryType type) {
+  void *result = nullptr;
+#if defined(ESP32) && defined(ARDUINO)
+  int caps = type == PS_RAM ? MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT
+                            : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  result = heap_caps_malloc(size, caps);
+#elif defined(RP2040) && defined(ARDUINO)
+  if (type == PS_RAM) result = ps_malloc(size);
+#endif
+  if (result == nullptr) result = malloc(size);
+  return result;
+}
+
+/**
+ * @brief Region (arena) allocator: The memory is taken from big chunks with
+ * a simple pointer increment and is only given back to the heap with end().
+ * reset() makes all memory available again in O(1), so objects which are
+ * set up and released together (e.g. the fused stages of a Pipeline) do not
+ * fragment the heap. free() only releases the last allocation: all other
+ * memory stays in use until reset(). So the size of a Vector should be
+ * defined once (e.g. in begin()) and not grow with push_back().
+ *
+ * Allocations with at least externalLimit() bytes are placed in PSRAM and
+ * smaller ones (which are usually accessed more frequently) in internal RAM.
+ * You can also request the memory type explicitly with allocate(size, type).
+ * On the desktop all memory comes from the regular heap.
+ * @ingroup memorymgmt
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocatorRegion : public Allocator {
+ public:
+  AllocatorRegion(size_t chunkSize = 16 * 1024) { chunk_size = chunkSize; }
+
+  ~AllocatorRegion() { end(); }
+
+  using Allocator::allocate;
+
+  /// Allocates memory with the indicated type
+  void *allocate(size_t size, MemoryType type) {
+    void *result = regionAllocate(size, type);
+    if (result == nullptr) {
+      LOGE("Allocation failed for %zu bytes", size);
+      stop();
+    }
+    return result;
+  }
+
+  /// Releases the memory only if it was the last allocation
+  void free(void *memory) override {
+    if (memory == nullptr) return;
+    for (auto &region : regions) {
+      if (memory == region.last && region.current != nullptr) {
+        region.used -= region.current->used - region.last_offset;
+        region.current->used = region.last_offset;
+        region.last = nullptr;
+        return;
+      }
+    }
+  }
+
+  /// Makes all memory available again without releasing it to the heap: the
+  /// objects must not be used any more.
+  void reset() {
+    for (auto &region : regions) {
+      region.current = region.first;
+      if (region.current != nullptr) region.current->used = 0;
+      region.used = 0;
+      region.last = nullptr;
+    }
+  }
+
+  /// Gives all memory back to the heap
+  void end() {
+    for (auto &region : regions) {
+      Chunk *chunk = region.first;
+      while (chunk != nullptr) {
+        Chunk *next = chunk->next;
+        ::free(chunk);
+        chunk = next;
+      }
+      region = Region();
+    }
+  }
+
+  /// Defines the default size of the chunks which are requested from the heap
+  void setChunkSize(size_t size) { chunk_size = size; }
+
+  /// Allocations with at least the indicated size are placed in PSRAM
+  /// (default 1024)
+  void setExternalLimit(size_t bytes) { external_limit = bytes; }
+
+  /// Provides the limit for allocations in PSRAM
+  size_t externalLimit() { return external_limit; }
+
+  /// Number of bytes which are currently allocated
+  size_t used(MemoryType type) { return region(type).used; }
+
+  /// Total number of allocated bytes
+  size_t used() { return used(RAM) + used(PS_RAM); }
+
+  /// Max number of bytes which have been allocated at the same time
+  size_t highWater(MemoryType type) { return region(type).high_water; }
+
+  /// Max number of allocated bytes in RAM and PSRAM
+  size_t highWater() { return highWater(RAM) + highWater(PS_RAM); }
+
+  /// Number of bytes which have been requested from the heap
+  size_t capacity(MemoryType type) { return region(type).capacity; }
+
+  /// Total number of bytes which have been requested from the heap
+  size_t capacity() { return capacity(RAM) + capacity(PS_RAM); }
+
+ protected:
+  /// Header at the start of each chunk
+  struct Chunk {
+    Chunk *next;
+    size_t size;
+    size_t used;
+    uint8_t *data() { return (uint8_t *)this + header_size; }
+  };
+  struct Region {
+    Chunk *first = nullptr;
+    Chunk *current = nullptr;
+    void *last = nullptr;
+    size_t last_offset = 0;
+    size_t used = 0;
+    size_t high_water = 0;
+    size_t capacity = 0;
+  };
+  static const size_t alignment = alignof(max_align_t);
+  static const size_t header_size =
+      (sizeof(Chunk) + alignment - 1) / alignment * alignment;
+  Region regions[2];  // RAM and PS_RAM
+  size_t chunk_size = 16 * 1024;
+  size_t external_limit = 1024;
+
+  Region &region(MemoryType type) { return regions[type == PS_RAM ? 1 : 0]; }
+
+  void *do_allocate(size_t size) override {
+    return regionAllocate(size, size >= external_limit ? PS_RAM : RAM);
+  }
+
+  void *regionAllocate(size_t size, MemoryType type) {
+    if (size == 0) size = 1;
+    size = (size + alignment - 1) / alignment * alignment;
+    Region &reg = region(type);
+    Chunk *chunk = reg.current;
+    // move to the next chunk which was released by reset()
+    while (chunk != nullptr && chunk->size - chunk->used < size &&
+           chunk->next != nullptr && chunk->next->size >= size) {
+      chunk = chunk->next;
+      chunk->used = 0;
+    }
+    if (chunk == nullptr || chunk->size - chunk->used < size) {
+      chunk = addChunk(reg, size, type);
+      if (chunk == nullptr) return nullptr;
+    }
+    reg.current = chunk;
+    reg.last_offset = chunk->used;
+    void *result = chunk->data() + chunk->used;
+    chunk->used += size;
+    reg.last = result;
+    reg.used += size;
+    if (reg.used > reg.high_water) reg.high_water = reg.used;
+    memset(result, 0, size);
+    return result;
+  }
+
+  /// Inserts a new chunk after the current chunk
+  Chunk *addChunk(Region &reg, size_t size, MemoryType type) {
+    size_t len = size > chunk_size ? size : chunk_size;
+    Chunk *chunk = (Chunk *)allocateHeap(header_size + len, type);
+    if (chunk == nullptr) return nullptr;
+    chunk->size = len;
+    chunk->used = 0;
+    if (reg.current == nullptr) {
+      chunk->next = reg.first;
+      reg.first = chunk;
+    } else {
+      chunk->next = reg.current->next;
+      reg.current->next = chunk;
+    }
+    reg.capacity += len;
+    LOGD("New chunk with %zu bytes in %s", len, type == PS_RAM ? "PSRAM" : "RAM");
+    return chunk;
+  }
+};
+
+/**
+ * @brief Pool of memory blocks with a fixed size which are allocated once in
+ * begin(): allocate() and free() just take and return a block in O(1) and
+ * reset() makes all blocks available again. Requests which are bigger than
+ * the block size or which can not be served because all blocks are in use
+ * are passed on to the fallback allocator (by default DefaultAllocator).
+ * @ingroup memorymgmt
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocatorPool : public Allocator {
+ public:
+  AllocatorPool() = default;
+
+  /// Constructor which allocates the blocks
+  AllocatorPool(size_t blockSize, int count, MemoryType type = RAM) {
+    begin(blockSize, count, type);
+  }
+
+  ~AllocatorPool() { end(); }
+
+  /// Allocates count blocks of the indicated size
+  bool begin(size_t blockSize, int count, MemoryType type = RAM) {
+    end();
+    block_size = (max(blockSize, sizeof(void *)) + alignment - 1) / alignment *
+                 alignment;
+    block_count = count;
+    area = (uint8_t *)allocateHeap(block_size * block_count, type);
+    if (area == nullptr) {
+      LOGE("Allocation failed for %d blocks of %zu bytes", count, block_size);
+      block_count = 0;
+      return false;
+    }
+    reset();
+    return true;
+  }
+
+  /// Gives the blocks back to the heap
+  void end() {
+    if (area != nullptr) ::free(area);
+    area = nullptr;
+    block_count = 0;
+    reset();
+  }
+
+  /// Makes all blocks available again: the objects must not be used any more
+  void reset() {
+    free_list = nullptr;
+    next_unused = 0;
+    used_blocks = 0;
+  }
+
+  /// Returns the block to the pool
+  void free(void *memory) override {
+    if (memory == nullptr) return;
+    if (!isInPool(memory)) {
+      p_fallback->free(memory);
+      return;
+    }
+    *(void **)memory = free_list;
+    free_list = memory;
+    used_blocks--;
+  }
+
+  /// Defines the allocator for the requests which can not be served by the
+  /// pool
+  void setFallback(Allocator &allocator) { p_fallback = &allocator; }
+
+  /// Size of a block in bytes
+  size_t blockSize() { return block_size; }
+
+  /// Number of blocks
+  int blockCount() { return block_count; }
+
+  /// Number of blocks which are in use
+  int used() { return used_blocks; }
+
+  /// Max number of blocks which have been in use at the same time
+  int highWater() { return high_water; }
+
+  /// Number of requests which were passed on to the fallback allocator
+  int fallbackCount() { return fallback_count; }
+
+ protected:
+  static const size_t alignment = alignof(max_align_t);
+  uint8_t *area = nullptr;
+  size_t block_size = 0;
+  int block_count = 0;
+  int next_unused = 0;
+  int used_blocks = 0;
+  int high_water = 0;
+  int fallback_count = 0;
+  void *free_list = nullptr;
+  Allocator *p_fallback = &DefaultAllocator;
+
+  bool isInPool(void *memory) {
+    uint8_t *ptr = (uint8_t *)memory;
+    return area != nullptr && ptr >= area && ptr < area + block_size * block_count;
+  }
+
+  void *do_allocate(size_t size) override {
+    void *result = nullptr;
+    if (size <= block_size) {
+      if (free_list != nullptr) {
+        result = free_list;
+        free_list = *(void **)free_list;
+      } else if (next_unused < block_count) {
+        result = area + block_size * next_unused++;
+      }
+    }
+    if (result == nullptr) {
+      LOGD("Pool fallback for %zu bytes", size);
+      fallback_count++;
+      return p_fallback->allocate(size);
+    }
+    used_blocks++;
+    if (used_blocks > high_water) high_water = used_blocks;
+    memset(result, 0, size == 0 ? 1 : size);
+    return result;
+  }
+};
+
+}  // namespace audio_tools
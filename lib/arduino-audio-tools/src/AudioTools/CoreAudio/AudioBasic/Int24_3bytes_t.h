@@ -26,7 +26,7 @@ class int24_3bytes_t  {
   }
 
   int24_3bytes_t(const int16_t &in) {
-    value[2] = in > 0 ? 0 : 0xFF;
+    value[2] = in >= 0 ? 0 : 0xFF;
     value[1] = (in >> 8) & 0xFF;
     value[0] = in & 0xFF;
   }
@@ -87,7 +87,7 @@ class int24_3bytes_t  {
 
   /// Standard Conversion to Int
   int toInt() const {
-    int newInt = ((((int32_t)0xFF & value[0]) << 16) | (((int32_t)0xFF & value[1]) << 8) | ((int32_t)0xFF & value[2]));
+    int newInt = ((((int32_t)0xFF & value[2]) << 16) | (((int32_t)0xFF & value[1]) << 8) | ((int32_t)0xFF & value[0]));
     if ((newInt & 0x00800000) > 0) {
       newInt |= 0xFF000000;
     } else {
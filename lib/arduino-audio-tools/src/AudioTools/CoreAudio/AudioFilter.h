@@ -1,5 +1,6 @@
 #pragma once
 
 #include "AudioTools/CoreAudio/AudioFilter/Filter.h"
+#include "AudioTools/CoreAudio/AudioFilter/BiQuadCascade.h"
 #include "AudioTools/CoreAudio/AudioFilter/Equalizer.h"
 #include "AudioTools/CoreAudio/AudioFilter/MedianFilter.h"
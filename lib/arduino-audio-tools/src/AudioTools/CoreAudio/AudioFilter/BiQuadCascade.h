@@ -0,0 +1,378 @@
+#pragma once
+#include "AudioTools/CoreAudio/AudioFilter/Filter.h"
+#include "AudioTools/CoreAudio/BaseConverter.h"
+#include "AudioTools/CoreAudio/NumberFormatConverter.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Cascade of biquad sections in transposed direct form II which
+ * processes all channels of interleaved audio data in one pass. The
+ * coefficients and states are stored as structure of arrays and the data is
+ * processed in blocks, so that the coefficients and states can be kept in
+ * registers. With multiple sections, up to 8 sections run as parallel lanes
+ * where section n works on sample t-n: so the sections are independent of
+ * each other and their recursions can overlap. A single section processes all
+ * channels as parallel lanes.
+ *
+ * The filter type TF can be float (the samples are processed with their
+ * original value range) or int32_t: in this case the samples are processed as
+ * Q31 values with Q2.30 coefficients, which is the better choice for
+ * processors w/o FPU. Coefficients must be normalized (a0 = 1) and in the
+ * range of -2.0 to 2.0 for int32_t. To give the sections some headroom the
+ * Q31 samples are scaled down by setHeadroom() bits (default 2 = 12 dB) and
+ * all section outputs and states are saturated, so an overload clips instead
+ * of wrapping around.
+ *
+ * @ingroup filter
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T sample type (e.g. int16_t)
+ * @tparam TF filter type: float or int32_t
+ */
+template <typename T, typename TF = float>
+class BiQuadCascade : public BaseConverter {
+ public:
+  BiQuadCascade() = default;
+  BiQuadCascade(int channels, int sections) { begin(channels, sections); }
+
+  /// Allocates the coefficients and states: all sections are pass through
+  bool begin(int channels, int sections) {
+    if (channels <= 0 || sections <= 0) {
+      LOGE("invalid channels %d or sections %d", channels, sections);
+      return false;
+    }
+    this->channels = channels;
+    this->sections = sections;
+    int n = channels * sections;
+    b0.resize(n);
+    b1.resize(n);
+    b2.resize(n);
+    a1.resize(n);
+    a2.resize(n);
+    z1.resize(n);
+    z2.resize(n);
+    work.resize(block_frames * channels);
+    const float pass_b[3] = {1.0f, 0.0f, 0.0f};
+    const float pass_a[2] = {0.0f, 0.0f};
+    for (int s = 0; s < sections; s++) setSection(s, pass_b, pass_a);
+    reset();
+    return true;
+  }
+
+  /// Defines the normalized coefficients of a section for all channels
+  bool setSection(int section, const float (&b)[3], const float (&a)[2]) {
+    bool result = true;
+    for (int ch = 0; ch < channels; ch++) {
+      result = result && setSection(section, ch, b, a);
+    }
+    return result;
+  }
+
+  /// Defines the normalized coefficients of a section for one channel
+  bool setSection(int section, int channel, const float (&b)[3],
+                  const float (&a)[2]) {
+    if (section >= sections || channel >= channels) {
+      LOGE("invalid section %d or channel %d", section, channel);
+      return false;
+    }
+    int idx = section * channels + channel;
+    b0[idx] = toCoef(b[0]);
+    b1[idx] = toCoef(b[1]);
+    b2[idx] = toCoef(b[2]);
+    a1[idx] = toCoef(a[0]);
+    a2[idx] = toCoef(a[1]);
+    return true;
+  }
+
+  /// Copies the coefficients of a BiQuadDF2 filter (e.g. LowPassFilter) to
+  /// a section for all channels
+  bool setSection(int section, BiQuadDF2<float> &filter) {
+    float b[3];
+    float a[2];
+    filter.getCoefficients(b, a);
+    return setSection(section, b, a);
+  }
+
+  /// Clears the filter states
+  void reset() {
+    for (int j = 0; j < z1.size(); j++) {
+      z1[j] = 0;
+      z2[j] = 0;
+    }
+  }
+
+  /// Q31 processing only: scales the input down by the indicated bits, so
+  /// that intermediate results can grow by 2^bits before they saturate
+  void setHeadroom(int bits) {
+    if (bits < 0 || bits > 15) {
+      LOGE("invalid headroom %d", bits);
+      return;
+    }
+    headroom = bits;
+  }
+
+  /// Defines the number of frames which are processed in one block
+  void setBlockFrames(int frames) {
+    block_frames = frames;
+    work.resize(block_frames * channels);
+  }
+
+  /// Filters the interleaved frames in place
+  void process(T *data, int frames) {
+    if (channels == 0) return;
+    while (frames > 0) {
+      int n = MIN(frames, block_frames);
+      toWork(data, n);
+      if (sections > 1) {
+        for (int ch = 0; ch < channels; ch++) {
+          for (int s = 0; s < sections; s += MAX_LANES) {
+            processSections(s, MIN(MAX_LANES, sections - s), ch, n);
+          }
+        }
+      } else {
+        processChannels(0, n);
+      }
+      fromWork(data, n);
+      data += n * channels;
+      frames -= n;
+    }
+  }
+
+  size_t convert(uint8_t *src, size_t size) override {
+    if (channels > 0) process((T *)src, size / sizeof(T) / channels);
+    return size;
+  }
+
+  bool isSizePreserving() override { return true; }
+
+  int getChannels() { return channels; }
+
+  int getSections() { return sections; }
+
+ protected:
+  static const int MAX_LANES = 8;
+  int channels = 0;
+  int sections = 0;
+  int block_frames = 128;
+  int headroom = 2;
+  // structure of arrays: index is section * channels + channel
+  Vector<TF> b0{0};
+  Vector<TF> b1{0};
+  Vector<TF> b2{0};
+  Vector<TF> a1{0};
+  Vector<TF> a2{0};
+  Vector<TF> z1{0};
+  Vector<TF> z2{0};
+  Vector<TF> work{0};
+
+  /// Processes one section for C channels with the states in local variables
+  template <int C>
+  void processLanes(int section, TF *data, int frames) {
+    const int idx = section * C;
+    TF cb0[C], cb1[C], cb2[C], ca1[C], ca2[C], s1[C], s2[C];
+    for (int c = 0; c < C; c++) {
+      cb0[c] = b0[idx + c];
+      cb1[c] = b1[idx + c];
+      cb2[c] = b2[idx + c];
+      ca1[c] = a1[idx + c];
+      ca2[c] = a2[idx + c];
+      s1[c] = z1[idx + c];
+      s2[c] = z2[idx + c];
+    }
+    for (int f = 0; f < frames; f++) {
+      TF *frame = data + f * C;
+      for (int c = 0; c < C; c++) {
+        frame[c] = step(frame[c], cb0[c], cb1[c], cb2[c], ca1[c], ca2[c],
+                        s1[c], s2[c]);
+      }
+    }
+    for (int c = 0; c < C; c++) {
+      z1[idx + c] = s1[c];
+      z2[idx + c] = s2[c];
+    }
+  }
+
+  /// Processes one section with the channels as parallel lanes
+  void processChannels(int section, int frames) {
+    switch (channels) {
+      case 1:
+        processLanes<1>(section, work.data(), frames);
+        break;
+      case 2:
+        processLanes<2>(section, work.data(), frames);
+        break;
+      case 4:
+        processLanes<4>(section, work.data(), frames);
+        break;
+      default:
+        processLanes(section, work.data(), frames);
+        break;
+    }
+  }
+
+  /// Processes count sections of one channel as parallel lanes
+  void processSections(int section, int count, int channel, int frames) {
+    TF *data = work.data();
+    switch (count) {
+      case 1:
+        processSkewed<1>(section, channel, data, frames);
+        break;
+      case 2:
+        processSkewed<2>(section, channel, data, frames);
+        break;
+      case 3:
+        processSkewed<3>(section, channel, data, frames);
+        break;
+      case 4:
+        processSkewed<4>(section, channel, data, frames);
+        break;
+      case 5:
+        processSkewed<5>(section, channel, data, frames);
+        break;
+      case 6:
+        processSkewed<6>(section, channel, data, frames);
+        break;
+      case 7:
+        processSkewed<7>(section, channel, data, frames);
+        break;
+      default:
+        processSkewed<8>(section, channel, data, frames);
+        break;
+    }
+  }
+
+  /// Processes L consecutive sections of one channel: in step k lane i
+  /// filters sample k-i with the output of lane i-1 from the prior step
+  template <int L>
+  void processSkewed(int section, int channel, TF *data, int frames) {
+    TF cb0[L], cb1[L], cb2[L], ca1[L], ca2[L], s1[L], s2[L], carry[L];
+    for (int i = 0; i < L; i++) {
+      int idx = (section + i) * channels + channel;
+      cb0[i] = b0[idx];
+      cb1[i] = b1[idx];
+      cb2[i] = b2[idx];
+      ca1[i] = a1[idx];
+      ca2[i] = a2[idx];
+      s1[i] = z1[idx];
+      s2[i] = z2[idx];
+      carry[i] = 0;
+    }
+    const int stride = channels;
+    TF *in = data + channel;
+    for (int k = 0; k < frames + L - 1; k++) {
+      if (k >= L - 1 && k < frames) {
+        // all lanes are active
+        for (int i = L - 1; i > 0; i--) {
+          carry[i] = step(carry[i - 1], cb0[i], cb1[i], cb2[i], ca1[i],
+                          ca2[i], s1[i], s2[i]);
+        }
+        carry[0] = step(in[k * stride], cb0[0], cb1[0], cb2[0], ca1[0],
+                        ca2[0], s1[0], s2[0]);
+        in[(k - L + 1) * stride] = carry[L - 1];
+      } else {
+        // ramp up and down at the block boundaries
+        for (int i = L - 1; i > 0; i--) {
+          int t = k - i;
+          if (t >= 0 && t < frames) {
+            carry[i] = step(carry[i - 1], cb0[i], cb1[i], cb2[i], ca1[i],
+                            ca2[i], s1[i], s2[i]);
+          }
+        }
+        if (k < frames) {
+          carry[0] = step(in[k * stride], cb0[0], cb1[0], cb2[0], ca1[0],
+                          ca2[0], s1[0], s2[0]);
+        }
+        int t = k - L + 1;
+        if (t >= 0) in[t * stride] = carry[L - 1];
+      }
+    }
+    for (int i = 0; i < L; i++) {
+      int idx = (section + i) * channels + channel;
+      z1[idx] = s1[i];
+      z2[idx] = s2[i];
+    }
+  }
+
+  /// Processes one section for any number of channels
+  void processLanes(int section, TF *data, int frames) {
+    const int idx = section * channels;
+    TF *pb0 = b0.data() + idx, *pb1 = b1.data() + idx, *pb2 = b2.data() + idx;
+    TF *pa1 = a1.data() + idx, *pa2 = a2.data() + idx;
+    TF *pz1 = z1.data() + idx, *pz2 = z2.data() + idx;
+    for (int f = 0; f < frames; f++) {
+      TF *frame = data + f * channels;
+      for (int c = 0; c < channels; c++) {
+        frame[c] = step(frame[c], pb0[c], pb1[c], pb2[c], pa1[c], pa2[c],
+                        pz1[c], pz2[c]);
+      }
+    }
+  }
+
+  /// transposed direct form II in float
+  static inline float step(float x, float b0, float b1, float b2, float a1,
+                           float a2, float &z1, float &z2) {
+    float y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+
+  /// transposed direct form II in Q31 with Q2.30 coefficients
+  static inline int32_t step(int32_t x, int32_t b0, int32_t b1, int32_t b2,
+                             int32_t a1, int32_t a2, int32_t &z1,
+                             int32_t &z2) {
+    int32_t y = saturate((((int64_t)b0 * x) >> 30) + z1);
+    z1 = saturate(((((int64_t)b1 * x) - ((int64_t)a1 * y)) >> 30) + z2);
+    z2 = saturate((((int64_t)b2 * x) - ((int64_t)a2 * y)) >> 30);
+    return y;
+  }
+
+  static inline int32_t saturate(int64_t value) {
+    if (value > 2147483647) return 2147483647;
+    if (value < -2147483647 - 1) return -2147483647 - 1;
+    return (int32_t)value;
+  }
+
+  static TF toCoef(float value) { return toCoef(value, (TF *)nullptr); }
+  static float toCoef(float value, float *) { return value; }
+  static int32_t toCoef(float value, int32_t *) {
+    float result = value * 1073741824.0f;
+    if (result >= 2147483647.0f) {
+      LOGE("coefficient %f out of range", value);
+      return 2147483647;
+    }
+    if (result < -2147483648.0f) {
+      LOGE("coefficient %f out of range", value);
+      return -2147483647 - 1;
+    }
+    return (int32_t)result;
+  }
+
+  void toWork(T *data, int frames) { toWork(data, frames, work.data()); }
+  void toWork(T *data, int frames, float *to) {
+    int n = frames * channels;
+    for (int j = 0; j < n; j++) to[j] = static_cast<float>(data[j]);
+  }
+  void toWork(T *data, int frames, int32_t *to) {
+    int n = frames * channels;
+    for (int j = 0; j < n; j++) {
+      to[j] = NumberFormatTraits<T>::toQ31(data, j) >> headroom;
+    }
+  }
+
+  void fromWork(T *data, int frames) { fromWork(data, frames, work.data()); }
+  void fromWork(T *data, int frames, float *from) {
+    int n = frames * channels;
+    for (int j = 0; j < n; j++) data[j] = NumberConverter::clipT<T>(from[j]);
+  }
+  void fromWork(T *data, int frames, int32_t *from) {
+    int n = frames * channels;
+    for (int j = 0; j < n; j++) {
+      int32_t value = saturate((int64_t)from[j] << headroom);
+      NumberFormatTraits<T>::fromQ31(data, j, value);
+    }
+  }
+};
+
+}  // namespace audio_tools
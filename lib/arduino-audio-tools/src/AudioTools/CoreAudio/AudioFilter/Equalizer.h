@@ -114,6 +114,12 @@ class Equalizer3Bands : public ModifyingStream {
 
   int availableForWrite() override { return p_print->availableForWrite(); }
 
+  bool isInPlace() override { return true; }
+
+  void processInPlace(uint8_t *data, size_t len) override {
+    filterSamples(data, len);
+  }
+
   /// Provides the data from all streams mixed together
   size_t readBytes(uint8_t *data, size_t len) override {
     size_t result = 0;
@@ -54,7 +54,8 @@ class NoFilter : Filter<T> {
  * @brief FIR Filter
  * Converted from
  * https://github.com/sebnil/FIR-filter-Arduino-Library/tree/master/src
- * You can use https://www.arc.id.au/FilterDesign.html to design the filter
+ * You can use https://www.arc.id.au/FilterDesign.html to design the filter.
+ * For long impulse responses use the FFTConvolutionStream instead.
  * @ingroup filter
  * @author Pieter P tttapa  / pschatzmann
  * @copyright GNU General Public License v3.0
@@ -80,7 +81,7 @@ class FIR : public Filter<T> {
     x[i_b] = value;
     T b_terms = 0;
     T *b_shift = &coeff_b[lenB - i_b - 1];
-    for (uint8_t i = 0; i < lenB; i++) {
+    for (uint16_t i = 0; i < lenB; i++) {
       b_terms += b_shift[i] * x[i];
     }
     i_b++;
@@ -99,8 +100,8 @@ class FIR : public Filter<T> {
   }
 
  private:
-  const uint8_t lenB;
-  uint8_t i_b = 0;
+  const uint16_t lenB;
+  uint16_t i_b = 0;
   Vector<T> x;
   Vector<T> coeff_b;
   T factor;
@@ -278,6 +279,15 @@ class BiQuadDF2 : public Filter<T> {
     return y;
   }
 
+  /// Provides the normalized coefficients (a0 = 1)
+  void getCoefficients(T (&b)[3], T (&a)[2]) {
+    b[0] = b_0;
+    b[1] = b_1;
+    b[2] = b_2;
+    a[0] = a_1;
+    a[1] = a_2;
+  }
+
  protected:
   T b_0 = 0;
   T b_1 = 0;
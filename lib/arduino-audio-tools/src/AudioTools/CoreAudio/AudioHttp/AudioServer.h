@@ -496,6 +496,402 @@ class AudioWAVServer : public AudioEncoderServer {
   WAVEncoder &wavEncoder() { return *static_cast<WAVEncoder *>(encoder); }
 };
 
+/**
+ * @brief Ring buffer for the encoded data which is shared by all clients of the
+ * AudioBroadcastServerT: Writing never blocks, so the encoder is never stalled
+ * by a slow client. Each client reads with its own position. Each write of the
+ * encoder is expected to start at a frame boundary: for PCM data we use the
+ * frame size instead. Optionally the first write (e.g. the WAV header) is kept
+ * separately, so that it can be sent to each new client.
+ * @ingroup http
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BroadcastBuffer : public Print {
+ public:
+  /// Defines the size of the ring buffer in bytes
+  void resize(int size, int markCount = 32) {
+    buffer.resize(size);
+    marks.resize(markCount);
+    reset();
+  }
+
+  /// Removes all data: the next write is treated as header if requested
+  void reset() {
+    write_pos = 0;
+    mark_count = 0;
+    header.resize(0);
+    is_header_pending = is_capture_header;
+  }
+
+  /// The first write is stored as header (e.g. for WAV)
+  void setCaptureHeader(bool flag) {
+    is_capture_header = flag;
+    is_header_pending = flag && write_pos == 0;
+  }
+
+  /// Defines the frame size in bytes for PCM data: 0 uses the write boundaries
+  void setFrameSize(int bytes) { frame_size = bytes; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    if (is_header_pending) {
+      header.resize(len);
+      memcpy(header.data(), data, len);
+      is_header_pending = false;
+      return len;
+    }
+    int size = buffer.size();
+    if (size == 0 || len == 0) return len;
+    // remember the frame boundary
+    marks[mark_count % marks.size()] = write_pos;
+    mark_count++;
+    // only the last size bytes survive
+    const uint8_t *src = data;
+    size_t n = len;
+    if (n > (size_t)size) {
+      src += n - size;
+      n = size;
+    }
+    uint64_t pos = write_pos + (len - n);
+    int offset = pos % size;
+    size_t first = n < (size_t)(size - offset) ? n : size - offset;
+    memcpy(buffer.data() + offset, src, first);
+    memcpy(buffer.data(), src + first, n - first);
+    write_pos += len;
+    return len;
+  }
+
+  /// Returns true if the header has been captured or if there is none
+  bool isHeaderAvailable() { return !is_header_pending; }
+
+  /// Provides the captured header
+  Vector<uint8_t> &headerData() { return header; }
+
+  /// Provides the total number of written bytes
+  uint64_t writePosition() { return write_pos; }
+
+  /// Provides the position at which a new (or skipped) client starts
+  uint64_t joinPosition() {
+    uint64_t result = write_pos;
+    // start of the last write
+    if (mark_count > 0) {
+      uint64_t mark = marks[(mark_count - 1) % marks.size()];
+      if (!isOverrun(mark)) result = mark;
+    }
+    if (frame_size > 1) {
+      result -= result % frame_size;
+      if (isOverrun(result)) result += frame_size;
+    }
+    return result;
+  }
+
+  /// Returns true if the data at the position has already been overwritten
+  bool isOverrun(uint64_t pos) { return write_pos - pos > buffer.size(); }
+
+  /// Number of bytes which are available at the position
+  size_t available(uint64_t pos) {
+    return isOverrun(pos) ? 0 : write_pos - pos;
+  }
+
+  /// Provides the continuous data at the position: len is updated with the
+  /// available length
+  const uint8_t *data(uint64_t pos, size_t &len) {
+    int size = buffer.size();
+    int offset = pos % size;
+    size_t max = size - offset;
+    size_t avail = available(pos);
+    if (len > avail) len = avail;
+    if (len > max) len = max;
+    return buffer.data() + offset;
+  }
+
+  /// Provides the size of the ring buffer
+  size_t size() { return buffer.size(); }
+
+ protected:
+  Vector<uint8_t> buffer{0};
+  Vector<uint64_t> marks{0};
+  Vector<uint8_t> header{0};
+  uint64_t write_pos = 0;
+  uint32_t mark_count = 0;
+  int frame_size = 0;
+  bool is_capture_header = false;
+  bool is_header_pending = false;
+};
+
+/**
+ * @brief Webserver which supports multiple listeners: The audio is encoded
+ * only once into a shared BroadcastBuffer and each client is served from its
+ * own read position. Clients which can not keep up are skipped forward to the
+ * next frame boundary (or dropped if setDropSlowClients(true) was called).
+ * New clients receive the header of the encoder (e.g. WAV) and start at a
+ * frame boundary. The HTTP requests are parsed incrementally in doLoop(), so
+ * a slow client does not block the encoder and the other listeners.
+ *
+ * @ingroup http
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <class Client, class Server>
+class AudioBroadcastServerT : public AudioServerT<Client, Server> {
+ public:
+  /**
+   * @brief Construct a new broadcast server
+   * We assume that the WiFi is already connected
+   */
+  AudioBroadcastServerT(AudioEncoder *encoder, int port = 80)
+      : AudioServerT<Client, Server>(port) {
+    this->encoder = encoder;
+  }
+
+  /**
+   * @brief Construct a new broadcast server
+   *
+   * @param network
+   * @param password
+   */
+  AudioBroadcastServerT(AudioEncoder *encoder, const char *network,
+                        const char *password, int port = 80)
+      : AudioServerT<Client, Server>(network, password, port) {
+    this->encoder = encoder;
+  }
+
+  /**
+   * @brief Start the server. You need to be connected to WiFI before calling
+   * this method
+   *
+   * @param in
+   * @param info
+   * @param converter
+   */
+  bool begin(Stream &in, AudioInfo info, BaseConverter *converter = nullptr) {
+    TRACED();
+    this->audio_info = info;
+    this->setConverter(converter);
+    if (broadcast.size() == 0) broadcast.resize(buffer_size);
+    // WAV: the header is sent to each client and we join at a frame
+    bool is_wav = StrView(encoder->mime()).contains("wav");
+    broadcast.setCaptureHeader(is_wav);
+    broadcast.setFrameSize(is_wav ? info.channels * info.bits_per_sample / 8
+                                  : 0);
+    broadcast.reset();
+    encoder->setAudioInfo(info);
+    encoded_stream.setOutput(&broadcast);
+    encoded_stream.setEncoder(encoder);
+    if (!encoded_stream.begin(info)) {
+      LOGE("encoder begin failed");
+      return false;
+    }
+    this->copier.begin(encoded_stream, in);
+    return AudioServerT<Client, Server>::begin(in, encoder->mime());
+  }
+
+  /**
+   * @brief Start the server. You need to be connected to WiFI before calling
+   * this method
+   *
+   * @param in
+   * @param converter
+   */
+  bool begin(AudioStream &in, BaseConverter *converter = nullptr) {
+    return begin(in, in.audioInfo(), converter);
+  }
+
+  /// Add this method to your loop: Returns true while any client is connected
+  bool copy() { return doLoop(); }
+
+  /// Add this method to your loop: Returns true while any client is connected
+  bool doLoop() {
+    // accept new clients
+#if USE_SERVER_ACCEPT
+    Client client = this->server.accept();
+#else
+    Client client = this->server.available();
+#endif
+    if (client && clients.size() >= 2 * max_clients) {
+      LOGW("Too many pending clients");
+      client.stop();
+    } else if (client) {
+      // the request is parsed in the following loops w/o blocking
+      BroadcastClient bc;
+      bc.client = client;
+      bc.timeout = millis() + request_timeout;
+      clients.push_back(bc);
+      LOGI("New Client");
+    }
+    processRequests();
+    removeDisconnectedClients();
+    if (activeClientCount() == 0) return false;
+
+    // encode once
+    if (this->converter_ptr == nullptr) {
+      this->copier.copy();
+    } else {
+      this->copier.copy(*this->converter_ptr);
+    }
+
+    // fan out
+    for (int j = 0; j < clients.size(); j++) {
+      if (clients[j].is_request_done) sendData(clients[j]);
+    }
+    return true;
+  }
+
+  /// Defines the maximum number of concurrent clients
+  void setMaxClients(int count) { max_clients = count; }
+
+  /// Defines the size of the shared buffer for the encoded data: call before
+  /// begin()
+  void setBufferSize(int size) {
+    buffer_size = size;
+    broadcast.resize(size);
+  }
+
+  /// Defines the max number of bytes which are written to a client in one loop
+  void setMaxWriteSize(int size) { max_write_size = size; }
+
+  /// Slow clients are disconnected instead of skipped forward
+  void setDropSlowClients(bool flag) { is_drop_slow_clients = flag; }
+
+  /// Defines the max time in ms a new client can take to send its request
+  void setRequestTimeout(uint32_t ms) { request_timeout = ms; }
+
+  /// Provides the number of connected clients which receive the audio
+  int clientCount() { return activeClientCount(); }
+
+  /// Number of times a client has been skipped forward or dropped
+  uint32_t overrunCount() { return overrun_count; }
+
+  /// Provides the shared buffer
+  BroadcastBuffer &buffer() { return broadcast; }
+
+  /// provides a pointer to the encoder
+  AudioEncoder *audioEncoder() { return encoder; }
+
+ protected:
+  struct BroadcastClient {
+    Client client;
+    uint64_t pos = 0;
+    bool is_header_sent = false;
+    // state of the request parser
+    bool is_request_done = false;
+    int line_len = 0;
+    uint32_t timeout = 0;
+  };
+  Vector<BroadcastClient> clients{0};
+  BroadcastBuffer broadcast;
+  EncodedAudioOutput encoded_stream;
+  AudioInfo audio_info;
+  AudioEncoder *encoder = nullptr;
+  int max_clients = 10;
+  int buffer_size = 32 * 1024;
+  int max_write_size = 1024;
+  uint32_t request_timeout = 5000;
+  bool is_drop_slow_clients = false;
+  uint32_t overrun_count = 0;
+
+  int activeClientCount() {
+    int result = 0;
+    for (int j = 0; j < clients.size(); j++) {
+      if (clients[j].is_request_done) result++;
+    }
+    return result;
+  }
+
+  /// Reads the available request data of the new clients: a client is
+  /// registered for the audio when its request header is complete
+  void processRequests() {
+    for (int j = 0; j < clients.size(); j++) {
+      BroadcastClient &bc = clients[j];
+      if (bc.is_request_done) continue;
+      if ((int32_t)(millis() - bc.timeout) > 0) {
+        LOGW("Request timeout");
+        bc.client.stop();
+        continue;
+      }
+      while (!bc.is_request_done && bc.client.available() > 0) {
+        int c = bc.client.read();
+        if (c == '\n') {
+          // an empty line ends the request header
+          if (bc.line_len == 0) sendReply(bc);
+          bc.line_len = 0;
+        } else if (c != '\r') {
+          bc.line_len++;
+        }
+      }
+    }
+  }
+
+  /// Sends the reply header: the data is sent in doLoop()
+  void sendReply(BroadcastClient &bc) {
+    if (activeClientCount() >= max_clients) {
+      LOGW("Too many clients: %d", activeClientCount());
+      bc.client.println("HTTP/1.1 503 Service Unavailable");
+      bc.client.println();
+      bc.client.stop();
+      return;
+    }
+    bc.client.println("HTTP/1.1 200 OK");
+    if (this->content_type != nullptr) {
+      bc.client.print("Content-type:");
+      bc.client.println(this->content_type);
+    }
+    bc.client.println();
+    bc.is_request_done = true;
+    LOGI("Clients: %d", activeClientCount());
+  }
+
+  void sendData(BroadcastClient &bc) {
+    if (!bc.is_header_sent) {
+      if (!broadcast.isHeaderAvailable()) return;
+      Vector<uint8_t> &header = broadcast.headerData();
+      if (header.size() > 0) bc.client.write(header.data(), header.size());
+      bc.pos = broadcast.joinPosition();
+      bc.is_header_sent = true;
+    }
+    if (broadcast.isOverrun(bc.pos)) {
+      overrun_count++;
+      if (is_drop_slow_clients) {
+        LOGW("Dropping slow client");
+        bc.client.stop();
+        return;
+      }
+      LOGW("Skipping slow client forward");
+      bc.pos = broadcast.joinPosition();
+    }
+    size_t open = broadcast.available(bc.pos);
+    if (open > (size_t)max_write_size) open = max_write_size;
+    while (open > 0) {
+      size_t len = open;
+      const uint8_t *data = broadcast.data(bc.pos, len);
+      size_t written = bc.client.write(data, len);
+      bc.pos += written;
+      open -= written;
+      if (written < len) break;
+    }
+  }
+
+  void removeDisconnectedClients() {
+    for (int j = clients.size() - 1; j >= 0; j--) {
+      if (!clients[j].client.connected()) {
+        clients[j].client.stop();
+        clients.erase(j);
+        LOGI("Clients: %d", clients.size());
+      }
+    }
+  }
+};
+
+#ifdef USE_WIFI
+using AudioBroadcastServer = AudioBroadcastServerT<WiFiClient, WiFiServer>;
+#endif
+
+#ifdef USE_ETHERNET
+using AudioBroadcastServer = AudioBroadcastServerT<EthernetClient, EthernetServer>;
+#endif
+
 }  // namespace audio_tools
 
 #endif
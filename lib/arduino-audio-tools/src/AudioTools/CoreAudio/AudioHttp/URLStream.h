@@ -427,7 +427,7 @@ class URLStream : public AbstractURLStream {
 
 using ICYStream = ICYStreamT<URLStream>;
 
-#if defined(USE_CONCURRENCY)
+#if defined(USE_CONCURRENCY) || defined(USE_STD_CONCURRENCY)
 using URLStreamBuffered = URLStreamBufferedT<URLStream>;
 using ICYStreamBuffered = URLStreamBufferedT<ICYStream>;
 #endif
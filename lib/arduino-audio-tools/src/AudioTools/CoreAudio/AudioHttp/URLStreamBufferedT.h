@@ -1,7 +1,12 @@
 #pragma once
 #include "AudioToolsConfig.h"
+#if defined(USE_CONCURRENCY) || defined(USE_STD_CONCURRENCY)
 #if defined(USE_CONCURRENCY)
 #include "AudioTools/AudioLibs/Concurrency.h"
+#else
+#include <thread>
+#endif
+#include "AudioTools/Concurrency/LockFree/RingBufferLockFree.h"
 #include "AudioTools/CoreAudio/AudioHttp/AbstractURLStream.h"
 #include "AudioTools/CoreAudio/BaseStream.h"
 
@@ -17,6 +22,10 @@
 #define URL_STREAM_BUFFER_COUNT 10
 #endif
 
+#ifndef URL_STREAM_READ_SIZE
+#define URL_STREAM_READ_SIZE 4096
+#endif
+
 #ifndef STACK_SIZE
 #define STACK_SIZE 30000
 #endif
@@ -24,8 +33,14 @@
 namespace audio_tools {
 
 /**
- * @brief A FreeRTOS task is filling the buffer from the indicated stream. Only
- * to be used on the ESP32
+ * @brief A separate task is reading ahead from the indicated stream: we use a
+ * FreeRTOS Task if USE_CONCURRENCY is defined and a std::thread on desktop
+ * builds. The data is read in big chunks directly into a lock free single
+ * producer single consumer buffer. Reading from the source pauses when the
+ * fill level reaches the high watermark and continues when it falls below the
+ * low watermark. When we wait, the data is only provided after the buffer has
+ * been filled up to the high watermark: this is also the case after an
+ * underrun.
  *
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -41,26 +56,58 @@ class BufferedTaskStream : public AudioStream {
 
   ~BufferedTaskStream() {
     TRACEI();
-    stop();
+    end();
   }
 
-  /// Define an explicit the buffer size in bytes
+  /// Define an explicit the buffer size in bytes: (bufferSize * bufferCount)
   void setBufferSize(int bufferSize, int bufferCount) {
-    buffers.resize(bufferSize, bufferCount);
+    buffers.resize(bufferSize * bufferCount);
+  }
+
+  /// Defines the fill levels in % of the buffer size at which reading from
+  /// the source continues (low) and pauses (high)
+  void setWatermarks(int lowPercent, int highPercent) {
+    low_percent = lowPercent;
+    high_percent = highPercent;
   }
 
+  /// Defines the max number of bytes which are read from the source at once
+  void setReadSize(int bytes) { read_size = bytes; }
+
   virtual void begin(bool wait = true) {
     TRACED();
+    // stop a running producer before we reset the buffer
+    end();
+    is_wait = wait;
+    is_paused = false;
+    underrun_count = 0;
+    ready = !wait;
+    source_active = true;
+    buffers.reset();
     active = true;
-    ready = false;
-    task.begin(std::bind(&BufferedTaskStream::processTask, this));
-    if (!wait) ready = true;
+#if defined(USE_CONCURRENCY)
+    task.begin([this]() {
+      busy = true;
+      if (active) processTask();
+      busy = false;
+    });
+#else
+    thread = std::thread([this]() {
+      while (active) processTask();
+    });
+#endif
   }
 
   virtual void end() {
     TRACED();
-    task.end();
     active = false;
+#if defined(USE_CONCURRENCY)
+    // do not suspend the task in the middle of a read
+    while (busy) delay(1);
+    task.end();
+#else
+    if (thread.joinable()) thread.join();
+#endif
     ready = false;
   }
 
@@ -80,15 +127,13 @@ class BufferedTaskStream : public AudioStream {
 
   /// reads a byte - to be avoided
   virtual int read() override {
-    // if (!ready) return -1;
     uint8_t result = 0;
-    if(!buffers.read(result)) return -1;
-    return result;
+    return readBytes(&result, 1) == 1 ? result : -1;
   }
 
   /// peeks a byte - to be avoided
   virtual int peek() override {
-    // if (!ready) return -1;
+    if (!ready) return -1;
     uint8_t result = 0;
     if(!buffers.peek(result)) return -1;
     return result;
@@ -96,55 +141,92 @@ class BufferedTaskStream : public AudioStream {
 
   /// Use this method !!
   virtual size_t readBytes(uint8_t *data, size_t len) override {
-    // if (!ready) return 0;
-    size_t result = 0;
-    result = buffers.readArray(data, len);
+    if (!ready) return 0;
+    size_t result = buffers.readArray(data, len);
+    // we ran dry while the source is still providing data
+    if (result < len && active && source_active) {
+      underrun_count++;
+      if (is_wait) ready = false;
+    }
     LOGD("%s: %zu -> %zu", LOG_METHOD, len, result);
     return result;
   }
 
   /// Returns the available bytes in the buffer: to be avoided
   virtual int available() override {
-    // if (!ready) return 0;
-    int result = 0;
-    result = buffers.available();
-    return result;
+    return ready ? buffers.available() : 0;
   }
 
+  /// Provides the number of buffered bytes
+  int fillLevel() { return buffers.available(); }
+
+  /// Provides the fill level in % of the buffer size
+  int fillPercent() {
+    return buffers.size() == 0 ? 0 : 100 * buffers.available() / buffers.size();
+  }
+
+  /// Number of reads which could not be served completely
+  uint32_t underrunCount() { return underrun_count; }
+
+  /// Returns true if the data is provided to the reader
+  bool isReady() { return ready; }
+
  protected:
   AudioStream *p_stream = nullptr;
-  bool active = false;
+  std::atomic<bool> active{false};
+  std::atomic<bool> ready{false};
+  std::atomic<uint32_t> underrun_count{0};
+  // the source is only accessed by the producer
+  std::atomic<bool> source_active{false};
+#if defined(USE_CONCURRENCY)
+  std::atomic<bool> busy{false};
   Task task{"BufferedTaskStream", STACK_SIZE, URL_STREAM_PRIORITY,
             URL_STREAM_CORE};
-  SynchronizedNBuffer buffers{DEFAULT_BUFFER_SIZE, URL_STREAM_BUFFER_COUNT};
-  bool ready = false;
-
+#else
+  std::thread thread;
+#endif
+  RingBufferLockFree<uint8_t> buffers{DEFAULT_BUFFER_SIZE *
+                                      URL_STREAM_BUFFER_COUNT};
+  int read_size = URL_STREAM_READ_SIZE;
+  int low_percent = 50;
+  int high_percent = 100;
+  bool is_wait = true;
+  bool is_paused = false;
+
+  /// Reads the next chunk directly into the buffer (producer)
   void processTask() {
-    size_t available_to_write = this->buffers.availableForWrite();
-    if (*(this->p_stream) && available_to_write > 0) {
-      size_t to_read = min(available_to_write, (size_t)512);
-      uint8_t buffer[to_read];
-      size_t avail_read = this->p_stream->readBytes((uint8_t *)buffer, to_read);
-      size_t written = this->buffers.writeArray(buffer, avail_read);
-
-      if (written != avail_read) {
-        LOGE("DATA Lost! %zu reqested, %zu written!", avail_read, written);
-      }
-
-    } else {
-      // 3ms at 44100 stereo is about 529.2 bytes
-      delay(3);
+    int fill = buffers.available();
+    int size = buffers.size();
+    int high = size * high_percent / 100;
+    int low = size * low_percent / 100;
+    if (fill >= high) {
+      is_paused = true;
+      ready = true;
+    } else if (fill < low) {
+      is_paused = false;
     }
-    // buffer is full we start to provide data
-    if (available_to_write == 0) {
-      this->ready = true;
+
+    bool is_source_active = *p_stream;
+    source_active = is_source_active;
+    // provide the remaining data when the source has ended
+    if (!is_source_active) ready = true;
+
+    int len = 0;
+    uint8_t *ptr = buffers.writeAddress(len);
+    if (!is_paused && is_source_active && len > 0) {
+      if (len > read_size) len = read_size;
+      size_t avail_read = p_stream->readBytes(ptr, len);
+      buffers.commitWrite(avail_read);
+      if (avail_read > 0) return;
     }
+    // 3ms at 44100 stereo is about 529.2 bytes
+    delay(3);
   }
 };
 
 /**
- * @brief URLStream implementation for the ESP32 based on a separate FreeRTOS
- * task: the
+ * @brief URLStream implementation which reads ahead in a separate FreeRTOS
+ * task or thread (see BufferedTaskStream)
  * @ingroup http
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -184,10 +266,26 @@ class URLStreamBufferedT : public AbstractURLStream {
     taskStream.setBufferSize(bufferSize, bufferCount);
   }
 
+  /// Defines the fill levels in % at which reading continues and pauses
+  void setWatermarks(int lowPercent, int highPercent) {
+    taskStream.setWatermarks(lowPercent, highPercent);
+  }
+
+  /// Provides the number of buffered bytes
+  int fillLevel() { return taskStream.fillLevel(); }
+
+  /// Provides the fill level in % of the buffer size
+  int fillPercent() { return taskStream.fillPercent(); }
+
+  /// Number of reads which could not be served completely
+  uint32_t underrunCount() { return taskStream.underrunCount(); }
+
   bool begin(const char *urlStr, const char *acceptMime = nullptr,
              MethodID action = GET, const char *reqMime = "",
              const char *reqData = "") {
     TRACED();
+    // stop the reader task: it must not access the stream while it is restarted
+    taskStream.end();
     // start real stream
     bool result = urlStream.begin(urlStr, acceptMime, action, reqMime, reqData);
     // start buffer task
@@ -51,18 +51,10 @@ class TransformationReader {
     result_queue.begin();
   }
 
-
-  size_t readBytes(uint8_t *data, size_t len) {
-    LOGD("TransformationReader::readBytes: %d", (int)len);
-    if (!active) {
-      LOGE("inactive");
-      return 0;
-    }
-    if (p_stream == nullptr) {
-      LOGE("p_stream is NULL");
-      return 0;
-    }
-
+  /// Allocates the buffers for reads of up to the indicated number of bytes
+  /// (if they have not been defined yet), so that readBytes() does not need to
+  /// allocate any memory
+  void preallocate(int len) {
     // we read half the necessary bytes
     if (buffer.size() == 0) {
       int size = (0.5f / p_transform->getByteFactor() * len);
@@ -79,6 +71,23 @@ class TransformationReader {
       result_queue_buffer.resize(rb_size);
       result_queue.begin();
     }
+  }
+
+
+  size_t readBytes(uint8_t *data, size_t len) {
+    LOGD("TransformationReader::readBytes: %d", (int)len);
+    if (!active) {
+      LOGE("inactive");
+      return 0;
+    }
+    if (p_stream == nullptr) {
+      LOGE("p_stream is NULL");
+      return 0;
+    }
+
+    preallocate(len);
+    // we can not provide more than the queue can hold
+    if (len > result_queue_buffer.size()) len = result_queue_buffer.size();
 
     if (result_queue.available() < len) {
       Print *tmp = setupOutput();
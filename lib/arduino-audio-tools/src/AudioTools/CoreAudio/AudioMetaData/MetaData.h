@@ -7,6 +7,7 @@
 #include "AudioTools/CoreAudio/AudioMetaData/MetaDataFilter.h"
 #include "MetaDataICY.h"
 #include "MetaDataID3.h"
+#include "MetaDataGapless.h"
 
 /** 
  * @defgroup metadata Metadata
@@ -0,0 +1,417 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "AudioToolsConfig.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
+#include "AudioTools/CoreAudio/AudioLogger.h"
+#include "MetaDataID3.h"
+#ifndef __AVR__
+#include "AudioTools/AudioCodecs/MP4Parser.h"
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Determines the gapless playback information (encoder delay, padding
+ * and number of valid samples) from an encoded file: We support the LAME/Info
+ * tag of mp3 files and the iTunSMPB comment which is used by iTunes in the ID3
+ * tag of mp3 files and in the ilst atom of m4a files. Just write the encoded
+ * data from the start of the file to this class.
+ *
+ * The frames of the ID3v2 tag are walked by their size and the m4a atoms are
+ * processed with the MP4Parser, so the information is found wherever it is
+ * located. If the moov atom is stored after the audio data, it is only
+ * available after the whole file has been written.
+ * @ingroup metadata
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MetaDataGapless {
+  public:
+    MetaDataGapless() { setupParser(); }
+
+    /// (Re)starts the parsing for a new file
+    void begin() {
+        total = 0;
+        format = Unknown;
+        tag_end = 0;
+        id3_next = 0;
+        id3_version = 0;
+        id3_expected = sizeof(ID3v2Frame);
+        moov_end = 0;
+        is_lame = false;
+        is_smpb = false;
+        is_smpb_name = false;
+        is_frame_done = false;
+        encoder_delay = 0;
+        encoder_padding = 0;
+        valid_samples = 0;
+        samples_per_frame = 0;
+        frame.resize(0);
+        item.resize(0);
+        head.resize(0);
+    }
+
+    /// Releases the memory
+    void end() {
+        begin();
+        frame.resize(0);
+        item.resize(0);
+#ifndef __AVR__
+        mp4.resize(0);
+#endif
+    }
+
+    /// Provide the encoded data starting from the beginning of the file
+    size_t write(const uint8_t *data, size_t len) {
+        size_t pos = 0;
+        if (format == Unknown) {
+            // we need the first bytes to determine the format
+            pos = min(len, head_size - head.size());
+            int old_size = head.size();
+            head.resize(old_size + pos);
+            memcpy(head.data() + old_size, data, pos);
+            if (head.size() < head_size) return len;
+            setupFormat(head.data(), head.size());
+            process(head.data(), head.size());
+            head.resize(0);
+        }
+        process(data + pos, len - pos);
+        return len;
+    }
+
+    /// Returns true if we do not expect any further information
+    bool isDone() {
+        switch (format) {
+            case MP3:
+                return is_frame_done && (is_smpb || total >= tag_end);
+            case MP4:
+                return is_smpb || (moov_end > 0 && total >= moov_end);
+            default:
+                return false;
+        }
+    }
+
+    /// Returns true if some gapless information is available
+    bool isValid() { return is_lame || is_smpb; }
+
+    /// Encoder delay in samples (per channel)
+    int encoderDelay() { return encoder_delay; }
+
+    /// Padding at the end in samples (per channel)
+    int padding() { return encoder_padding; }
+
+    /// Number of samples (per channel) w/o delay and padding: 0 if not known
+    uint64_t validSamples() { return valid_samples; }
+
+    /// Number of samples which need to be removed at the start of the decoded
+    /// data: the encoder delay plus the decoder delay
+    int startTrim() {
+        if (!isValid()) return 0;
+        return encoder_delay + decoderDelay();
+    }
+
+    /// Defines the additional delay in samples which is added by the decoder.
+    /// By default we use 529 samples plus the decoded Info frame for mp3 (LAME
+    /// convention) and 0 for iTunSMPB where the delay already includes it.
+    void setDecoderDelay(int samples) { decoder_delay = samples; }
+
+    /// Provides the effective decoder delay in samples
+    int decoderDelay() {
+        if (decoder_delay >= 0) return decoder_delay;
+        return is_lame ? 529 + samples_per_frame : 0;
+    }
+
+  protected:
+    enum Format { Unknown, MP3, MP4 };
+    static const int smpb_len = 8;  // "iTunSMPB"
+    static const int max_item_size = 128;
+    static const int frame_window = 1024;
+    // ID3v2 header and size of the extended header
+    static const size_t head_size = sizeof(ID3v2) + 4;
+    uint64_t total = 0;
+    Format format = Unknown;
+    uint64_t tag_end = 0;
+    uint64_t id3_next = 0;
+    int id3_version = 0;
+    size_t id3_expected = sizeof(ID3v2Frame);
+    uint64_t moov_end = 0;
+    bool is_lame = false;
+    bool is_smpb = false;
+    bool is_smpb_name = false;
+    bool is_frame_done = false;
+    int encoder_delay = 0;
+    int encoder_padding = 0;
+    int decoder_delay = -1;
+    int samples_per_frame = 0;
+    uint64_t valid_samples = 0;
+    Vector<uint8_t> frame{0};
+    Vector<uint8_t> item{0};
+    Vector<uint8_t> head{0};
+#ifndef __AVR__
+    MP4Parser mp4;
+#endif
+
+    static uint32_t syncSafe(const uint8_t *size) {
+        return (uint32_t)(size[0] & 0x7F) << 21 | (uint32_t)(size[1] & 0x7F) << 14 |
+               (uint32_t)(size[2] & 0x7F) << 7 | (size[3] & 0x7F);
+    }
+
+    static uint32_t readBE32(const uint8_t *data) {
+        return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+               (uint32_t)data[2] << 8 | data[3];
+    }
+
+    /// Parses the data of the file with the parser of the format
+    void process(const uint8_t *data, size_t len) {
+        if (!isDone()) {
+            if (format == MP4) {
+                writeMP4(data, len);
+            } else {
+                writeID3(data, len);
+                collectFrame(data, len);
+            }
+        }
+        total += len;
+    }
+
+    /// Determines the file type from the first bytes
+    void setupFormat(const uint8_t *data, size_t len) {
+        if (memcmp(data + 4, "ftyp", 4) == 0) {
+            format = MP4;
+#ifndef __AVR__
+            mp4.begin();
+#endif
+            return;
+        }
+        format = MP3;
+        if (memcmp(data, "ID3", 3) != 0) return;
+        ID3v2 header;
+        memcpy(&header, data, sizeof(ID3v2));
+        id3_version = header.version[0];
+        tag_end = sizeof(ID3v2) + syncSafe(header.size);
+        if (header.flags & 0x10) tag_end += 10;  // footer
+        id3_next = sizeof(ID3v2);
+        if (header.flags & ExtendedHeaderFlag) {
+            // v2.4 includes the size field, v2.3 does not
+            const uint8_t *ext = data + sizeof(ID3v2);
+            id3_next += id3_version == 4 ? syncSafe(ext) : 4 + readBE32(ext);
+        }
+        // we do not support frames in the old v2.2 format or unsynchronised tags
+        if (id3_version < 3 || (header.flags & UnsynchronisationFlag))
+            id3_next = tag_end;
+    }
+
+    /// Walks the frames of the ID3v2 tag and collects the COMM frames
+    void writeID3(const uint8_t *data, size_t len) {
+        size_t pos = 0;
+        while (pos < len && !is_smpb) {
+            uint64_t offset = total + pos;
+            if (offset >= tag_end) return;
+            // skip the content of the frames which are not relevant
+            if (offset < id3_next) {
+                pos += min((uint64_t)(len - pos), id3_next - offset);
+                continue;
+            }
+            size_t n = min(len - pos, id3_expected - item.size());
+            int old_size = item.size();
+            item.resize(old_size + n);
+            memcpy(item.data() + old_size, data + pos, n);
+            pos += n;
+            if (item.size() == id3_expected) processID3Frame();
+        }
+    }
+
+    /// Processes the frame header or the complete COMM frame
+    void processID3Frame() {
+        ID3v2Frame header;
+        memcpy(&header, item.data(), sizeof(ID3v2Frame));
+        if (header.id[0] == 0) {
+            // padding: there are no further frames
+            id3_next = tag_end;
+            item.resize(0);
+            return;
+        }
+        uint32_t size = id3_version == 4 ? syncSafe(header.size)
+                                         : readBE32(header.size);
+        if (id3_expected == sizeof(ID3v2Frame) &&
+            memcmp(header.id, "COMM", 4) == 0 && size > 0 &&
+            size <= max_item_size) {
+            // we need the content
+            id3_expected += size;
+            return;
+        }
+        if (id3_expected > sizeof(ID3v2Frame)) {
+            // encoding, language, description and value
+            const char *comm = (const char *)item.data() + sizeof(ID3v2Frame);
+            int desc_len = 4 + smpb_len + 1;
+            if ((int)size > desc_len && comm[0] != 1 && comm[0] != 2 &&
+                memcmp(comm + 4, "iTunSMPB", smpb_len + 1) == 0)
+                parseSMPB(comm + desc_len, size - desc_len);
+        }
+        id3_next += sizeof(ID3v2Frame) + size;
+        id3_expected = sizeof(ID3v2Frame);
+        item.resize(0);
+    }
+
+    /// Feeds the data to the MP4Parser which reports the ilst items
+    void writeMP4(const uint8_t *data, size_t len) {
+#ifndef __AVR__
+        size_t pos = 0;
+        while (pos < len && !isDone()) {
+            size_t n = min(len - pos, (size_t)mp4.availableForWrite());
+            if (n == 0) break;
+            mp4.write(data + pos, n);
+            pos += n;
+        }
+#endif
+    }
+
+    void setupParser() {
+#ifndef __AVR__
+        mp4.setReference(this);
+        // ignore all other boxes
+        mp4.setCallback([](MP4Parser::Box &box, void *ref) {});
+        mp4.setCallback(
+            "moov",
+            [](MP4Parser::Box &box, void *ref) {
+                auto *self = static_cast<MetaDataGapless *>(ref);
+                self->moov_end = box.file_offset + 8 + box.size;
+            },
+            false);
+        // the iTunSMPB item is a "----" atom with a mean, name and data atom
+        mp4.setCallback(
+            "----",
+            [](MP4Parser::Box &box, void *ref) {
+                static_cast<MetaDataGapless *>(ref)->is_smpb_name = false;
+            },
+            false);
+        mp4.setCallback(
+            "name",
+            [](MP4Parser::Box &box, void *ref) {
+                auto *self = static_cast<MetaDataGapless *>(ref);
+                if (!self->collectItem(box)) return;
+                // version and flags followed by the name
+                self->is_smpb_name =
+                    self->item.size() == 4 + smpb_len &&
+                    memcmp(self->item.data() + 4, "iTunSMPB", smpb_len) == 0;
+            },
+            false);
+        mp4.setCallback(
+            "data",
+            [](MP4Parser::Box &box, void *ref) {
+                auto *self = static_cast<MetaDataGapless *>(ref);
+                if (!self->is_smpb_name || !self->collectItem(box)) return;
+                // type and locale followed by the value
+                self->is_smpb_name = false;
+                if (self->item.size() > 8)
+                    self->parseSMPB((const char *)self->item.data() + 8,
+                                    self->item.size() - 8);
+            },
+            false);
+#endif
+    }
+
+#ifndef __AVR__
+    /// Collects the (incrementally reported) box content: returns true when
+    /// the box is complete
+    bool collectItem(MP4Parser::Box &box) {
+        if (box.seq == 0) item.resize(0);
+        size_t n = min((size_t)box.available, (size_t)max_item_size - item.size());
+        int old_size = item.size();
+        item.resize(old_size + n);
+        memcpy(item.data() + old_size, box.data, n);
+        return box.is_complete;
+    }
+#endif
+
+    /// Collects the first bytes after the ID3 tag which contain the Info frame
+    void collectFrame(const uint8_t *data, size_t len) {
+        if (is_frame_done) return;
+        uint64_t end = total + len;
+        if (end <= tag_end) return;
+        size_t start = tag_end > total ? tag_end - total : 0;
+        size_t n = min(len - start, (size_t)(frame_window - frame.size()));
+        int old_size = frame.size();
+        frame.resize(old_size + n);
+        memcpy(frame.data() + old_size, data + start, n);
+        // the Info frame is small: so we try to parse it as early as possible
+        if (parseInfoFrame() || frame.size() >= frame_window) {
+            is_frame_done = true;
+            frame.resize(0);
+        }
+    }
+
+    /// Parses the Xing/Info header with the LAME extension: returns false if
+    /// we need more data
+    bool parseInfoFrame() {
+        uint8_t *data = frame.data();
+        int len = frame.size();
+        if (len < 4) return false;
+        if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) return true;  // no mp3
+        int version = (data[1] >> 3) & 3;  // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+        int layer = (data[1] >> 1) & 3;    // 1: Layer III
+        if (layer != 1 || version == 1) return true;
+        bool is_mono = ((data[3] >> 6) & 3) == 3;
+        int side_info = version == 3 ? (is_mono ? 17 : 32) : (is_mono ? 9 : 17);
+        int pos = 4 + side_info + ((data[1] & 1) == 0 ? 2 : 0);
+        samples_per_frame = version == 3 ? 1152 : 576;
+        // tag, flags, frames, bytes, toc, quality and the lame extension
+        if (len < pos + 8 + 4 + 4 + 100 + 4 + 24) return false;
+        if (memcmp(data + pos, "Xing", 4) != 0 &&
+            memcmp(data + pos, "Info", 4) != 0)
+            return true;
+        uint32_t flags = readBE32(data + pos + 4);
+        pos += 8;
+        uint32_t frames = 0;
+        if (flags & 1) {
+            frames = readBE32(data + pos);
+            pos += 4;
+        }
+        if (flags & 2) pos += 4;
+        if (flags & 4) pos += 100;
+        if (flags & 8) pos += 4;
+        // encoder version e.g. LAME3.100 or Lavc58.91
+        const uint8_t *ext = data + pos;
+        if (!isalpha(ext[0]) || !isalpha(ext[1])) return true;
+        encoder_delay = (ext[21] << 4) | (ext[22] >> 4);
+        encoder_padding = ((ext[22] & 0x0F) << 8) | ext[23];
+        if (frames > 0) {
+            uint64_t samples = (uint64_t)frames * samples_per_frame;
+            uint64_t trim = encoder_delay + encoder_padding;
+            valid_samples = samples > trim ? samples - trim : 0;
+        }
+        is_lame = true;
+        LOGI("LAME delay: %d, padding: %d, samples: %lu", encoder_delay,
+             encoder_padding, (unsigned long)valid_samples);
+        return true;
+    }
+
+    /// Parses the hex values e.g. " 00000000 00000840 000001CA 00000000001CFEF6"
+    bool parseSMPB(const char *str, int len) {
+        uint64_t values[4] = {0};
+        const char *end = str + len;
+        const char *p = str;
+        for (int j = 0; j < 4; j++) {
+            while (p < end && *p == ' ') p++;
+            if (p >= end || !isxdigit(*p)) return false;
+            while (p < end && isxdigit(*p)) {
+                int ch = *p++;
+                int digit = isdigit(ch) ? ch - '0' : (tolower(ch) - 'a' + 10);
+                values[j] = values[j] << 4 | digit;
+            }
+        }
+        is_smpb = true;
+        // LAME information is more precise for mp3
+        if (!is_lame) {
+            encoder_delay = values[1];
+            encoder_padding = values[2];
+            valid_samples = values[3];
+            LOGI("iTunSMPB delay: %d, padding: %d, samples: %lu", encoder_delay,
+                 encoder_padding, (unsigned long)valid_samples);
+        }
+        return true;
+    }
+};
+
+}  // namespace audio_tools
@@ -53,6 +53,13 @@ public:
     if (out) notifyAudioChange(out);
   }
 
+  /// Zero copy write: provides the address where we can write directly and
+  /// returns the number of contiguous bytes (max len). 0 if not supported.
+  virtual size_t acquireWrite(uint8_t **data, size_t len) { return 0; }
+
+  /// Zero copy write: confirms that len bytes were written via acquireWrite()
+  virtual size_t commitWrite(size_t len) { return 0; }
+
   /// If true we need to release the related memory in the destructor
   virtual bool isDeletable() { return false; }
 
@@ -317,6 +324,10 @@ public:
 
   void setOutputCount(int count) {
     output_count = count;
+    underruns.resize(count);
+    for (int i = 0; i < count; i++) {
+      underruns[i] = 0;
+    }
     buffers.resize(count);
     for (int i = 0; i < count; i++) {
       buffers[i] = nullptr;
@@ -340,6 +351,16 @@ public:
     update_total_weights();
   }
 
+  /// Defines the number of interleaved channels of the mixed streams (default
+  /// 1): we only mix complete frames
+  void setChannels(int channels) {
+    if (channels <= 0) {
+      LOGE("Invalid channels %d", channels);
+      return;
+    }
+    this->channels = channels;
+  }
+
   /// Starts the processing.
   bool begin(int copy_buffer_size_bytes = DEFAULT_BUFFER_SIZE) {
     is_active = true;
@@ -422,45 +443,81 @@ public:
   /// Force output to final destination
   void flushMixer() {
     LOGD("flush");
-    bool result = false;
-
     // determine ringbuffer with mininum available data
     size_t samples = availableSamples();
     // sum up samples
     if (samples > 0) {
-      result = true;
-      // mix data from ringbuffers to output
-      output.resize(samples);
-      memset(output.data(), 0, samples * sizeof(T));
-      for (int j = 0; j < output_count; j++) {
-        float weight = weights[j];
-        // sum up input samples to result samples
-        for (int i = 0; i < samples; i++) {
-          T sample = 0;;
-          buffers[j]->read(sample);
-          output[i] += weight * sample / total_weights;
-        }
-      }
-
-      // write output
-      LOGD("write to final out: %d", static_cast<int>(samples * sizeof(T)));
-      p_final_output->write((uint8_t *)output.data(), samples * sizeof(T));
+      mix(samples);
     }
     stream_idx = 0;
     return;
   }
 
-  int availableSamples() {
-    size_t samples = 0;
+  /// Mixes the indicated number of samples from all buffers and writes the
+  /// result to the final output. Buffers which can not provide enough data
+  /// are mixed as silence (and counted as underrun). Only complete frames
+  /// are read, so the channels stay aligned. Returns the written bytes.
+  size_t mix(int samples) {
+    samples = MIN(samples, size_bytes / (int)sizeof(T));
+    samples = samples / channels * channels;
+    if (samples <= 0 || p_final_output == nullptr) return 0;
+    mix_sum.resize(samples);
+    output.resize(samples);
+    memset(mix_sum.data(), 0, samples * sizeof(float));
     for (int j = 0; j < output_count; j++) {
-      int available_samples = buffers[j]->available();
-      if (available_samples > 0){
-        samples = MIN(size_bytes / sizeof(T), (size_t)available_samples);
+      BaseBuffer<T> *p_buffer = buffers[j];
+      if (p_buffer == nullptr) continue;
+      int frame_samples = p_buffer->available() / channels * channels;
+      int read = p_buffer->readArray(output.data(), MIN(samples, frame_samples));
+      if (read < samples) underruns[j]++;
+      float factor = total_weights > 0.0f ? weights[j] / total_weights : 0.0f;
+      if (factor == 0.0f) continue;
+      // sum up input samples to result samples
+      float *sum = mix_sum.data();
+      const T *in = output.data();
+      for (int i = 0; i < read; i++) {
+        sum[i] += factor * in[i];
       }
     }
+
+    // convert back with clipping
+    T *out = output.data();
+    const float *sum = mix_sum.data();
+    for (int i = 0; i < samples; i++) {
+      out[i] = NumberConverter::clipT<T>(sum[i]);
+    }
+
+    // write output
+    LOGD("write to final out: %d", static_cast<int>(samples * sizeof(T)));
+    return p_final_output->write((uint8_t *)output.data(), samples * sizeof(T));
+  }
+
+  /// Provides the minimum number of samples which are available in all buffers
+  int availableSamples() {
+    int samples = size_bytes / sizeof(T);
+    for (int j = 0; j < output_count; j++) {
+      if (buffers[j] == nullptr) return 0;
+      samples = MIN(samples, buffers[j]->available());
+    }
     return samples;
   }
 
+  /// Provides the maximum number of samples which are available in any buffer
+  int availableSamplesMax() {
+    int samples = 0;
+    for (int j = 0; j < output_count; j++) {
+      if (buffers[j] != nullptr && buffers[j]->available() > samples)
+        samples = buffers[j]->available();
+    }
+    return MIN(samples, size_bytes / (int)sizeof(T));
+  }
+
+  /// Provides the number of mix() calls in which the indicated buffer did not
+  /// provide enough data
+  uint32_t underrunCount(int idx) {
+    return idx < output_count ? underruns[idx] : 0;
+  }
+
   /// Resizes the buffer to the indicated number of bytes
   void resize(int size) {
     if (size != size_bytes) {
@@ -511,13 +568,16 @@ public:
 protected:
   Vector<BaseBuffer<T> *> buffers{0};
   Vector<T> output{0};
+  Vector<float> mix_sum{0};
   Vector<float> weights{0};
+  Vector<uint32_t> underruns{0};
   Print *p_final_output = nullptr;
   float total_weights = 0.0;
   bool is_active = false;
   int stream_idx = 0;
   int size_bytes = 0;
   int output_count = 0;
+  int channels = 1;
   void *p_memory = nullptr;
   bool is_auto_index = true;
   BaseBuffer<T>* (*create_buffer_cb)(int size) = create_buffer; 
@@ -539,8 +599,12 @@ protected:
       if (buffers[j] != nullptr) {
         delete buffers[j];
       }
-      buffers[j] = create_buffer(size);
+      buffers[j] = create_buffer_cb(size);
     }
+    // mix() is limited to size bytes: so it does not need to allocate
+    int samples = size / sizeof(T);
+    mix_sum.resize(samples);
+    output.resize(samples);
   }
 
   void free_buffers() {
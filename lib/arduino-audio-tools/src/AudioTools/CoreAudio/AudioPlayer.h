@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AudioTools/AudioCodecs/AudioCodecs.h"
+#include "AudioTools/AudioCodecs/AudioSeekTable.h"
 #include "AudioTools/CoreAudio/AudioBasic/Debouncer.h"
 #include "AudioTools/CoreAudio/AudioHttp/AudioHttp.h"
 #include "AudioTools/CoreAudio/AudioLogger.h"
@@ -14,6 +15,31 @@
 #include "AudioTools/CoreAudio/VolumeStream.h"
 #include "AudioTools/Disk/AudioSource.h"
 #include "AudioToolsConfig.h"
+#if defined(USE_CONCURRENCY) || defined(USE_STD_CONCURRENCY)
+#if defined(USE_CONCURRENCY)
+#include "AudioTools/AudioLibs/Concurrency.h"
+#else
+#include <thread>
+#endif
+#include "AudioTools/Concurrency/LockFree/RingBufferLockFree.h"
+#define USE_AUDIO_PLAYER_THREAD
+#endif
+
+#ifndef PLAYER_THREAD_BUFFER_SIZE
+#define PLAYER_THREAD_BUFFER_SIZE (32 * 1024)
+#endif
+
+#ifndef PLAYER_THREAD_PRIORITY
+#define PLAYER_THREAD_PRIORITY 2
+#endif
+
+#ifndef PLAYER_THREAD_CORE
+#define PLAYER_THREAD_CORE 0
+#endif
+
+#ifndef PLAYER_THREAD_STACK_SIZE
+#define PLAYER_THREAD_STACK_SIZE 30000
+#endif
 
 /**
  * @defgroup player Player
@@ -31,6 +57,21 @@ namespace audio_tools {
  * - stop
  * - next
  * - set Volume
+ *
+ * If the platform supports concurrency you can call setThreaded(true): the
+ * reading and decoding is then done in a separate task (ESP32) or thread
+ * (desktop) into a PCM buffer and copy() just writes the buffered PCM data to
+ * the output. When a file based source reports the end of a file, the worker
+ * opens the next file immediately, so that the transition is gapless.
+ *
+ * With setGapless(true) the encoder delay and padding which is reported by
+ * the LAME/Info tag or the iTunSMPB comment is removed from the decoded audio
+ * and we move to the next file without any fading, so that consecutive tracks
+ * are spliced sample accurately.
+ *
+ * File based sources support seekTime() and seekSample() for WAV, MP3 and
+ * FLAC (see AudioSeekTable): the tables of the last files are cached (see
+ * AudioSeekTableCache).
  * @ingroup player
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -99,14 +140,18 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
 
   AudioPlayer &operator=(AudioPlayer const &) = delete;
 
+#ifdef USE_AUDIO_PLAYER_THREAD
+  ~AudioPlayer() { stopWorker(); }
+#endif
+
   void setOutput(AudioOutput &output) {
     if (p_decoder->isResultPCM()) {
       this->fade.setOutput(output);
       this->volume_out.setOutput(fade);
-      out_decoding.setOutput(&volume_out);
+      setDecodingOutput(&volume_out);
       out_decoding.setDecoder(p_decoder);
     } else {
-      out_decoding.setOutput(&output);
+      setDecodingOutput(&output);
       out_decoding.setDecoder(p_decoder);
     }
     this->p_final_print = &output;
@@ -117,10 +162,10 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
     if (p_decoder->isResultPCM()) {
       this->fade.setOutput(output);
       this->volume_out.setOutput(fade);
-      out_decoding.setOutput(&volume_out);
+      setDecodingOutput(&volume_out);
       out_decoding.setDecoder(p_decoder);
     } else {
-      out_decoding.setOutput(&output);
+      setDecodingOutput(&output);
       out_decoding.setDecoder(p_decoder);
     }
     this->p_final_print = nullptr;
@@ -131,10 +176,10 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
     if (p_decoder->isResultPCM()) {
       this->fade.setOutput(output);
       this->volume_out.setOutput(fade);
-      out_decoding.setOutput(&volume_out);
+      setDecodingOutput(&volume_out);
       out_decoding.setDecoder(p_decoder);
     } else {
-      out_decoding.setOutput(&output);
+      setDecodingOutput(&output);
       out_decoding.setDecoder(p_decoder);
     }
     this->p_final_print = nullptr;
@@ -149,6 +194,9 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   bool begin(int index = 0, bool isActive = true) {
     TRACED();
     bool result = false;
+#ifdef USE_AUDIO_PLAYER_THREAD
+    stopWorker();
+#endif
     // initilaize volume
     if (current_volume == -1.0f) {
       setVolume(1.0f);
@@ -174,7 +222,7 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
         if (meta_active) {
           copier.setCallbackOnWrite(decodeMetaData, this);
         }
-        copier.begin(out_decoding, *p_input_stream);
+        copier.begin(decodingInput(), *p_input_stream);
         timeout = millis() + p_source->timeoutAutoNext();
         active = isActive;
         result = true;
@@ -188,11 +236,18 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
       active = isActive;
       result = false;
     }
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (is_threaded) startWorker();
+#endif
     return result;
   }
 
   void end() {
     TRACED();
+#ifdef USE_AUDIO_PLAYER_THREAD
+    // stop the worker unless we are called from it (e.g. by setStream)
+    if (!isWorker()) stopWorker();
+#endif
     active = false;
     out_decoding.end();
     meta_out.end();
@@ -228,6 +283,47 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   /// Updates the audio info in the related objects
   void setAudioInfo(AudioInfo info) override {
     TRACED();
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (isWorker()) {
+      // apply it when the output reaches the related position in the buffer
+      deferAudioInfo(info);
+      return;
+    }
+#endif
+    applyAudioInfo(info);
+  };
+
+  AudioInfo audioInfo() override { return info; }
+
+#ifdef USE_AUDIO_PLAYER_THREAD
+  /// Activates the reading and decoding in a separate task/thread into a PCM
+  /// buffer with the indicated size: call before begin()
+  void setThreaded(bool flag, int bufferSize = PLAYER_THREAD_BUFFER_SIZE) {
+    stopWorker();
+    is_threaded = flag;
+    pcm_buffer.resize(flag ? bufferSize : 0);
+    if (p_decoding_target != nullptr) setDecodingOutput(p_decoding_target);
+  }
+
+  /// Checks if the decoding is done in a separate task/thread
+  bool isThreaded() { return is_threaded; }
+
+  /// Number of times the output found the PCM buffer empty while playing
+  uint32_t underrunCount() { return underrun_count; }
+
+  /// Number of decoded bytes which are waiting to be output
+  int bufferedBytes() { return is_threaded ? pcm_buffer.available() : 0; }
+
+  /// Fill level of the PCM buffer in percent
+  int bufferPercent() {
+    int size = pcm_buffer.size();
+    return size == 0 ? 0 : 100 * pcm_buffer.available() / size;
+  }
+#endif
+
+ protected:
+  /// Updates the audio info in the related objects
+  void applyAudioInfo(AudioInfo info) {
     LOGI("sample_rate: %d", (int)info.sample_rate);
     LOGI("bits_per_sample: %d", (int)info.bits_per_sample);
     LOGI("channels: %d", (int)info.channels);
@@ -239,10 +335,9 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
     if (p_final_print != nullptr) p_final_print->setAudioInfo(info);
     if (p_final_stream != nullptr) p_final_stream->setAudioInfo(info);
     if (p_final_notify != nullptr) p_final_notify->setAudioInfo(info);
-  };
-
-  AudioInfo audioInfo() override { return info; }
+  }
 
+ public:
   /// starts / resumes the playing after calling stop(): same as setActive(true)
   void play() {
     TRACED();
@@ -283,55 +378,86 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   /// values are supported to move back.
   bool next(int offset = 1) {
     TRACED();
-    writeEnd();
-    stream_increment = offset >= 0 ? 1 : -1;
-    active = setStream(p_source->nextStream(offset));
-    return active;
+    return command([&]() {
+      writeEnd();
+      stream_increment = offset >= 0 ? 1 : -1;
+      active = setStream(p_source->nextStream(offset));
+      return (bool)active;
+    });
   }
 
   /// moves to the selected file position
   bool setIndex(int idx) {
     TRACED();
-    writeEnd();
-    stream_increment = 1;
-    active = setStream(p_source->selectStream(idx));
-    return active;
+    return command([&]() {
+      writeEnd();
+      stream_increment = 1;
+      active = setStream(p_source->selectStream(idx));
+      return (bool)active;
+    });
   }
 
   /// Moves to the selected file w/o updating the actual file position
   bool setPath(const char *path) {
     TRACED();
-    writeEnd();
-    stream_increment = 1;
-    active = setStream(p_source->selectStream(path));
-    return active;
+    return command([&]() {
+      writeEnd();
+      stream_increment = 1;
+      active = setStream(p_source->selectStream(path));
+      return (bool)active;
+    });
   }
 
   /// moves to previous file
   bool previous(int offset = 1) {
     TRACED();
-    writeEnd();
-    stream_increment = -1;
-    active = setStream(p_source->previousStream(abs(offset)));
-    return active;
+    return command([&]() {
+      writeEnd();
+      stream_increment = -1;
+      active = setStream(p_source->previousStream(abs(offset)));
+      return (bool)active;
+    });
   }
 
   /// start selected input stream
   bool setStream(Stream *input) {
-    end();
-    out_decoding.begin();
-    p_input_stream = input;
-    if (p_input_stream != nullptr) {
-      LOGD("open selected stream");
-      meta_out.begin();
-      copier.begin(out_decoding, *p_input_stream);
-    }
-    // execute callback if defined
-    if (on_stream_change_callback != nullptr)
-      on_stream_change_callback(p_input_stream, p_reference);
-    return p_input_stream != nullptr;
+    return command([&]() {
+      end();
+      out_decoding.begin();
+      p_input_stream = input;
+      if (p_input_stream != nullptr) {
+        LOGD("open selected stream");
+        meta_out.begin();
+        gapless.begin();
+        trim_out.begin();
+        copier.begin(decodingInput(), *p_input_stream);
+      }
+      // execute callback if defined
+      if (on_stream_change_callback != nullptr)
+        on_stream_change_callback(p_input_stream, p_reference);
+      return p_input_stream != nullptr;
+    });
+  }
+
+  /// Moves to the indicated time in milliseconds of the current file
+  bool seekTime(uint32_t ms) {
+    TRACED();
+    return command([&]() { return seekRestoring(ms, true); });
+  }
+
+  /// Moves to the indicated sample (per channel) of the current file
+  bool seekSample(uint64_t sample) {
+    TRACED();
+    return command([&]() { return seekRestoring(sample, false); });
   }
 
+  /// Provides the seek table of the current file: nullptr if we did not
+  /// seek in it yet
+  AudioSeekTable *seekTable() { return p_seek_table; }
+
+  /// Provides the cache of the seek tables e.g. to define the number of files
+  AudioSeekTableCache &seekTableCache() { return seek_tables; }
+
   /// Provides the actual stream (=e.g.file)
   Stream *getStream() { return p_input_stream; }
 
@@ -348,7 +474,15 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
         fade.setFadeInActive(true);
       } else {
         fade.setFadeOutActive(true);
+#ifdef USE_AUDIO_PLAYER_THREAD
+        if (is_threaded) {
+          copyBuffered(copier.bufferSize());
+        } else {
+          copier.copy();
+        }
+#else
         copier.copy();
+#endif
         writeSilence(2048);
       }
     }
@@ -379,6 +513,21 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   /// method after calling begin()!
   void setAutoNext(bool next) { autonext = next; }
 
+  /// Activates the gapless playback: the encoder delay and padding are
+  /// trimmed and we move to the next file w/o fading as soon as the current
+  /// file has ended. Call before begin().
+  void setGapless(bool flag) {
+    is_gapless = flag;
+    if (p_decoding_target != nullptr) setDecodingOutput(p_decoding_target);
+  }
+
+  /// Checks if the gapless playback is active
+  bool isGapless() { return is_gapless; }
+
+  /// Provides the gapless information of the current file: e.g. to define
+  /// the decoder delay with setDecoderDelay()
+  MetaDataGapless &gaplessInfo() { return gapless; }
+
   /// Defines the wait time in ms if the target output is full
   void setDelayIfOutputFull(int delayMs) { delay_if_full = delayMs; }
 
@@ -390,8 +539,9 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   size_t copyAll() {
     size_t result = 0;
     size_t step = copy();
-    while (step > 0) {
+    while (step > 0 || isDecoding()) {
       result += step;
+      if (step == 0) delay(1);
       step = copy();
     }
     return result;
@@ -400,6 +550,9 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   /// Copies the indicated number of bytes from the source to the decoder: Call
   /// this method in the loop.
   size_t copy(size_t bytes) {
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (is_threaded) return copyBuffered(bytes);
+#endif
     size_t result = 0;
     if (active) {
       TRACED();
@@ -413,10 +566,7 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
       }
       // handle sound
       result = copier.copyBytes(bytes);
-      if (result > 0 || timeout == 0) {
-        // reset timeout if we had any data
-        timeout = millis() + p_source->timeoutAutoNext();
-      }
+      updateTimeout(result);
       // move to next stream after timeout
       moveToNextFileOnTimeout();
 
@@ -502,7 +652,12 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   }
 
  protected:
+#ifdef USE_AUDIO_PLAYER_THREAD
+  // updated by the worker on auto next
+  std::atomic<bool> active{false};
+#else
   bool active = false;
+#endif
   bool autonext = true;
   bool silence_on_inactive = false;
   AudioSource *p_source = nullptr;
@@ -527,6 +682,416 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   void *p_reference = nullptr;
   void (*on_stream_change_callback)(Stream *stream_ptr,
                                     void *reference) = nullptr;
+  bool is_threaded = false;
+  bool is_gapless = false;
+  bool is_auto_next = false;
+  Print *p_decoding_target = nullptr;  // output of the decoder w/o thread
+  MetaDataGapless gapless;
+
+  /// Feeds the encoded data to the gapless parser before decoding it
+  class GaplessInput : public AudioOutput {
+   public:
+    GaplessInput(AudioPlayer &player) : player(player) {}
+    size_t write(const uint8_t *data, size_t len) override {
+      player.gapless.write(data, len);
+      return player.out_decoding.write(data, len);
+    }
+    int availableForWrite() override {
+      return player.out_decoding.availableForWrite();
+    }
+
+   protected:
+    AudioPlayer &player;
+  } gapless_in{*this};
+
+  /// Removes samples from the decoded data: the encoder delay and padding
+  /// for gapless playback and the preroll after seeking
+  class TrimOutput : public AudioOutput {
+   public:
+    TrimOutput(AudioPlayer &player) : player(player) {}
+    void setOutput(Print &out) { p_out = &out; }
+    bool begin() override {
+      is_setup = false;
+      is_range = false;
+      return true;
+    }
+    /// Defines the samples to skip and the number of valid samples (0 =
+    /// unlimited) explicitly
+    void setRange(uint64_t skip, uint64_t valid) {
+      range_skip = skip;
+      range_valid = valid;
+      is_range = true;
+      is_setup = false;
+    }
+    size_t write(const uint8_t *data, size_t len) override {
+      if (!is_setup) setup();
+      size_t result = len;
+      // remove the delay at the start
+      size_t skip = min((uint64_t)len, skip_bytes);
+      skip_bytes -= skip;
+      data += skip;
+      len -= skip;
+      // remove the padding at the end
+      if (is_limited) {
+        len = min((uint64_t)len, valid_bytes);
+        valid_bytes -= len;
+      }
+      if (len > 0) writeAll(data, len);
+      return result;
+    }
+    int availableForWrite() override { return p_out->availableForWrite(); }
+
+   protected:
+    AudioPlayer &player;
+    Print *p_out = nullptr;
+    bool is_setup = false;
+    bool is_limited = false;
+    bool is_range = false;
+    uint64_t range_skip = 0;
+    uint64_t range_valid = 0;
+    uint64_t skip_bytes = 0;
+    uint64_t valid_bytes = 0;
+
+    /// Determines the limits when we receive the first decoded data
+    void setup() {
+      is_setup = true;
+      AudioInfo info = player.p_decoder->audioInfo();
+      int frame_size = info.channels * info.bits_per_sample / 8;
+      uint64_t skip = 0, valid = 0;
+      if (is_range) {
+        skip = range_skip;
+        valid = range_valid;
+      } else if (player.is_gapless) {
+        skip = player.gapless.startTrim();
+        valid = player.gapless.validSamples();
+      }
+      is_limited = frame_size > 0 && valid > 0;
+      skip_bytes = skip * frame_size;
+      valid_bytes = valid * frame_size;
+      if (skip_bytes > 0 || is_limited)
+        LOGI("trim: %lu bytes, valid: %lu bytes", (unsigned long)skip_bytes,
+             (unsigned long)valid_bytes);
+    }
+
+    void writeAll(const uint8_t *data, size_t len) {
+      size_t open = len;
+      while (open > 0) {
+        size_t written = p_out->write(data + len - open, open);
+        if (written == 0) break;
+        open -= written;
+      }
+    }
+  } trim_out{*this};
+  AudioSeekTableCache seek_tables;
+  AudioSeekTable *p_seek_table = nullptr;
+
+#ifdef USE_AUDIO_PLAYER_THREAD
+  /// Output of the decoder when threaded: writes to the PCM buffer
+  class BufferOutput : public AudioOutput {
+   public:
+    BufferOutput(AudioPlayer &player) : player(player) {}
+    size_t write(const uint8_t *data, size_t len) override {
+      size_t result = 0;
+      while (result < len) {
+        // pending command will flush the buffer anyway
+        if (!player.is_running || player.has_command) return len;
+        int avail = 0;
+        uint8_t *to = player.pcm_buffer.writeAddress(avail);
+        int n = min((int)(len - result), avail);
+        if (n <= 0) {
+          delay(1);
+          continue;
+        }
+        memcpy(to, data + result, n);
+        player.pcm_buffer.commitWrite(n);
+        player.written_total += n;
+        result += n;
+      }
+      return result;
+    }
+    int availableForWrite() override {
+      return player.pcm_buffer.availableForWrite();
+    }
+
+   protected:
+    AudioPlayer &player;
+  } buffer_out{*this};
+
+  RingBufferLockFree<uint8_t> pcm_buffer{0};
+  std::atomic<bool> is_running{false};
+  std::atomic<bool> has_command{false};
+  std::atomic<bool> command_done{false};
+  std::atomic<bool> is_input_empty{false};
+  std::atomic<bool> has_pending_info{false};
+  std::atomic<size_t> written_total{0};
+  std::atomic<uint32_t> underrun_count{0};
+  size_t read_total = 0;
+  size_t pending_pos = 0;
+  bool is_underrun = false;
+  AudioInfo pending_info;
+  bool (*command_fn)(void *) = nullptr;
+  void *command_ref = nullptr;
+  bool command_result = false;
+#if defined(USE_CONCURRENCY)
+  Task task;  // created on the first start
+  std::atomic<bool> is_worker_idle{true};
+#else
+  std::thread thread;
+  std::atomic<std::thread::id> worker_id;
+#endif
+
+  /// Determines if we are called from the worker task/thread
+  bool isWorker() {
+    if (!is_threaded) return false;
+#if defined(USE_CONCURRENCY)
+    return task.getTaskHandle() != nullptr &&
+           xTaskGetCurrentTaskHandle() == task.getTaskHandle();
+#else
+    return std::this_thread::get_id() == worker_id.load();
+#endif
+  }
+
+  void startWorker() {
+    TRACED();
+    pcm_buffer.reset();
+    read_total = written_total;
+    has_command = false;
+    command_done = false;
+    is_input_empty = false;
+    is_underrun = false;
+    is_running = true;
+#if defined(USE_CONCURRENCY)
+    task.create("AudioPlayer", PLAYER_THREAD_STACK_SIZE, PLAYER_THREAD_PRIORITY,
+                PLAYER_THREAD_CORE);
+    task.begin([this]() {
+      is_worker_idle = false;
+      if (is_running) workerStep();
+      is_worker_idle = true;
+      if (!is_running) delay(5);
+    });
+#else
+    thread = std::thread([this]() {
+      worker_id = std::this_thread::get_id();
+      while (is_running) workerStep();
+    });
+#endif
+  }
+
+  void stopWorker() {
+    if (!is_running) return;
+    TRACED();
+    is_running = false;
+#if defined(USE_CONCURRENCY)
+    while (!is_worker_idle) delay(1);
+    task.end();
+#else
+    if (thread.joinable()) thread.join();
+    worker_id = std::thread::id();
+#endif
+    pcm_buffer.reset();
+    read_total = written_total;
+    has_pending_info = false;
+  }
+
+  /// Reads and decodes the next block into the PCM buffer
+  void workerStep() {
+    if (has_command) {
+      command_result = command_fn(command_ref);
+      command_done = true;
+      // wait until the output has flushed the buffer
+      while (command_done && is_running) delay(1);
+      return;
+    }
+    if (!active) {
+      delay(5);
+      return;
+    }
+    size_t result = copier.copyBytes(copier.bufferSize());
+    is_input_empty = result == 0;
+    updateTimeout(result);
+    moveToNextFileOnTimeout();
+    if (result == 0) delay(1);
+  }
+
+  template <typename F>
+  static bool invokeCommand(void *ref) {
+    return (*(F *)ref)();
+  }
+
+  /// Executes the command in the worker and discards the buffered PCM data
+  template <typename F>
+  bool runInWorker(F &cmd) {
+    command_fn = invokeCommand<F>;
+    command_ref = &cmd;
+    has_command = true;
+    while (!command_done) delay(1);
+    bool result = command_result;
+    pcm_buffer.reset();
+    read_total = written_total;
+    is_input_empty = false;
+    // release the worker: command_done is only set by the worker
+    has_command = false;
+    command_done = false;
+    return result;
+  }
+
+  /// Remembers the audio info of the decoder until the output reaches the
+  /// related position
+  void deferAudioInfo(AudioInfo newInfo) {
+    // wait until the prior change has been processed
+    while (has_pending_info && is_running && !has_command) delay(1);
+    pending_info = newInfo;
+    pending_pos = written_total;
+    has_pending_info = true;
+  }
+
+  /// Applies a deferred audio info change and limits the size so that we do
+  /// not copy beyond the position of the next change
+  size_t processPendingInfo(size_t bytes) {
+    if (!has_pending_info) return bytes;
+    size_t open = pending_pos - read_total;
+    if (open == 0 || open > pcm_buffer.size()) {
+      applyAudioInfo(pending_info);
+      has_pending_info = false;
+      return bytes;
+    }
+    return min(bytes, open);
+  }
+
+  /// Output side: writes the decoded PCM data from the buffer
+  size_t copyBuffered(size_t bytes) {
+    if (!active) {
+      // e.g. A2DP should still receive data to keep the connection open
+      if (silence_on_inactive) writeSilence(1024);
+      return 0;
+    }
+    bytes = processPendingInfo(bytes);
+    int len = 0;
+    uint8_t *data = pcm_buffer.readAddress(len);
+    size_t n = min(bytes, (size_t)len);
+    if (n == 0) {
+      // count each underrun only once
+      if (!is_underrun && read_total != 0 && !is_input_empty) {
+        underrun_count++;
+        is_underrun = true;
+      }
+      if (silence_on_inactive) writeSilence(bytes);
+      return 0;
+    }
+    is_underrun = false;
+    size_t result = p_decoding_target->write(data, n);
+    pcm_buffer.clearArray(result);
+    read_total += result;
+    return result;
+  }
+#endif
+
+  void setDecodingOutput(Print *out) {
+    p_decoding_target = out;
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (is_threaded) out = &buffer_out;
+#endif
+    // only pcm data can be trimmed
+    if (p_decoder->isResultPCM()) {
+      trim_out.setOutput(*out);
+      out = &trim_out;
+    }
+    out_decoding.setOutput(out);
+  }
+
+  /// Seeks to the indicated time or sample: building and querying the seek
+  /// table reads the file, so we move back to the actual position if we
+  /// fail, so that the playback can continue.
+  bool seekRestoring(uint64_t value, bool isTime) {
+    if (p_input_stream == nullptr) return false;
+    size_t current_pos = p_source->position();
+    bool result = setupSeekTable();
+    if (result) {
+      uint64_t sample = isTime ? p_seek_table->timeToSample(value) : value;
+      result = seekSampleInternal(sample);
+    }
+    if (!result && !p_source->seek(current_pos)) {
+      LOGE("could not restore position %u", (unsigned)current_pos);
+    }
+    return result;
+  }
+
+  /// Provides the seek table of the current file from the cache: it is only
+  /// built if it is not available yet.
+  bool setupSeekTable() {
+    if (p_input_stream == nullptr) return false;
+    p_seek_table = seek_tables.get(p_source->toStr(), *p_source, *p_input_stream);
+    return p_seek_table != nullptr;
+  }
+
+  /// Restarts the decoder at the file position of the sample
+  bool seekSampleInternal(uint64_t sample) {
+    uint64_t target = sample;
+    uint64_t valid = 0;
+    if (is_gapless && gapless.isValid()) {
+      target += gapless.startTrim();
+      if (gapless.validSamples() > 0) {
+        if (sample >= gapless.validSamples()) return false;
+        valid = gapless.validSamples() - sample;
+      }
+    }
+    SeekPosition pos;
+    if (!p_seek_table->find(target, pos)) {
+      LOGW("seek to sample %lu failed", (unsigned long)sample);
+      return false;
+    }
+    if (!p_source->seek(pos.offset)) return false;
+    // restart the decoder with the header
+    p_decoder->begin();
+    if (p_seek_table->headerSize() > 0)
+      out_decoding.write(p_seek_table->header(), p_seek_table->headerSize());
+    trim_out.setRange(pos.skip, valid);
+    timeout = millis() + p_source->timeoutAutoNext();
+    return true;
+  }
+
+  /// Target of the copier: the gapless information is parsed before decoding
+  Print &decodingInput() {
+    if (is_gapless) return gapless_in;
+    return out_decoding;
+  }
+
+  /// Resets the timeout if we had data: if the source reports the end of the
+  /// file when threaded or gapless, we move to the next file immediately
+  void updateTimeout(size_t result) {
+    if (result > 0 || timeout == 0) {
+      timeout = millis() + p_source->timeoutAutoNext();
+    } else if ((is_threaded || is_gapless) && p_input_stream != nullptr &&
+               p_source->isEndOfStream(*p_input_stream)) {
+      timeout = 0;
+    }
+  }
+
+  /// Executes the command: when threaded we let the worker execute it and
+  /// fade out/in on the output side
+  template <typename F>
+  bool command(F cmd) {
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (is_running && !isWorker()) {
+      if (is_auto_fade) {
+        fade.setFadeOutActive(true);
+        copyBuffered(copier.bufferSize());
+        fade.setFadeInActive(true);
+      }
+      return runInWorker(cmd);
+    }
+#endif
+    return cmd();
+  }
+
+  /// Checks if the worker is still providing data
+  bool isDecoding() {
+#ifdef USE_AUDIO_PLAYER_THREAD
+    if (is_running)
+      return active && (!is_input_empty || pcm_buffer.available() > 0);
+#endif
+    return false;
+  }
 
   void setupFade() {
     if (p_final_print != nullptr) {
@@ -537,16 +1102,22 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   }
 
   void moveToNextFileOnTimeout() {
-    if (p_final_stream != nullptr && p_final_stream->availableForWrite() == 0)
+    // the worker does not access the output
+    bool is_worker = is_threaded;
+    if (!is_worker && p_final_stream != nullptr &&
+        p_final_stream->availableForWrite() == 0)
       return;
     if (p_input_stream == nullptr || millis() > timeout) {
-      if (is_auto_fade) fade.setFadeInActive(true);
+      if (is_auto_fade && !is_worker && !is_gapless)
+        fade.setFadeInActive(true);
       if (autonext) {
         LOGI("-> timeout - moving by %d", stream_increment);
         // open next stream
+        is_auto_next = true;
         if (!next(stream_increment)) {
           LOGD("stream is null");
         }
+        is_auto_next = false;
       } else {
         active = false;
       }
@@ -557,7 +1128,8 @@ class AudioPlayer : public AudioInfoSupport, public VolumeSupport {
   void writeEnd() {
     // end silently
     TRACEI();
-    if (is_auto_fade) {
+    // when threaded the fading is done on the output side
+    if (is_auto_fade && !is_threaded && !(is_gapless && is_auto_next)) {
       fade.setFadeOutActive(true);
       copier.copy();
       // start by fading in
@@ -1,5 +1,6 @@
 #pragma once
 #include "AudioTools/CoreAudio/AudioEffects/SoundGenerator.h"
+#include "AudioTools/CoreAudio/AudioFilter/BiQuadCascade.h"
 #include "AudioTools/CoreAudio/AudioLogger.h"
 #include "AudioTools/CoreAudio/AudioOutput.h"
 #include "AudioTools/CoreAudio/AudioTimer/AudioTimer.h"
@@ -71,6 +72,11 @@ class ModifyingStream : public AudioStream {
   virtual void setStream(Stream &in) = 0;
   /// Defines/Changes the output target
   virtual void setOutput(Print &out) = 0;
+  /// Returns true if the data is modified in place w/o changing the size, so
+  /// that a Pipeline can process it together with its neighbours
+  virtual bool isInPlace() { return false; }
+  /// Modifies the data in place: only used if isInPlace() returns true
+  virtual void processInPlace(uint8_t *data, size_t len) {}
 };
 
 /**
@@ -203,14 +209,46 @@ class MemoryStream : public AudioStream {
     if (!is_active) return 0;
     size_t count = 0;
     while (count < len) {
-      int c = read();
-      if (c < 0) break;
-      *data++ = (char)c;
-      count++;
+      const uint8_t *src = nullptr;
+      size_t n = peekRead(&src, len - count);
+      if (n == 0) break;
+      memcpy(data + count, src, n);
+      commitRead(n);
+      count += n;
     }
     return count;
   }
 
+  /// Provides direct access to the unread data
+  size_t peekRead(const uint8_t **data, size_t len) override {
+    if (available() <= 0) return 0;
+    int result = min((int)len, write_pos - read_pos);
+    if (result <= 0) return 0;
+    *data = buffer + read_pos;
+    return result;
+  }
+
+  /// Consumes the data provided by peekRead()
+  size_t commitRead(size_t len) override {
+    size_t result = min(len, (size_t)max(write_pos - read_pos, 0));
+    read_pos += result;
+    return result;
+  }
+
+  /// Provides direct access to the unused memory
+  size_t acquireWrite(uint8_t **data, size_t len) override {
+    if (availableForWrite() <= 0 || buffer == nullptr) return 0;
+    *data = buffer + write_pos;
+    return min(len, (size_t)(buffer_size - write_pos));
+  }
+
+  /// Confirms the data which was written via acquireWrite()
+  size_t commitWrite(size_t len) override {
+    size_t result = min(len, (size_t)max(buffer_size - write_pos, 0));
+    write_pos += result;
+    return result;
+  }
+
   virtual int peek() override {
     if (!is_active) return -1;
     int result = -1;
@@ -339,44 +377,77 @@ class RingBufferStream : public AudioStream {
  public:
   RingBufferStream(int size = DEFAULT_BUFFER_SIZE) { resize(size); }
 
+  /// Uses the provided buffer (e.g. a RingBufferLockFree) instead of the
+  /// internal RingBuffer
+  RingBufferStream(BaseBuffer<uint8_t> &buffer) { setBuffer(buffer); }
+
+  /// p_buffer might point to our own member: so we do not support copies
+  RingBufferStream(RingBufferStream const &) = delete;
+
+  RingBufferStream &operator=(RingBufferStream const &) = delete;
+
+  /// Defines the buffer which is used to store the data
+  void setBuffer(BaseBuffer<uint8_t> &buffer) { p_buffer = &buffer; }
+
   virtual int available() override {
     // LOGD("RingBufferStream::available: %zu",buffer->available());
-    return buffer.available();
+    return p_buffer->available();
   }
 
   virtual int availableForWrite() override {
-    return buffer.availableForWrite();
+    return p_buffer->availableForWrite();
   }
 
   virtual void flush() override {}
   virtual int peek() override {
     uint8_t data = 0;
-    if (!buffer.peek(data)) return -1;
+    if (!p_buffer->peek(data)) return -1;
     return data;
   }
   virtual int read() override {
     uint8_t data = 0;
-    if (!buffer.read(data)) return -1;
+    if (!p_buffer->read(data)) return -1;
     return data;
   }
 
   virtual size_t readBytes(uint8_t *data, size_t len) override {
-    return buffer.readArray(data, len);
+    return p_buffer->readArray(data, len);
   }
 
   virtual size_t write(const uint8_t *data, size_t len) override {
     // LOGD("RingBufferStream::write: %zu",len);
-    return buffer.writeArray(data, len);
+    return p_buffer->writeArray(data, len);
+  }
+
+  virtual size_t write(uint8_t c) override { return p_buffer->write(c); }
+
+  /// Provides direct access to the next contiguous readable data
+  size_t peekRead(const uint8_t **data, size_t len) override {
+    int avail = 0;
+    *data = p_buffer->readAddress(avail);
+    return min(len, (size_t)avail);
+  }
+
+  /// Consumes the data provided by peekRead()
+  size_t commitRead(size_t len) override { return p_buffer->clearArray(len); }
+
+  /// Provides direct access to the next contiguous free memory
+  size_t acquireWrite(uint8_t **data, size_t len) override {
+    int avail = 0;
+    *data = p_buffer->writeAddress(avail);
+    return min(len, (size_t)avail);
   }
 
-  virtual size_t write(uint8_t c) override { return buffer.write(c); }
+  /// Confirms the data which was written via acquireWrite()
+  size_t commitWrite(size_t len) override { return p_buffer->commitWrite(len); }
 
-  void resize(int size) { buffer.resize(size); }
+  void resize(int size) { p_buffer->resize(size); }
 
-  size_t size() { return buffer.size(); }
+  size_t size() { return p_buffer->size(); }
 
  protected:
   RingBuffer<uint8_t> buffer{0};
+  BaseBuffer<uint8_t> *p_buffer = &buffer;
 };
 
 /**
@@ -666,6 +737,15 @@ class ConverterStream : public ModifyingStream {
     return p_stream->available();
   }
 
+  /// Only converters which keep the size can be processed in place
+  bool isInPlace() override {
+    return p_converter != nullptr && p_converter->isSizePreserving();
+  }
+
+  void processInPlace(uint8_t *data, size_t len) override {
+    p_converter->convert(data, len);
+  }
+
  protected:
   Stream *p_stream = nullptr;
   Print *p_out = nullptr;
@@ -1642,6 +1722,7 @@ class FilteredStream : public ModifyingStream {
   }
 
   bool begin() override {
+    if (p_cascade != nullptr) return AudioStream::begin();
     if (channels == 0) {
       LOGE("channels must not be 0");
       return false;
@@ -1661,16 +1742,18 @@ class FilteredStream : public ModifyingStream {
   }
 
   virtual size_t write(const uint8_t *data, size_t len) override {
-    if (p_converter == nullptr) return 0;
-    size_t result = p_converter->convert((uint8_t *)data, len);
+    BaseConverter *p_conv = getConverter();
+    if (p_conv == nullptr) return 0;
+    size_t result = p_conv->convert((uint8_t *)data, len);
     return p_print->write(data, result);
   }
 
   size_t readBytes(uint8_t *data, size_t len) override {
-    if (p_converter == nullptr) return 0;
+    BaseConverter *p_conv = getConverter();
+    if (p_conv == nullptr) return 0;
     if (p_stream == nullptr) return 0;
     size_t result = p_stream->readBytes(data, len);
-    result = p_converter->convert(data, result);
+    result = p_conv->convert(data, result);
     return result;
   }
 
@@ -1683,6 +1766,19 @@ class FilteredStream : public ModifyingStream {
     return p_print->availableForWrite();
   }
 
+  bool isInPlace() override { return getConverter() != nullptr; }
+
+  void processInPlace(uint8_t *data, size_t len) override {
+    getConverter()->convert(data, len);
+  }
+
+  /// Uses a BiQuadCascade which processes all channels and sections in one
+  /// pass instead of the individual filters per channel
+  template <typename TC>
+  void setCascade(BiQuadCascade<T, TC> &cascade) {
+    p_cascade = &cascade;
+  }
+
   /// defines the filter for an individual channel - the first channel is 0. The
   /// number of channels must have been defined before we can call this
   /// function.
@@ -1706,6 +1802,12 @@ class FilteredStream : public ModifyingStream {
   Stream *p_stream = nullptr;
   Print *p_print = nullptr;
   ConverterNChannels<T, TF> *p_converter = nullptr;
+  BaseConverter *p_cascade = nullptr;
+
+  BaseConverter *getConverter() {
+    if (p_cascade != nullptr) return p_cascade;
+    return p_converter;
+  }
 };
 
 /**
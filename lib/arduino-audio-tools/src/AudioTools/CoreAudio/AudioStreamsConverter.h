@@ -1,6 +1,7 @@
 #pragma once
 #include "AudioIO.h"
 #include "AudioTools/CoreAudio/AudioStreams.h"
+#include "AudioTools/CoreAudio/NumberFormatConverter.h"
 #include "AudioTools/CoreAudio/ResampleStream.h"
 
 namespace audio_tools {
@@ -30,6 +31,9 @@ class ChannelFormatConverterStreamT : public ReformatBaseStream {
     converter.setSourceChannels(from_channels);
     converter.setTargetChannels(to_channels);
 
+    // avoid allocations in write() and readBytes()
+    buffer.resize((int)(DEFAULT_BUFFER_SIZE / sizeof(T) * max(factor, 1.0f)));
+    bufferTmp.resize((int)(DEFAULT_BUFFER_SIZE / min(factor, 1.0f)));
     return true;
   }
 
@@ -359,6 +363,12 @@ class NumberFormatConverterStreamT : public ReformatBaseStream {
   bool begin() override {
     LOGI("begin %d -> %d bits", (int)sizeof(TFrom), (int)sizeof(TTo));
     // is_output_notify = false;
+    setupKernel();
+    // avoid allocations in write() and readBytes()
+    if (is_buffered) {
+      buffer.resize(DEFAULT_BUFFER_SIZE * max(sizeof(TFrom), sizeof(TTo)) /
+                    min(sizeof(TFrom), sizeof(TTo)));
+    }
     return true;
   }
 
@@ -385,8 +395,7 @@ class NumberFormatConverterStreamT : public ReformatBaseStream {
     } else {
       int size_bytes = sizeof(TTo) * samples;
       buffer.resize(size_bytes);
-      NumberConverter::convertArray<TFrom, TTo>(
-          data_source, (TTo *)buffer.data(), samples, gain);
+      convertArray(data_source, (TTo *)buffer.data(), samples);
       p_print->write((uint8_t *)buffer.address(), size_bytes);
       buffer.reset();
     }
@@ -410,8 +419,7 @@ class NumberFormatConverterStreamT : public ReformatBaseStream {
       buffer.resize(sizeof(TFrom) * samples);
       readSamples<TFrom>(p_stream, (TFrom *)buffer.address(), samples);
       TFrom *data = (TFrom *)buffer.address();
-      NumberConverter::convertArray<TFrom, TTo>(data, data_target, samples,
-                                                gain);
+      convertArray(data, data_target, samples);
       buffer.reset();
     }
     return len;
@@ -430,7 +438,17 @@ class NumberFormatConverterStreamT : public ReformatBaseStream {
   void setBuffered(bool flag) { is_buffered = flag; }
 
   /// Defines the gain (only available when buffered is true)
-  void setGain(float value) { gain = value; }
+  void setGain(float value) {
+    gain = value;
+    kernel.setGain(value);
+  }
+
+  /// Activates the TPDF dither when converting to less bits (only available
+  /// when buffered is true)
+  void setDither(bool active) {
+    is_dither = active;
+    kernel.setDither(active);
+  }
 
   float getByteFactor() override {
     return static_cast<float>(sizeof(TTo)) / static_cast<float>(sizeof(TFrom));
@@ -438,14 +456,36 @@ class NumberFormatConverterStreamT : public ReformatBaseStream {
 
  protected:
   SingleBuffer<uint8_t> buffer{0};
+  NumberFormatConverter kernel;
   bool is_buffered = true;
+  bool is_dither = false;
   float gain = 1.0f;
+
+  /// types supported by the NumberFormatConverter are using the specialized
+  /// kernels
+  bool setupKernel() {
+    if (NumberFormatTraits<TFrom>::format == NUMBER_FORMAT_UNDEFINED ||
+        NumberFormatTraits<TTo>::format == NUMBER_FORMAT_UNDEFINED)
+      return false;
+    return kernel.begin(NumberFormatTraits<TFrom>::format,
+                        NumberFormatTraits<TTo>::format, gain, is_dither);
+  }
+
+  void convertArray(TFrom *from, TTo *to, int samples) {
+    if (kernel.isActive() || setupKernel()) {
+      kernel.convert(from, to, samples);
+    } else {
+      NumberConverter::convertArray<TFrom, TTo>(from, to, samples, gain);
+    }
+  }
 };
 
 /**
- * @brief Converter which converts between bits_per_sample and 16 bits.
- * The templated NumberFormatConverterStreamT class is used based on the
- * information provided by the bits_per_sample in the configuration.
+ * @brief Converter which converts between the different bits_per_sample:
+ * 8, 16, 24 and 32 bits are supported in both directions. The conversion
+ * kernel is selected once in begin(): see NumberFormatConverter. With
+ * begin(NumberFormat, NumberFormat) you can also convert from and to packed
+ * 24 bits or float.
  * @ingroup transform
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -493,51 +533,42 @@ class NumberFormatConverterStream : public ReformatBaseStream {
     return begin(from_bit_per_samples, to_bit_per_samples, gain);
   }
 
-  void end() override { cleanupConverter(); }
+  void end() override { converter = NumberFormatConverter(); }
 
   void setToBits(uint8_t bits) { to_bit_per_samples = bits; }
 
   bool begin(int from_bit_per_samples, int to_bit_per_samples,
              float gain = 1.0) {
     LOGI("begin %d -> %d bits", from_bit_per_samples, to_bit_per_samples);
-    bool result = true;
     assert(to_bit_per_samples > 0);
-
-    /// cleanup if we call begin() multiple times w/o end
-    if (p_converter != nullptr) end();
-
-    // store variables
-    this->gain = gain;
     this->from_bit_per_samples = from_bit_per_samples;
     this->to_bit_per_samples = to_bit_per_samples;
+    return begin(NumberFormatConverter::toFormat(from_bit_per_samples),
+                 NumberFormatConverter::toFormat(to_bit_per_samples), gain);
+  }
 
-    if (from_bit_per_samples == to_bit_per_samples) {
+  /// Starts the conversion between the indicated sample formats
+  bool begin(NumberFormat from, NumberFormat to, float gain = 1.0f) {
+    this->gain = gain;
+    from_format = from;
+    to_format = to;
+    from_bit_per_samples = NumberFormatConverter::bits(from);
+    to_bit_per_samples = NumberFormatConverter::bits(to);
+    if (isPassThrough()) {
       LOGI("no bit conversion: %d -> %d", from_bit_per_samples,
            to_bit_per_samples);
-    } else if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      p_converter = new NumberFormatConverterStreamT<int8_t, int16_t>(gain);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      p_converter = new NumberFormatConverterStreamT<int16_t, int8_t>(gain);
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      p_converter = new NumberFormatConverterStreamT<int24_t, int16_t>(gain);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      p_converter = new NumberFormatConverterStreamT<int16_t, int24_t>(gain);
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      p_converter = new NumberFormatConverterStreamT<int32_t, int16_t>(gain);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      p_converter = new NumberFormatConverterStreamT<int16_t, int32_t>(gain);
-    } else {
-      result = false;
-      LOGE("bit combination not supported %d -> %d", from_bit_per_samples,
-           to_bit_per_samples);
-    }
-
-    if (from_bit_per_samples != to_bit_per_samples) {
-      setupStream();
+      return true;
     }
-
+    bool result = converter.begin(from, to, gain, is_dither);
     if (!result) {
-      TRACEE()
+      LOGE("bit combination not supported %d -> %d", from_bit_per_samples,
+           to_bit_per_samples);
+    } else if (is_buffered) {
+      // avoid allocations in write() and readBytes()
+      int bytes_from = converter.bytesFrom();
+      int bytes_to = converter.bytesTo();
+      buffer.resize(DEFAULT_BUFFER_SIZE * max(bytes_from, bytes_to) /
+                    min(bytes_from, bytes_to));
     }
     return result;
   }
@@ -545,191 +576,88 @@ class NumberFormatConverterStream : public ReformatBaseStream {
   virtual size_t write(const uint8_t *data, size_t len) override {
     LOGD("NumberFormatConverterStream::write: %d", (int)len);
     if (p_print == nullptr) return 0;
-    if (from_bit_per_samples == to_bit_per_samples) {
+    if (isPassThrough()) {
       return p_print->write(data, len);
     }
+    if (!converter.isActive()) {
+      TRACEE();
+      return 0;
+    }
 
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      return getConverter<int8_t, int16_t>()->write(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      return getConverter<int16_t, int8_t>()->write(data, len);
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      return getConverter<int24_t, int16_t>()->write(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      return getConverter<int16_t, int24_t>()->write(data, len);
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      return getConverter<int32_t, int16_t>()->write(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      return getConverter<int16_t, int32_t>()->write(data, len);
+    int bytes_from = converter.bytesFrom();
+    int bytes_to = converter.bytesTo();
+    int samples = len / bytes_from;
+    if (is_buffered) {
+      buffer.resize(samples * bytes_to);
+      converter.convert(data, buffer.data(), samples);
+      p_print->write(buffer.data(), samples * bytes_to);
     } else {
-      LOGE("bit combination not supported %d -> %d", from_bit_per_samples,
-           to_bit_per_samples);
-      return 0;
+      uint8_t value[4];
+      for (int j = 0; j < samples; j++) {
+        converter.convert(data + j * bytes_from, value, 1);
+        p_print->write(value, bytes_to);
+      }
     }
+    return len;
   }
 
   size_t readBytes(uint8_t *data, size_t len) override {
     LOGD("NumberFormatConverterStream::readBytes: %d", (int)len);
-    if (from_bit_per_samples == to_bit_per_samples) {
+    if (p_stream == nullptr) return 0;
+    if (isPassThrough()) {
       return p_stream->readBytes(data, len);
     }
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      return getConverter<int8_t, int16_t>()->readBytes(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      return getConverter<int16_t, int8_t>()->readBytes(data, len);
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      return getConverter<int24_t, int16_t>()->readBytes(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      return getConverter<int16_t, int24_t>()->readBytes(data, len);
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      return getConverter<int32_t, int16_t>()->readBytes(data, len);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      return getConverter<int16_t, int32_t>()->readBytes(data, len);
-    } else {
+    if (!converter.isActive()) {
       TRACEE();
       return 0;
     }
+    int bytes_from = converter.bytesFrom();
+    int bytes_to = converter.bytesTo();
+    int samples = len / bytes_to;
+    buffer.resize(samples * bytes_from);
+    samples = readSamples<uint8_t>(p_stream, buffer.data(),
+                                   samples * bytes_from) /
+              bytes_from;
+    converter.convert(buffer.data(), data, samples);
+    return samples * bytes_to;
   }
 
   virtual int available() override {
-    if (from_bit_per_samples == to_bit_per_samples) {
-      return p_stream->available();
-    }
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      return getConverter<int8_t, int16_t>()->available();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      return getConverter<int16_t, int8_t>()->available();
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      return getConverter<int24_t, int16_t>()->available();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      return getConverter<int16_t, int24_t>()->available();
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      return getConverter<int32_t, int16_t>()->available();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      return getConverter<int16_t, int32_t>()->available();
-    } else {
-      TRACEE();
-      return 0;
-    }
+    return p_stream != nullptr ? p_stream->available() : 0;
   }
 
   virtual int availableForWrite() override {
-    if (p_print == nullptr) return 0;
-    if (from_bit_per_samples == to_bit_per_samples) {
-      return p_print->availableForWrite();
-    }
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      return getConverter<int8_t, int16_t>()->availableForWrite();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      return getConverter<int16_t, int8_t>()->availableForWrite();
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      return getConverter<int24_t, int16_t>()->availableForWrite();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      return getConverter<int16_t, int24_t>()->availableForWrite();
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      return getConverter<int32_t, int16_t>()->availableForWrite();
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      return getConverter<int16_t, int32_t>()->availableForWrite();
-    } else {
-      TRACEE();
-      return 0;
-    }
+    return p_print == nullptr ? 0 : p_print->availableForWrite();
   }
 
-  void setBuffered(bool flag) {
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      getConverter<int8_t, int16_t>()->setBuffered(flag);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      getConverter<int16_t, int8_t>()->setBuffered(flag);
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      getConverter<int24_t, int16_t>()->setBuffered(flag);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      getConverter<int16_t, int24_t>()->setBuffered(flag);
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      getConverter<int32_t, int16_t>()->setBuffered(flag);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      getConverter<int16_t, int32_t>()->setBuffered(flag);
-    }
+  /// if set to true we do one big write, else we get a lot of single writes
+  /// per sample
+  void setBuffered(bool flag) { is_buffered = flag; }
+
+  /// Activates the TPDF dither when converting to less bits
+  void setDither(bool active) {
+    is_dither = active;
+    converter.setDither(active);
   }
 
   float getByteFactor() override {
-    return static_cast<float>(to_bit_per_samples) /
-           static_cast<float>(from_bit_per_samples);
+    if (isPassThrough()) return 1.0f;
+    return static_cast<float>(NumberFormatConverter::bytes(to_format)) /
+           static_cast<float>(NumberFormatConverter::bytes(from_format));
   }
 
  protected:
-  void *p_converter = nullptr;
+  NumberFormatConverter converter;
+  Vector<uint8_t> buffer{0};
+  NumberFormat from_format = NUMBER_FORMAT_INT16;
+  NumberFormat to_format = NUMBER_FORMAT_UNDEFINED;
   int from_bit_per_samples = 16;
   int to_bit_per_samples = 0;
   float gain = 1.0;
+  bool is_buffered = true;
+  bool is_dither = false;
 
-  void cleanupConverter() {
-    if (p_converter == nullptr) return;
-
-    if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-      delete static_cast<NumberFormatConverterStreamT<int8_t, int16_t> *>(
-          p_converter);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-      delete static_cast<NumberFormatConverterStreamT<int16_t, int8_t> *>(
-          p_converter);
-    } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-      delete static_cast<NumberFormatConverterStreamT<int24_t, int16_t> *>(
-          p_converter);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-      delete static_cast<NumberFormatConverterStreamT<int16_t, int24_t> *>(
-          p_converter);
-    } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-      delete static_cast<NumberFormatConverterStreamT<int32_t, int16_t> *>(
-          p_converter);
-    } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-      delete static_cast<NumberFormatConverterStreamT<int16_t, int32_t> *>(
-          p_converter);
-    } else {
-      TRACEE();
-    }
-    p_converter = nullptr;
-  }
-
-  template <typename TFrom, typename TTo>
-  NumberFormatConverterStreamT<TFrom, TTo> *getConverter() {
-    return (NumberFormatConverterStreamT<TFrom, TTo> *)p_converter;
-  }
-
-  void setupStream() {
-    if (p_stream != nullptr) {
-      if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-        getConverter<int8_t, int16_t>()->setStream(*p_stream);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-        getConverter<int16_t, int8_t>()->setStream(*p_stream);
-      } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-        getConverter<int24_t, int16_t>()->setStream(*p_stream);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-        getConverter<int16_t, int24_t>()->setStream(*p_stream);
-      } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-        getConverter<int32_t, int16_t>()->setStream(*p_stream);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-        getConverter<int16_t, int32_t>()->setStream(*p_stream);
-      } else {
-        TRACEE();
-      }
-    } else {
-      if (from_bit_per_samples == 8 && to_bit_per_samples == 16) {
-        getConverter<int8_t, int16_t>()->setOutput(*p_print);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 8) {
-        getConverter<int16_t, int8_t>()->setOutput(*p_print);
-      } else if (from_bit_per_samples == 24 && to_bit_per_samples == 16) {
-        getConverter<int24_t, int16_t>()->setOutput(*p_print);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 24) {
-        getConverter<int16_t, int24_t>()->setOutput(*p_print);
-      } else if (from_bit_per_samples == 32 && to_bit_per_samples == 16) {
-        getConverter<int32_t, int16_t>()->setOutput(*p_print);
-      } else if (from_bit_per_samples == 16 && to_bit_per_samples == 32) {
-        getConverter<int16_t, int32_t>()->setOutput(*p_print);
-      } else {
-        TRACEE();
-      }
-    }
-  }
+  bool isPassThrough() { return from_format == to_format && gain == 1.0f; }
 };
 
 /**
@@ -30,6 +30,10 @@ class BaseConverter {
   BaseConverter &operator=(BaseConverter const &) = delete;
 
   virtual size_t convert(uint8_t *src, size_t size) = 0;
+
+  /// Returns true if the result of convert() has always the same size as
+  /// the input
+  virtual bool isSizePreserving() { return false; }
 };
 
 /**
@@ -40,6 +44,7 @@ class BaseConverter {
 class NOPConverter : public BaseConverter {
  public:
   size_t convert(uint8_t(*src), size_t size) override { return size; };
+  bool isSizePreserving() override { return true; }
 };
 
 /**
@@ -78,6 +83,8 @@ class ConverterScaler : public BaseConverter {
     return byte_count;
   }
 
+  bool isSizePreserving() override { return true; }
+
   /// Defines the factor (volume)
   void setFactor(float factor) { this->factor_value = factor; }
 
@@ -274,6 +281,8 @@ class ConverterSwitchLeftAndRight : public BaseConverter {
     return byte_count;
   }
 
+  bool isSizePreserving() override { return true; }
+
  protected:
   int channels = 2;
 };
@@ -1411,6 +1420,13 @@ class MultiConverter : public BaseConverter {
     return size;
   }
 
+  bool isSizePreserving() override {
+    for (int i = 0; i < converters.size(); i++) {
+      if (!converters[i]->isSizePreserving()) return false;
+    }
+    return true;
+  }
+
  private:
   Vector<BaseConverter *> converters;
 };
@@ -1560,12 +1576,15 @@ class Converter1Channel : public BaseConverter {
 
   size_t convert(uint8_t *src, size_t size) override {
     T *data = (T *)src;
-    for (size_t j = 0; j < size; j++) {
+    size_t samples = size / sizeof(T);
+    for (size_t j = 0; j < samples; j++) {
       data[j] = p_filter->process(data[j]);
     }
     return size;
   }
 
+  bool isSizePreserving() override { return true; }
+
  protected:
   Filter<T> *p_filter = nullptr;
 };
@@ -1628,6 +1647,8 @@ class ConverterNChannels : public BaseConverter {
     return size;
   }
 
+  bool isSizePreserving() override { return true; }
+
   int getChannels() { return channels; }
 
  protected:
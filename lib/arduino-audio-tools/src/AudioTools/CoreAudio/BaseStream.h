@@ -65,6 +65,20 @@ class BaseStream : public Stream {
     }
   }
 
+  /// Zero copy read: provides the address of the next readable data and
+  /// returns the number of contiguous bytes (max len). 0 if not supported.
+  virtual size_t peekRead(const uint8_t **data, size_t len) { return 0; }
+
+  /// Zero copy read: marks len bytes provided by peekRead() as consumed
+  virtual size_t commitRead(size_t len) { return 0; }
+
+  /// Zero copy write: provides the address where we can write directly and
+  /// returns the number of contiguous bytes (max len). 0 if not supported.
+  virtual size_t acquireWrite(uint8_t **data, size_t len) { return 0; }
+
+  /// Zero copy write: confirms that len bytes were written via acquireWrite()
+  virtual size_t commitWrite(size_t len) { return 0; }
+
 // Methods which should be suppressed in the documentation
 #ifndef DOXYGEN
 
@@ -103,6 +103,23 @@ class BaseBuffer {
   /// returns the address of the start of the physical read buffer
   virtual T *address() = 0;
 
+  /// Provides the address of the next entry to read: len is set to the number
+  /// of entries which can be read w/o wrap around (0 if not supported)
+  virtual T *readAddress(int &len) {
+    len = 0;
+    return nullptr;
+  }
+
+  /// Provides the address of the next entry to write: len is set to the number
+  /// of entries which can be written w/o wrap around (0 if not supported)
+  virtual T *writeAddress(int &len) {
+    len = 0;
+    return nullptr;
+  }
+
+  /// Confirms that len entries have been written via writeAddress()
+  virtual int commitWrite(int len) { return 0; }
+
   virtual size_t size() = 0;
 
   /// Returns the level of the buffer in %
@@ -368,6 +385,70 @@ class RingBuffer : public BaseBuffer<T> {
     return result;
   }
 
+  /// reads multiple values with max 2 memcpy
+  int readArray(T data[], int len) override {
+    if (data == nullptr) return 0;
+    int result = 0;
+    while (result < len) {
+      int n = 0;
+      T *src = readAddress(n);
+      n = min(n, len - result);
+      if (n <= 0) break;
+      memcpy(data + result, src, n * sizeof(T));
+      clearArray(n);
+      result += n;
+    }
+    return result;
+  }
+
+  /// writes multiple values with max 2 memcpy
+  int writeArray(const T data[], int len) override {
+    if (data == nullptr) return 0;
+    int result = 0;
+    while (result < len) {
+      int n = 0;
+      T *dest = writeAddress(n);
+      n = min(n, len - result);
+      if (n <= 0) break;
+      memcpy(dest, data + result, n * sizeof(T));
+      commitWrite(n);
+      result += n;
+    }
+    return result;
+  }
+
+  /// Removes the next len entries w/o copying them
+  int clearArray(int len) override {
+    int result = min(len, _numElems);
+    if (result <= 0) return 0;
+    _iTail = (_iTail + result) % max_size;
+    _numElems -= result;
+    return result;
+  }
+
+  /// Provides the address of the next entry to read: len is set to the number
+  /// of entries which can be read w/o wrap around
+  T *readAddress(int &len) override {
+    len = min(_numElems, max_size - _iTail);
+    return _aucBuffer.data() + _iTail;
+  }
+
+  /// Provides the address of the next entry to write: len is set to the number
+  /// of entries which can be written w/o wrap around
+  T *writeAddress(int &len) override {
+    len = min(max_size - _numElems, max_size - _iHead);
+    return _aucBuffer.data() + _iHead;
+  }
+
+  /// Confirms that len entries have been written via writeAddress()
+  int commitWrite(int len) override {
+    int result = min(len, availableForWrite());
+    if (result <= 0) return 0;
+    _iHead = (_iHead + result) % max_size;
+    _numElems += result;
+    return result;
+  }
+
   // checks if the buffer is full
   virtual bool isFull() override { return available() == max_size; }
 
@@ -420,9 +501,10 @@ class RingBuffer : public BaseBuffer<T> {
   int _numElems;
   int max_size = 0;
 
-  int nextIndex(int index) { 
-    if (max_size == 0) return 0;
-    return (uint32_t)(index + 1) % max_size; }
+  int nextIndex(int index) {
+    index++;
+    return index >= max_size ? 0 : index;
+  }
 };
 
 /**
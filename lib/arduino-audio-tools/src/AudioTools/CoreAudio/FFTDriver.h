@@ -0,0 +1,83 @@
+/**
+ * @file FFTDriver.h
+ * @author Phil Schatzmann
+ * @brief Abstract FFT driver which is implemented by the different FFT
+ * libraries
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include "AudioTools/CoreAudio/AudioLogger.h"
+
+namespace audio_tools {
+
+/// And individual FFT Bin
+struct FFTBin {
+  float real;
+  float img;
+
+  FFTBin() = default;
+
+  FFTBin(float r, float i) {
+    real = r;
+    img = i;
+  }
+
+  void multiply(float f) {
+    real *= f;
+    img *= f;
+  }
+
+  void conjugate() { img = -img; }
+
+  void clear() { real = img = 0.0f; }
+};
+
+/**
+ * @brief Abstract Class which defines the basic FFT functionality
+ * @ingroup fft
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FFTDriver {
+ public:
+  virtual bool begin(int len) = 0;
+  virtual void end() = 0;
+  /// Sets the real value
+  virtual void setValue(int pos, float value) = 0;
+  /// Perform FFT
+  virtual void fft() = 0;
+  /// Calculate the magnitude (fft result) at index (sqr(i² + r²))
+  virtual float magnitude(int idx) = 0;
+  /// Calculate the magnitude w/o sqare root
+  virtual float magnitudeFast(int idx) = 0;
+  virtual bool isValid() = 0;
+  /// Returns true if reverse FFT is supported
+  virtual bool isReverseFFT() { return false; }
+  /// Calculate reverse FFT
+  virtual void rfft() { LOGE("Not implemented"); }
+  /// Get result value from Reverse FFT
+  virtual float getValue(int pos) = 0;
+  /// sets the value of a bin
+  virtual bool setBin(int idx, float real, float img) { return false; }
+  /// sets the value of a bin
+  bool setBin(int pos, FFTBin &bin) { return setBin(pos, bin.real, bin.img); }
+  /// gets the value of a bin
+  virtual bool getBin(int pos, FFTBin &bin) { return false; }
+  /// gets the complex bin (0..len/2) of the fft of real input data
+  virtual bool getSpectrumBin(int pos, FFTBin &bin) { return getBin(pos, bin); }
+  /// sets the complex bin (0..len/2) for the reverse fft of real output data:
+  /// the conjugate mirror bin is updated as well
+  virtual bool setSpectrumBin(int pos, float real, float img) {
+    if (!setBin(pos, real, img)) return false;
+    int len = length();
+    if (pos > 0 && pos < len / 2) setBin(len - pos, real, -img);
+    return true;
+  }
+  /// Provides the length defined in begin()
+  virtual int length() { return 0; }
+};
+
+}  // namespace audio_tools
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "AudioTools/CoreAudio/FFTDriver.h"
 #include "AudioTools/CoreAudio/AudioBasic/Collections/Vector.h"
 #include "AudioTools/CoreAudio/AudioStreams.h"
 
@@ -9,21 +10,33 @@ namespace audio_tools {
  * @brief Detects frequency using autocorrelation on audio samples.
  * 
  * This class analyzes audio data to estimate the dominant frequency
- * by applying the autocorrelation method. It supports multiple audio
- * channels and different sample formats (16, 24, 32 bits).
+ * with the McLeod pitch method (MPM): we calculate the normalized square
+ * difference function (NSDF) of the last bufferSize frames, select the first
+ * key maximum which reaches the threshold relative to the highest key maximum
+ * and refine the lag with a parabolic interpolation, so that we get a
+ * resolution better than one sample. The analysis is repeated every hop
+ * frames on a sliding window.
+ * 
+ * The autocorrelation is calculated with a FFT if a FFTDriver has been
+ * defined with setFFTDriver() (e.g. FFTDriverRealFFT): this reduces the
+ * effort from O(lag × N) to O(N log N). Otherwise we calculate the NSDF lag
+ * by lag. It supports multiple audio channels and different sample formats
+ * (16, 24, 32 bits).
  * 
  * Usage:
  *  - Feed audio data via write() or readBytes().
  *  - Call frequency(channel) to get the detected frequency for a channel.
  *  - Optionally, set a callback to be notified when a new frequency is detected.
  * 
- * Based on: https://github.com/akellyirl/AutoCorr_Freq_detect
+ * Based on: https://github.com/akellyirl/AutoCorr_Freq_detect and
+ * "A Smarter Way to Find Pitch" by Philip McLeod and Geoff Wyvill
  */
 class FrequencyDetectorAutoCorrelation : public AudioStream {
  public:
   /**
    * @brief Construct with buffer size.
-   * @param bufferSize Number of samples to buffer for analysis.
+   * @param bufferSize Number of frames which are analyzed: it should cover at
+   * least 2 periods of the lowest frequency.
    */
   FrequencyDetectorAutoCorrelation(int bufferSize) {
     buffer_size = bufferSize;
@@ -31,7 +44,7 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
 
   /**
    * @brief Construct with buffer size and output stream.
-   * @param bufferSize Number of samples to buffer for analysis.
+   * @param bufferSize Number of frames which are analyzed.
    * @param out Output stream for writing audio data.
    */
   FrequencyDetectorAutoCorrelation(int bufferSize, Print& out) {
@@ -41,7 +54,7 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
 
   /**
    * @brief Construct with buffer size and input stream.
-   * @param bufferSize Number of samples to buffer for analysis.
+   * @param bufferSize Number of frames which are analyzed.
    * @param in Input stream for reading audio data.
    */
   FrequencyDetectorAutoCorrelation(int bufferSize, Stream& in) {
@@ -65,8 +78,34 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
    * @return true if initialization succeeded.
    */
   bool begin() {
-    buffer.resize(buffer_size * info.channels * info.bits_per_sample / 8);
+    if (buffer_size <= 0 || info.channels <= 0 || info.bits_per_sample <= 0) {
+      LOGE("Invalid setup");
+      return false;
+    }
+    if (!isValidLagRange()) {
+      LOGE("Buffer size %d too small for %d - %d Hz", buffer_size,
+           (int)min_freq, (int)max_freq);
+      return false;
+    }
+    if (maxLag() < (int)(info.sample_rate / min_freq)) {
+      LOGW("Buffer size %d limits the lowest frequency to %d Hz", buffer_size,
+           (int)(info.sample_rate / maxLag()));
+    }
+    int hop = hop_size > 0 && hop_size <= buffer_size ? hop_size
+                                                       : max(1, buffer_size / 4);
+    buffer.resize(hop * info.channels * bytesPerSample());
+    buffer.reset();
+    window.resize(buffer_size * info.channels);
+    memset(window.data(), 0, window.size() * sizeof(float));
+    window_frames = 0;
+    nsdf.resize(buffer_size);
     freq.resize(info.channels);
+    clarities.resize(info.channels);
+    for (int ch = 0; ch < info.channels; ch++) {
+      freq[ch] = 0.0f;
+      clarities[ch] = 0.0f;
+    }
+    if (p_driver != nullptr && !setupFFT()) return false;
     return AudioStream::begin();
   }
 
@@ -94,27 +133,7 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
    */
   size_t readBytes(uint8_t* data, size_t len) override {
     size_t result = p_in->readBytes(data, len);
-    for (int i = 0; i < len; i++) {
-      buffer.write(data[i]);
-      if (buffer.isFull()) {
-        // Process buffer when full, based on sample format
-        switch (info.bits_per_sample) {
-          case 16:
-            detect<int16_t>((int16_t*)buffer.data(),
-                            buffer.available() / sizeof(int16_t));
-            break;
-          case 24:
-            detect<int24_t>((int24_t*)buffer.data(),
-                            buffer.available() / sizeof(int24_t));
-            break;
-          case 32:
-            detect<int32_t>((int32_t*)buffer.data(),
-                            buffer.available() / sizeof(int32_t));
-            break;
-        }
-        buffer.reset();
-      }
-    }
+    addData(data, result);
     return result;
   }
 
@@ -125,28 +144,7 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
    * @return Number of bytes actually written.
    */
   virtual size_t write(const uint8_t* data, size_t len) override {
-    for (int i = 0; i < len; i++) {
-      buffer.write(data[i]);
-      if (buffer.isFull()) {
-        // Process buffer when full, based on sample format
-        switch (info.bits_per_sample) {
-          case 16:
-            detect<int16_t>((int16_t*)buffer.data(),
-                            buffer.available() / sizeof(int16_t));
-            break;
-          case 24:
-            detect<int24_t>((int24_t*)buffer.data(),
-                            buffer.available() / sizeof(int24_t));
-            break;
-          case 32:
-            detect<int32_t>((int32_t*)buffer.data(),
-                            buffer.available() / sizeof(int32_t));
-            break;
-        }
-        buffer.reset();
-      }
-    }
-
+    addData(data, len);
     size_t result = len;
     if (p_out != nullptr) result = p_out->write(data, len);
     return result;
@@ -165,6 +163,19 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
     return freq[channel];
   }
 
+  /**
+   * @brief Returns the clarity (0 to 1) of the last detected frequency: this
+   * is the value of the normalized autocorrelation at the selected lag.
+   * @param channel Channel index.
+   */
+  float clarity(int channel) {
+    if (channel >= info.channels) {
+      LOGE("Invalid channel: %d", channel);
+      return 0;
+    }
+    return clarities[channel];
+  }
+
   /**
    * @brief Returns a default AudioInfo configuration.
    */
@@ -181,69 +192,252 @@ class FrequencyDetectorAutoCorrelation : public AudioStream {
     freq_callback = callback;
   }
 
+  /**
+   * @brief Defines the number of frames after which we analyze the window
+   * again (default: bufferSize / 4). Call before begin().
+   */
+  void setHop(int frames) { hop_size = frames; }
+
+  /**
+   * @brief Defines the range of frequencies which can be detected
+   * (default: 50 to 1000 Hz).
+   */
+  void setFrequencyRange(float minFreq, float maxFreq) {
+    min_freq = minFreq;
+    max_freq = maxFreq;
+  }
+
+  /**
+   * @brief Defines the threshold (0 to 1) relative to the highest key maximum
+   * which selects the period (default: 0.9). Lower values prefer shorter
+   * periods, higher values reduce the risk of octave errors.
+   */
+  void setThreshold(float threshold) { this->threshold = threshold; }
+
+  /**
+   * @brief Calculates the autocorrelation with the indicated FFT driver
+   * (e.g. FFTDriverRealFFT) which needs to support the reverse FFT. Call
+   * before begin().
+   */
+  void setFFTDriver(FFTDriver& driver) { p_driver = &driver; }
+
  protected:
   Vector<float> freq;                ///< Stores detected frequency for each channel
+  Vector<float> clarities;           ///< Clarity of the detected frequency
   Print* p_out = nullptr;            ///< Output stream pointer
   Stream* p_in = nullptr;            ///< Input stream pointer
-  void (*freq_callback)(int channel, float freq); ///< Frequency callback function
-  int buffer_size = 0;               ///< Buffer size in samples
-  SingleBuffer<uint8_t> buffer;      ///< Buffer for incoming audio data
+  void (*freq_callback)(int channel, float freq) = nullptr; ///< Frequency callback function
+  int buffer_size = 0;               ///< Buffer size in frames
+  int hop_size = 0;                  ///< Frames between two analyses
+  float min_freq = 50.0f;            ///< Lowest detected frequency
+  float max_freq = 1000.0f;          ///< Highest detected frequency
+  float threshold = 0.9f;            ///< Key maximum threshold
+  SingleBuffer<uint8_t> buffer;      ///< Collects the data of one hop
+  Vector<float> window;              ///< Last buffer_size frames per channel
+  int window_frames = 0;             ///< Number of valid frames in window
+  Vector<float> nsdf;                ///< Normalized square difference function
+  FFTDriver* p_driver = nullptr;     ///< Optional FFT for the autocorrelation
+  int fft_len = 0;                   ///< FFT length
+  float fft_scale = 1.0f;            ///< Gain of the fft and reverse fft
+
+  int bytesPerSample() {
+    return info.bits_per_sample == 24 ? sizeof(int24_t)
+                                      : info.bits_per_sample / 8;
+  }
+
+  /// Collects the data and analyzes the window after each hop
+  void addData(const uint8_t* data, size_t len) {
+    if (buffer.size() == 0) return;
+    size_t pos = 0;
+    while (pos < len) {
+      int n = min((int)(len - pos), buffer.availableForWrite());
+      buffer.writeArray(data + pos, n);
+      pos += n;
+      if (buffer.isFull()) {
+        // Process buffer when full, based on sample format
+        switch (info.bits_per_sample) {
+          case 16:
+            detect<int16_t>((int16_t*)buffer.data(),
+                            buffer.available() / sizeof(int16_t));
+            break;
+          case 24:
+            detect<int24_t>((int24_t*)buffer.data(),
+                            buffer.available() / sizeof(int24_t));
+            break;
+          case 32:
+            detect<int32_t>((int32_t*)buffer.data(),
+                            buffer.available() / sizeof(int32_t));
+            break;
+        }
+        buffer.reset();
+      }
+    }
+  }
 
   /**
-   * @brief Detects frequency for all channels using autocorrelation.
+   * @brief Adds the samples of one hop to the window and detects the
+   * frequency for all channels when the window is full.
    * @tparam T Sample type (int16_t, int24_t, int32_t)
    * @param samples Pointer to audio samples.
    * @param len Number of samples.
    */
   template <class T>
   void detect(T* samples, size_t len) {
-    freq.resize(info.channels);
-    for (int ch = 0; ch < info.channels; ch++) {
-      freq[ch] = detectFrequencyForChannel(ch, samples, len);
+    int channels = info.channels;
+    int frames = len / channels;
+    int keep = buffer_size - frames;
+    for (int ch = 0; ch < channels; ch++) {
+      float* w = window.data() + ch * buffer_size;
+      memmove(w, w + frames, keep * sizeof(float));
+      for (int j = 0; j < frames; j++) {
+        w[keep + j] = NumberConverter::toFloatT<T>(samples[j * channels + ch]);
+      }
+    }
+    window_frames = min(window_frames + frames, buffer_size);
+    if (window_frames < buffer_size) return;
+
+    for (int ch = 0; ch < channels; ch++) {
+      freq[ch] = detectFrequencyForChannel(ch);
       if (freq_callback) freq_callback(ch, freq[ch]);
     }
   }
 
+  /// Shortest period which is evaluated
+  int minLag() { return max(2, (int)(info.sample_rate / max_freq)); }
+
+  /// Longest period which is evaluated: limited by the buffer size
+  int maxLag() {
+    return min((int)(info.sample_rate / min_freq), buffer_size / 2);
+  }
+
+  /// Checks if the buffer is big enough for the frequency range
+  bool isValidLagRange() { return minLag() + 2 < maxLag(); }
+
   /**
-   * @brief Performs autocorrelation to estimate frequency for a single channel.
-   * @tparam T Sample type.
+   * @brief Estimates the frequency of a single channel with the McLeod pitch
+   * method.
    * @param ch Channel index.
-   * @param samples Pointer to audio samples.
-   * @param len Number of samples.
-   * @return Detected frequency in Hz.
+   * @return Detected frequency in Hz or 0.
    */
-  template <class T>
-  float detectFrequencyForChannel(int ch, T* samples, size_t len) {
-    LOGD("detectFrequencyForChannel: %d / len: %u", ch, (unsigned int)len);
-    // Prepare variables for autocorrelation
-    int sample_rate = info.sample_rate;
-    int channels = info.channels;
-    int buffer_size = len / info.channels;
-
-    // Autocorrelation lag range: 1000 Hz max, 50 Hz min
-    size_t min_lag = sample_rate / 1000;
-    size_t max_lag = sample_rate / 50;
-    if (max_lag >= buffer_size) max_lag = buffer_size - 1;
+  float detectFrequencyForChannel(int ch) {
+    const float* x = window.data() + ch * buffer_size;
+    int n = buffer_size;
+    // Autocorrelation lag range: validated in begin()
+    int min_lag = minLag();
+    int max_lag = maxLag();
+    clarities[ch] = 0.0f;
+    if (!isValidLagRange()) return 0.0f;
+    LOGD("lag min/max: %d / %d", min_lag, max_lag);
+
+    if (p_driver != nullptr) autoCorrelationFFT(x, max_lag + 1);
+
+    // m(lag) = sum of x[j]^2 + x[j+lag]^2: updated incrementally
+    float m = 0.0f;
+    for (int j = 0; j < n; j++) m += x[j] * x[j];
+    m *= 2.0f;
+    if (m <= 1.0e-9f) return 0.0f;
+    int first = min_lag - 1;
+    for (int lag = 1; lag < first; lag++) {
+      m -= x[lag - 1] * x[lag - 1] + x[n - lag] * x[n - lag];
+    }
 
-    LOGD("lag min/max: %u / %u", (unsigned)min_lag, (unsigned)max_lag);
+    // calculate the nsdf for the full lag range: the highest key maximum is
+    // needed to select the period
+    int last = max_lag;
+    for (int lag = first; lag <= max_lag; lag++) {
+      m -= x[lag - 1] * x[lag - 1] + x[n - lag] * x[n - lag];
+      float r = p_driver != nullptr ? nsdf[lag] : autoCorrelation(x, lag);
+      nsdf[lag] = m > 0.0f ? 2.0f * r / m : 0.0f;
+    }
 
-    float max_corr = 0.0f;
-    size_t best_lag = 0;
-    for (size_t lag = min_lag; lag < max_lag; ++lag) {
-      float sum = 0.0f;
-      for (size_t i = 0; i < buffer_size - lag; ++i) {
-        sum += samples[i * channels] * samples[(i + lag) * channels];
+    // select the first key maximum which reaches threshold * highest
+    float highest = 0.0f;
+    for (int lag = first + 1; lag < last; lag++) {
+      if (isPeak(lag) && nsdf[lag] > highest) highest = nsdf[lag];
+    }
+    if (highest <= 0.0f) return 0.0f;
+    int best_lag = 0;
+    int key_lag = 0;
+    for (int lag = first + 1; lag <= last; lag++) {
+      if (lag < last && isPeak(lag) &&
+          (key_lag == 0 || nsdf[lag] > nsdf[key_lag])) {
+        key_lag = lag;
       }
-      if (sum > max_corr) {
-        max_corr = sum;
-        best_lag = lag;
+      if ((nsdf[lag] <= 0.0f || lag == last) && key_lag > 0) {
+        if (nsdf[key_lag] >= threshold * highest) {
+          best_lag = key_lag;
+          break;
+        }
+        key_lag = 0;
       }
     }
+    if (best_lag == 0) return 0.0f;
 
-    LOGD("best_lag: %u / max_corr: %f", (unsigned)best_lag, max_corr);
+    // parabolic interpolation
+    float a = nsdf[best_lag - 1];
+    float b = nsdf[best_lag];
+    float c = nsdf[best_lag + 1];
+    float denom = a - 2.0f * b + c;
+    float delta = denom < 0.0f ? 0.5f * (a - c) / denom : 0.0f;
+    clarities[ch] = b - 0.25f * (a - c) * delta;
+    LOGD("lag: %f / clarity: %f", best_lag + delta, clarities[ch]);
+    return (float)info.sample_rate / (best_lag + delta);
+  }
 
-    if (best_lag == 0) return 0.0f;
-    return (float)sample_rate / best_lag;
+  /// Positive local maximum of the nsdf
+  bool isPeak(int lag) {
+    return nsdf[lag] > 0.0f && nsdf[lag] > nsdf[lag - 1] &&
+           nsdf[lag] >= nsdf[lag + 1];
+  }
+
+  /// Autocorrelation for a single lag
+  float autoCorrelation(const float* x, int lag) {
+    float sum = 0.0f;
+    int n = buffer_size - lag;
+    for (int j = 0; j < n; j++) sum += x[j] * x[j + lag];
+    return sum;
+  }
+
+  /// Calculates the autocorrelation for all lags < count into nsdf
+  void autoCorrelationFFT(const float* x, int count) {
+    for (int j = 0; j < fft_len; j++) {
+      p_driver->setValue(j, j < buffer_size ? x[j] : 0.0f);
+    }
+    p_driver->fft();
+    FFTBin bin;
+    for (int k = 0; k <= fft_len / 2; k++) {
+      p_driver->getSpectrumBin(k, bin);
+      p_driver->setSpectrumBin(k, bin.real * bin.real + bin.img * bin.img,
+                               0.0f);
+    }
+    p_driver->rfft();
+    for (int lag = 0; lag < count; lag++) {
+      nsdf[lag] = p_driver->getValue(lag) / fft_scale;
+    }
+  }
+
+  /// The fft is zero padded, so that the result is not circular
+  bool setupFFT() {
+    fft_len = 1;
+    while (fft_len < buffer_size + buffer_size / 2 + 1) fft_len <<= 1;
+    if (!p_driver->begin(fft_len) || !p_driver->isReverseFFT()) {
+      LOGE("FFT driver not available");
+      return false;
+    }
+    // determine the gain of the fft followed by the reverse fft
+    for (int j = 0; j < fft_len; j++) {
+      p_driver->setValue(j, j == 0 ? 1.0f : 0.0f);
+    }
+    p_driver->fft();
+    FFTBin bin;
+    for (int k = 0; k <= fft_len / 2; k++) {
+      p_driver->getSpectrumBin(k, bin);
+      p_driver->setSpectrumBin(k, bin.real, bin.img);
+    }
+    p_driver->rfft();
+    fft_scale = p_driver->getValue(0);
+    if (fft_scale == 0.0f) fft_scale = 1.0f;
+    return true;
   }
 };
 
@@ -388,7 +582,7 @@ class FrequencyDetectorZeroCrossing : public AudioStream {
   Stream* p_in = nullptr;            ///< Input stream pointer
   int count = 0;                     ///< Sample count (unused, kept for compatibility)
   bool active = false;               ///< Counting active flag (unused, kept for compatibility)
-  void (*freq_callback)(int channel, float freq); ///< Frequency callback function
+  void (*freq_callback)(int channel, float freq) = nullptr; ///< Frequency callback function
 
   /**
    * @brief Detects frequency for all channels using zero crossing method.
@@ -0,0 +1,360 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include "AudioToolsConfig.h"
+#include "AudioTools/CoreAudio/AudioLogger.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Sample formats which are supported by the NumberFormatConverter
+ * @ingroup basic
+ */
+enum NumberFormat {
+  NUMBER_FORMAT_UNDEFINED = 0,
+  NUMBER_FORMAT_INT8,
+  NUMBER_FORMAT_INT16,
+  /// 24 bits packed in 3 bytes (int24_3bytes_t)
+  NUMBER_FORMAT_INT24_PACKED,
+  /// 24 bits left aligned in 4 bytes (int24_4bytes_t)
+  NUMBER_FORMAT_INT24_IN_32,
+  NUMBER_FORMAT_INT32,
+  /// float with a range of -1.0 to 1.0
+  NUMBER_FORMAT_FLOAT,
+};
+
+/**
+ * @brief Describes how a sample type is converted from and to a full scale
+ * int32_t (Q31) value. Only the specialized types are supported by the
+ * NumberFormatConverter.
+ * @ingroup basic
+ */
+template <typename T>
+struct NumberFormatTraits {
+  static const NumberFormat format = NUMBER_FORMAT_UNDEFINED;
+  static const int bits = sizeof(T) * 8;
+  static const int bytes = sizeof(T);
+  static inline int32_t toQ31(const void *data, int idx) { return 0; }
+  static inline void fromQ31(void *data, int idx, int32_t value) {}
+};
+
+template <>
+struct NumberFormatTraits<int8_t> {
+  static const NumberFormat format = NUMBER_FORMAT_INT8;
+  static const int bits = 8;
+  static const int bytes = 1;
+  static inline int32_t toQ31(const void *data, int idx) {
+    return (int32_t)((const int8_t *)data)[idx] * (1 << 24);
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    ((int8_t *)data)[idx] = value >> 24;
+  }
+};
+
+template <>
+struct NumberFormatTraits<int16_t> {
+  static const NumberFormat format = NUMBER_FORMAT_INT16;
+  static const int bits = 16;
+  static const int bytes = 2;
+  static inline int32_t toQ31(const void *data, int idx) {
+    return (int32_t)((const int16_t *)data)[idx] * (1 << 16);
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    ((int16_t *)data)[idx] = value >> 16;
+  }
+};
+
+/// little endian 24 bits in 3 bytes
+template <>
+struct NumberFormatTraits<int24_3bytes_t> {
+  static const NumberFormat format = NUMBER_FORMAT_INT24_PACKED;
+  static const int bits = 24;
+  static const int bytes = 3;
+  static inline int32_t toQ31(const void *data, int idx) {
+    const uint8_t *p = (const uint8_t *)data + idx * 3;
+    return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) |
+                     ((uint32_t)p[2] << 24));
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    uint8_t *p = (uint8_t *)data + idx * 3;
+    p[0] = (uint32_t)value >> 8;
+    p[1] = (uint32_t)value >> 16;
+    p[2] = (uint32_t)value >> 24;
+  }
+};
+
+/// 24 bits which are stored shifted by 1 byte to the left in an int32_t
+template <>
+struct NumberFormatTraits<int24_4bytes_t> {
+  static const NumberFormat format = NUMBER_FORMAT_INT24_IN_32;
+  static const int bits = 24;
+  static const int bytes = 4;
+  static inline int32_t toQ31(const void *data, int idx) {
+    return ((const int32_t *)data)[idx];
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    ((int32_t *)data)[idx] = value & (int32_t)0xFFFFFF00;
+  }
+};
+
+template <>
+struct NumberFormatTraits<int32_t> {
+  static const NumberFormat format = NUMBER_FORMAT_INT32;
+  static const int bits = 32;
+  static const int bytes = 4;
+  static inline int32_t toQ31(const void *data, int idx) {
+    return ((const int32_t *)data)[idx];
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    ((int32_t *)data)[idx] = value;
+  }
+};
+
+template <>
+struct NumberFormatTraits<float> {
+  static const NumberFormat format = NUMBER_FORMAT_FLOAT;
+  static const int bits = 32;
+  static const int bytes = 4;
+  static inline int32_t toQ31(const void *data, int idx) {
+    float value = ((const float *)data)[idx] * 2147483648.0f;
+    if (value >= 2147483647.0f) return 2147483647;
+    if (value <= -2147483648.0f) return -2147483647 - 1;
+    return (int32_t)value;
+  }
+  static inline void fromQ31(void *data, int idx, int32_t value) {
+    ((float *)data)[idx] = (float)value * (1.0f / 2147483648.0f);
+  }
+};
+
+/**
+ * @brief Converts arrays of samples between int8_t, int16_t, int24_3bytes_t,
+ * int24_4bytes_t, int32_t and float. Each combination is a separate
+ * templated kernel which is selected from a table in begin(), so that the
+ * conversion itself is a tight loop without any run time decisions. Values
+ * are rounded when the target has less bits and we support an optional TPDF
+ * dither and a gain.
+ * The source and target must not overlap!
+ * @ingroup basic
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class NumberFormatConverter {
+ public:
+  NumberFormatConverter() = default;
+
+  NumberFormatConverter(NumberFormat from, NumberFormat to, float gain = 1.0f,
+                        bool dither = false) {
+    begin(from, to, gain, dither);
+  }
+
+  /// Selects the conversion kernel
+  bool begin(NumberFormat from, NumberFormat to, float gain = 1.0f,
+             bool dither = false) {
+    from_format = from;
+    to_format = to;
+    this->gain = gain;
+    is_dither = dither;
+    p_convert = nullptr;
+    if (from == NUMBER_FORMAT_UNDEFINED || to == NUMBER_FORMAT_UNDEFINED ||
+        from > NUMBER_FORMAT_FLOAT || to > NUMBER_FORMAT_FLOAT) {
+      LOGE("Unsupported number format %d -> %d", from, to);
+      return false;
+    }
+    // table of the kernel selection functions by source format
+    static const SelectFn rows_fast[] = {
+        selectNone,
+        selectFast<int8_t>,
+        selectFast<int16_t>,
+        selectFast<int24_3bytes_t>,
+        selectFast<int24_4bytes_t>,
+        selectFast<int32_t>,
+        selectFast<float>};
+    static const SelectFn rows_general[] = {
+        selectNone,
+        selectGeneral<int8_t>,
+        selectGeneral<int16_t>,
+        selectGeneral<int24_3bytes_t>,
+        selectGeneral<int24_4bytes_t>,
+        selectGeneral<int32_t>,
+        selectGeneral<float>};
+    bool is_general = gain != 1.0f || (dither && isNarrowing());
+    p_convert = is_general ? rows_general[from](to) : rows_fast[from](to);
+    return p_convert != nullptr;
+  }
+
+  /// Selects the kernel for the indicated bits_per_sample: 24 bits is using
+  /// the int24_t type
+  bool begin(int from_bits, int to_bits, float gain = 1.0f,
+             bool dither = false) {
+    return begin(toFormat(from_bits), toFormat(to_bits), gain, dither);
+  }
+
+  /// Converts the indicated number of samples: returns the number of samples
+  int convert(const void *from, void *to, int samples) {
+    if (p_convert == nullptr || samples <= 0) return 0;
+    p_convert(from, to, samples, *this);
+    return samples;
+  }
+
+  /// Defines a new gain and reselects the kernel
+  void setGain(float value) {
+    gain = value;
+    if (p_convert != nullptr) begin(from_format, to_format, gain, is_dither);
+  }
+
+  /// Activates the TPDF dither when the target has less bits
+  void setDither(bool active) {
+    is_dither = active;
+    if (p_convert != nullptr) begin(from_format, to_format, gain, is_dither);
+  }
+
+  /// Returns true if a kernel has been selected
+  bool isActive() { return p_convert != nullptr; }
+
+  /// Provides the number of bytes of the input samples
+  int bytesFrom() { return bytes(from_format); }
+
+  /// Provides the number of bytes of the output samples
+  int bytesTo() { return bytes(to_format); }
+
+  /// Returns true if the target has less bits than the source
+  bool isNarrowing() { return bits(to_format) < bits(from_format); }
+
+  /// Determines the NumberFormat from the bits_per_sample
+  static NumberFormat toFormat(int bits) {
+    switch (bits) {
+      case 8:
+        return NUMBER_FORMAT_INT8;
+      case 16:
+        return NUMBER_FORMAT_INT16;
+      case 24:
+        return NumberFormatTraits<int24_t>::format;
+      case 32:
+        return NUMBER_FORMAT_INT32;
+    }
+    return NUMBER_FORMAT_UNDEFINED;
+  }
+
+  /// Provides the size of a sample in bytes
+  static int bytes(NumberFormat format) {
+    static const int8_t sizes[] = {0, 1, 2, 3, 4, 4, 4};
+    return format <= NUMBER_FORMAT_FLOAT ? sizes[format] : 0;
+  }
+
+  /// Provides the number of significant bits
+  static int bits(NumberFormat format) {
+    static const int8_t values[] = {0, 8, 16, 24, 24, 32, 32};
+    return format <= NUMBER_FORMAT_FLOAT ? values[format] : 0;
+  }
+
+ protected:
+  typedef void (*ConvertFn)(const void *from, void *to, int samples,
+                            NumberFormatConverter &self);
+  typedef ConvertFn (*SelectFn)(NumberFormat to);
+
+  NumberFormat from_format = NUMBER_FORMAT_UNDEFINED;
+  NumberFormat to_format = NUMBER_FORMAT_UNDEFINED;
+  ConvertFn p_convert = nullptr;
+  float gain = 1.0f;
+  bool is_dither = false;
+  uint32_t random_state = 0x12345678;
+
+  /// Fast xorshift random number generator for the dither
+  inline uint32_t nextRandom() {
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+  }
+
+  /// Saturating conversion of a float to Q31
+  static inline int32_t clipQ31(float value) {
+    if (value >= 2147483647.0f) return 2147483647;
+    if (value <= -2147483648.0f) return -2147483647 - 1;
+    return (int32_t)value;
+  }
+
+  /// Kernel w/o gain and dither: plain shifts with rounding
+  template <typename TFrom, typename TTo>
+  static void convertFast(const void *from, void *to, int samples,
+                          NumberFormatConverter &self) {
+    typedef NumberFormatTraits<TFrom> From;
+    typedef NumberFormatTraits<TTo> To;
+    if (From::format == To::format) {
+      memcpy(to, from, samples * From::bytes);
+      return;
+    }
+    if (To::bits < From::bits) {
+      // round to nearest w/o overflow
+      const int32_t half = (int32_t)(((int64_t)1 << 31) >> To::bits);
+      const int32_t limit = 2147483647 - half;
+      for (int j = 0; j < samples; j++) {
+        int32_t value = From::toQ31(from, j);
+        value = value > limit ? 2147483647 : value + half;
+        To::fromQ31(to, j, value);
+      }
+    } else {
+      for (int j = 0; j < samples; j++) {
+        To::fromQ31(to, j, From::toQ31(from, j));
+      }
+    }
+  }
+
+  /// Kernel with gain and optional TPDF dither
+  template <typename TFrom, typename TTo>
+  static void convertGeneral(const void *from, void *to, int samples,
+                             NumberFormatConverter &self) {
+    typedef NumberFormatTraits<TFrom> From;
+    typedef NumberFormatTraits<TTo> To;
+    const float gain = self.gain;
+    const bool narrow = To::bits < From::bits || gain != 1.0f;
+    // half and full LSB of the target in Q31 (0 for 32 bit targets)
+    const int64_t half = narrow ? ((int64_t)1 << 31) >> To::bits : 0;
+    const uint32_t mask =
+        self.is_dither && half > 0 ? (uint32_t)(2 * half - 1) : 0;
+    for (int j = 0; j < samples; j++) {
+      int64_t value = From::toQ31(from, j);
+      if (gain != 1.0f) value = clipQ31(gain * value);
+      value += half;
+      if (mask != 0) {
+        // triangular distribution with +- 1 LSB of the target
+        value += (int64_t)(self.nextRandom() & mask) +
+                 (self.nextRandom() & mask) - mask;
+      }
+      if (value > 2147483647) value = 2147483647;
+      if (value < -2147483647 - 1) value = -2147483647 - 1;
+      To::fromQ31(to, j, (int32_t)value);
+    }
+  }
+
+  template <typename TFrom>
+  static ConvertFn selectFast(NumberFormat to) {
+    static const ConvertFn row[] = {nullptr,
+                                    convertFast<TFrom, int8_t>,
+                                    convertFast<TFrom, int16_t>,
+                                    convertFast<TFrom, int24_3bytes_t>,
+                                    convertFast<TFrom, int24_4bytes_t>,
+                                    convertFast<TFrom, int32_t>,
+                                    convertFast<TFrom, float>};
+    return row[to];
+  }
+
+  template <typename TFrom>
+  static ConvertFn selectGeneral(NumberFormat to) {
+    static const ConvertFn row[] = {nullptr,
+                                    convertGeneral<TFrom, int8_t>,
+                                    convertGeneral<TFrom, int16_t>,
+                                    convertGeneral<TFrom, int24_3bytes_t>,
+                                    convertGeneral<TFrom, int24_4bytes_t>,
+                                    convertGeneral<TFrom, int32_t>,
+                                    convertGeneral<TFrom, float>};
+    return row[to];
+  }
+
+  static ConvertFn selectNone(NumberFormat to) { return nullptr; }
+};
+
+}  // namespace audio_tools
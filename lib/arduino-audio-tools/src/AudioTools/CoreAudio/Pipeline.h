@@ -3,6 +3,7 @@
 #include "AudioTools/CoreAudio/AudioIO.h"
 #include "AudioTools/CoreAudio/AudioOutput.h"
 #include "AudioTools/CoreAudio/AudioStreams.h"
+#include "AudioTools/CoreAudio/AudioBasic/Collections/AllocatorRegion.h"
 
 namespace audio_tools {
 
@@ -10,6 +11,12 @@ namespace audio_tools {
  * @brief We can build a input or an output chain: an input chain starts with
  * setInput(); followed by add() an output chain consinsts of add() and ends
  * with setOutput();
+ * With setFused(true) consecutive components which modify the data in place
+ * (e.g. VolumeStream, FilteredStream, Equalizer3Bands) are processed
+ * together in one pass over a block before the data is passed on.
+ * With setAllocator() the memory of the fused stages (the stages and their
+ * blocks) is taken from a region which is reset in begin() and end(). The
+ * buffers of the components themselves are not affected.
  * @ingroup transform
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -129,6 +136,7 @@ class Pipeline : public AudioStream {
     // must be first
     has_input = true;
     p_stream = &in;
+    p_input = &in;
     return true;
   }
 
@@ -143,11 +151,13 @@ class Pipeline : public AudioStream {
 
   size_t write(const uint8_t* data, size_t len) override {
     if (!is_active) return 0;
+    ALLOCATION_GUARD_SCOPE();
     if (size() == 0) {
       if (p_print != nullptr) return p_print->write(data, len);
       return 0;
     }
     LOGD("write: %u", (unsigned)len);
+    if (p_first_fused != nullptr) return p_first_fused->write(data, len);
     return components[0]->write(data, len);
   }
 
@@ -160,6 +170,7 @@ class Pipeline : public AudioStream {
 
   size_t readBytes(uint8_t* data, size_t len) override {
     if (!is_active) return 0;
+    ALLOCATION_GUARD_SCOPE();
     Stream* in = getInput();
     if (in == nullptr) return 0;
     return in->readBytes(data, len);
@@ -198,6 +209,10 @@ class Pipeline : public AudioStream {
       ok = ok && p_ai_input->begin();
     }
 
+    // combine the in place components
+    unfuse();
+    if (is_fused) fuse();
+
     setNotifyActive(true);
     is_active = ok;
     is_ok = ok;
@@ -206,6 +221,7 @@ class Pipeline : public AudioStream {
 
   /// Calls end on all components
   void end() override {
+    unfuse();
     for (auto c : components) {
       c->end();
     }
@@ -221,15 +237,23 @@ class Pipeline : public AudioStream {
     p_out_stream = nullptr;
     p_print = nullptr;
     p_stream = nullptr;
+    p_input = nullptr;
     p_ai_source = nullptr;
     p_ai_input = nullptr;
     is_ok = false;
     is_active = true;
+    if (p_region != nullptr) {
+      LOGI("region high water: %zu bytes", p_region->highWater());
+    }
   }
 
   /// Defines the AudioInfo for the first node
   void setAudioInfo(AudioInfo newInfo) override {
     this->info = newInfo;
+    // keep the fused blocks aligned to full frames
+    if (!has_input) {
+      for (auto p_fused : fused) p_fused->block.resize(fusedBlockSize());
+    }
     if (has_input && p_ai_input != nullptr) {
       p_ai_input->setAudioInfo(info);
     } else if (has_output) {
@@ -280,6 +304,27 @@ class Pipeline : public AudioStream {
   /// Returns true if pipeline is correctly set up
   bool isOK() { return is_ok; }
 
+  /// Process consecutive in place components in one pass: call before begin()
+  void setFused(bool flag) { is_fused = flag; }
+
+  /// Returns true if the fused processing is active
+  bool isFused() { return is_fused; }
+
+  /// Defines the max block size in bytes which is used by the fused processing
+  bool setFusedBlockSize(int bytes) {
+    if (bytes <= 0) {
+      LOGE("Invalid fused block size: %d", bytes);
+      return false;
+    }
+    fused_block_size = bytes;
+    return true;
+  }
+
+  /// Defines the region from which the fused stages are allocated: it is
+  /// reset in begin() and end(), so it must not be shared with other objects.
+  /// Call before begin().
+  void setAllocator(AllocatorRegion& region) { p_region = &region; }
+
   /// Returns true if pipeline is correctly set up and is active
   operator bool() override { return is_ok && is_active; }
 
@@ -290,8 +335,11 @@ class Pipeline : public AudioStream {
   bool has_input = false;
   bool is_ok = true;
   bool is_active = true;
+  bool is_fused = false;
+  int fused_block_size = DEFAULT_BUFFER_SIZE;
   // prior input for input pipline
   Stream* p_stream = nullptr;
+  Stream* p_input = nullptr;
   AudioInfoSource* p_ai_source = nullptr;
   AudioStream* p_ai_input = nullptr;
   // output for notifications, begin and end calls
@@ -327,11 +375,166 @@ class Pipeline : public AudioStream {
     ModifyingOutput* p_out = nullptr;
   };
 
+  /// Runs the in place processing of consecutive components over one block
+  struct FusedStage : public ModifyingStream {
+    FusedStage(int start, int end) {
+      this->start = start;
+      this->end_idx = end;
+    }
+    void setStream(Stream& in) override { p_in = &in; }
+    void setOutput(Print& out) override { p_out = &out; }
+    int available() override { return p_in == nullptr ? 0 : p_in->available(); }
+    int availableForWrite() override {
+      return p_out == nullptr ? 0 : p_out->availableForWrite();
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+      if (p_out == nullptr || block.size() == 0) return 0;
+      size_t result = 0;
+      while (result < len) {
+        size_t n = MIN(len - result, (size_t)block.size());
+        memcpy(block.data(), data + result, n);
+        process(block.data(), n);
+        size_t written = p_out->write(block.data(), n);
+        result += written;
+        if (written < n) break;
+      }
+      return result;
+    }
+
+    size_t readBytes(uint8_t* data, size_t len) override {
+      if (p_in == nullptr) return 0;
+      size_t result = p_in->readBytes(data, len);
+      process(data, result);
+      return result;
+    }
+
+    void process(uint8_t* data, size_t len) {
+      for (auto c : stages) {
+        c->processInPlace(data, len);
+      }
+    }
+
+    Vector<ModifyingStream*> stages{0};
+    Vector<uint8_t> block{0};
+    Stream* p_in = nullptr;
+    Print* p_out = nullptr;
+    int start = 0;
+    int end_idx = 0;
+  };
+  Vector<FusedStage*> fused{0};
+  FusedStage* p_first_fused = nullptr;
+  FusedStage* p_last_fused = nullptr;
+  AllocatorRegion* p_region = nullptr;
+
+  Allocator& allocator() {
+    if (p_region != nullptr) return *p_region;
+    return DefaultAllocator;
+  }
+
+  FusedStage* newFusedStage(int start, int end) {
+    void* addr = allocator().allocate(sizeof(FusedStage));
+    if (addr == nullptr) return nullptr;
+    FusedStage* result = new (addr) FusedStage(start, end);
+    result->stages.setAllocator(allocator());
+    result->block.setAllocator(allocator());
+    return result;
+  }
+
+  void deleteFusedStage(FusedStage* p_fused) {
+    p_fused->~FusedStage();
+    allocator().free(p_fused);
+  }
+
+  /// Replaces runs of at least 2 in place components by a FusedStage
+  void fuse() {
+    int start = 0;
+    while (start < size()) {
+      int end = start;
+      while (end < size() && components[end]->isInPlace()) end++;
+      if (end - start >= 2) {
+        addFusedStage(start, end);
+        start = end;
+      } else {
+        start++;
+      }
+    }
+    LOGI("fused stages: %d", (int)fused.size());
+  }
+
+  void addFusedStage(int start, int end) {
+    FusedStage* p_fused = newFusedStage(start, end);
+    if (p_fused == nullptr) return;
+    // size the vectors only once: the region can not release memory
+    p_fused->stages.resize(end - start);
+    for (int j = start; j < end; j++) {
+      p_fused->stages[j - start] = components[j];
+    }
+    if (has_input) {
+      // input chain: read from the predecessor
+      p_fused->setStream(start == 0 ? *p_input : *components[start - 1]);
+      if (end < size()) {
+        components[end]->setStream(*p_fused);
+      } else {
+        p_last_fused = p_fused;
+      }
+    } else {
+      // output chain: write to the successor
+      Print* p_out = end < size() ? components[end] : p_print;
+      if (p_out == nullptr) {
+        deleteFusedStage(p_fused);
+        return;
+      }
+      p_fused->setOutput(*p_out);
+      // reserve the max size so that setAudioInfo() does not reallocate
+      p_fused->block.resize(fused_block_size);
+      p_fused->block.resize(fusedBlockSize());
+      if (start == 0) {
+        p_first_fused = p_fused;
+      } else {
+        components[start - 1]->setOutput(*p_fused);
+      }
+    }
+    fused.push_back(p_fused);
+  }
+
+  /// Restores the original chaining
+  void unfuse() {
+    for (auto p_fused : fused) {
+      int start = p_fused->start;
+      int end = p_fused->end_idx;
+      if (has_input) {
+        if (end < size()) components[end]->setStream(*components[end - 1]);
+      } else if (start > 0) {
+        components[start - 1]->setOutput(*components[start]);
+      }
+      deleteFusedStage(p_fused);
+    }
+    fused.clear();
+    p_first_fused = nullptr;
+    p_last_fused = nullptr;
+    // all memory of the region has been released
+    if (p_region != nullptr) p_region->reset();
+  }
+
+  /// block size which is a multiple of the frame size
+  int fusedBlockSize() {
+    AudioInfo cfg = audioInfo();
+    int frame_size = cfg.channels * (cfg.bits_per_sample == 24
+                                         ? sizeof(int24_t)
+                                         : cfg.bits_per_sample / 8);
+    if (frame_size <= 0 || frame_size > fused_block_size)
+      return fused_block_size;
+    return fused_block_size / frame_size * frame_size;
+  }
+
   /// we read from the last node or the defined input: null if no input is
   /// available
   Stream* getInput() {
     Stream* in = p_stream;
-    if (size() > 0) {
+    if (p_last_fused != nullptr) {
+      in = p_last_fused;
+    } else if (size() > 0) {
       in = &last();
     }
     return in;
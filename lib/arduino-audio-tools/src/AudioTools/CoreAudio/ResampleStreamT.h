@@ -29,6 +29,10 @@ struct BaseInterpolator {
     // make sure the buffer has enough space for entries
     int size = vectorSize();
     values.resize(size);
+    // start w/o any history
+    values.clear();
+    step = 0;
+    setup();
     return true;
   }
 
@@ -87,6 +91,7 @@ struct BaseInterpolator {
     step_size = step;
     // clear the buffer to start fresh
     values.clear();
+    setup();
   }
 
  protected:
@@ -97,6 +102,16 @@ struct BaseInterpolator {
 
   virtual int vectorSize() = 0;
 
+  /// Optional setup which is called in begin() and when the step size changes
+  virtual void setup() {}
+
+ public:
+  /// Allows to reuse the setup data (e.g. a coefficient table) of another
+  /// interpolator of the same type which always uses the same step size.
+  virtual void shareSetup(BaseInterpolator &master) {}
+
+ protected:
+
   /**
    * @brief Interpolation function to be implemented by derived classes.
    * @param y Pointer to the buffer of 4 values.
@@ -245,22 +260,139 @@ struct ParabolicInterpolator : public BaseInterpolator {
   }
 };
 
+/**
+ * @brief Polyphase FIR interpolation with a Blackman windowed sinc using
+ * y[0]..y[TAPS-1]. The coefficients for all PHASES fractional positions are
+ * calculated in begin() (and when the step size changes): the result is
+ * linearly interpolated between the dot products with the two nearest
+ * phases. For
+ * downsampling the cutoff is lowered to avoid aliasing. Each instance has
+ * its own coefficient table: the channels of a MultiChannelResampler share
+ * the table of the first channel.
+ *
+ * Valid for xf in [0,1].
+ * @tparam TAPS Number of filter taps (even)
+ * @tparam PHASES Number of fractional positions
+ */
+template <int TAPS = 16, int PHASES = 128>
+struct PolyphaseInterpolator : public BaseInterpolator {
+  int vectorSize() {
+    return TAPS;
+  }  ///< Minimum number of values required for interpolation
+  /**
+   * @brief Computes the FIR interpolation: the result is linearly
+   * interpolated between the two nearest phases.
+   * @param y Pointer to at least TAPS values.
+   * @param xf The fractional index for interpolation.
+   * @return Interpolated value.
+   */
+  float value(float* y, float xf) {
+    int x = xf;
+    float pf = (xf - x) * PHASES;
+    int phase = static_cast<int>(pf);
+    if (phase >= PHASES) phase = PHASES - 1;
+    float frac = pf - phase;
+    const float* coef0 = coefficients() + phase * TAPS;
+    const float* coef1 = coef0 + TAPS;
+    y += x;
+    float result0 = 0.0f;
+    float result1 = 0.0f;
+    for (int j = 0; j < TAPS; j++) {
+      result0 += y[j] * coef0[j];
+      result1 += y[j] * coef1[j];
+    }
+    return result0 + frac * (result1 - result0);
+  }
+
+  /// Uses the coefficient table of the master
+  void shareSetup(BaseInterpolator& master) override {
+    p_master = static_cast<PolyphaseInterpolator*>(&master);
+    if (p_master == this) p_master = nullptr;
+    if (p_master != nullptr) table.resize(0);
+  }
+
+ protected:
+  /// Coefficients: (PHASES + 1) rows of TAPS values
+  Vector<float> table{0};
+  /// Cutoff of the actual coefficients (relative to the input nyquist)
+  float table_cutoff = 0.0f;
+  /// Optional interpolator which provides the table
+  PolyphaseInterpolator* p_master = nullptr;
+
+  const float* coefficients() {
+    return p_master != nullptr ? p_master->table.data() : table.data();
+  }
+
+  void setup() override {
+    if (p_master != nullptr) return;
+    float cutoff = step_size > 1.0f ? 1.0f / step_size : 1.0f;
+    if (cutoff == table_cutoff && table.size() > 0) return;
+    table_cutoff = cutoff;
+    Vector<float>& coef = table;
+    coef.resize((PHASES + 1) * TAPS);
+    const float pi = 3.14159265358979f;
+    for (int phase = 0; phase <= PHASES; phase++) {
+      float dx = static_cast<float>(phase) / PHASES;
+      float* row = coef.data() + phase * TAPS;
+      float sum = 0.0f;
+      for (int j = 0; j < TAPS; j++) {
+        // distance of the tap to the interpolated position
+        float t = j - (TAPS / 2 - 1) - dx;
+        float sinc = t == 0.0f ? 1.0f : sinf(pi * cutoff * t) / (pi * cutoff * t);
+        float w = 0.42f + 0.5f * cosf(2.0f * pi * t / TAPS) +
+                  0.08f * cosf(4.0f * pi * t / TAPS);
+        row[j] = cutoff * sinc * w;
+        sum += row[j];
+      }
+      // unity gain
+      for (int j = 0; j < TAPS; j++) {
+        row[j] /= sum;
+      }
+    }
+  }
+};
+
+/// Polyphase interpolation with 8 taps: lowest cost
+using PolyphaseInterpolatorFast = PolyphaseInterpolator<8, 64>;
+/// Polyphase interpolation with 16 taps
+using PolyphaseInterpolatorMedium = PolyphaseInterpolator<16, 128>;
+/// Polyphase interpolation with 32 taps: best quality
+using PolyphaseInterpolatorHigh = PolyphaseInterpolator<32, 256>;
+
 /**
  * @brief Multi-channel resampler that applies a BaseInterpolator-derived algorithm
  * to each channel.
  *
+ * Besides the frame based addValues()/getValues() it supports a block based
+ * processing: store the de-interleaved input values with blockInput(), call
+ * processBlock() and get the result with blockOutput(). The block based API
+ * keeps its own state, so the two APIs should not be mixed. The read position
+ * is accumulated in fixed point, so the result does not depend on the block
+ * size.
+ *
  * @tparam TInterpolator The resampler type (must derive from BaseInterpolator).
  */
 template <class TInterpolator>
 class MultiChannelResampler {
  public:
   void setChannels(int channels) {
-    if (_channels == channels) return;
-
-    _resamplers.resize(channels);
-    // create new resamplers
-    _channels = channels;
+    if (_channels != channels) {
+      _resamplers.resize(channels);
+      // create new resamplers
+      _channels = channels;
+      // the channels always use the same step size: share the setup data
+      for (int i = 1; i < _channels; ++i) {
+        _resamplers[i].shareSetup(_resamplers[0]);
+      }
+    }
+    // restart the block processing: also when the channels did not change
+    _block_frames = 0;
+    _in_stride = 0;
+    _out_stride = 0;
+    _history = 0;
+    _pos = 0;
     for (int i = 0; i < _channels; ++i) {
+      _resamplers[i].setStepSize(_step_size);
       _resamplers[i].begin();
     }
   }
@@ -270,6 +402,8 @@ class MultiChannelResampler {
    * @param step The new step size.
    */
   void setStepSize(float step) {
+    _step_size = step;
+    _step = static_cast<int64_t>(step * 4294967296.0 + 0.5);
     for (int i = 0; i < _channels; ++i) {
       _resamplers[i].setStepSize(step);
     }
@@ -316,9 +450,113 @@ class MultiChannelResampler {
    */
   int channels() const { return _channels; }
 
+  /**
+   * @brief Makes sure that the block buffers can process the indicated number
+   * of input frames. Call this before blockInput().
+   * @param frames Max number of input frames per processBlock() call.
+   */
+  void resizeBlock(int frames) {
+    if (_channels <= 0) return;
+    int history = _resamplers[0].vectorSize() - 1;
+    // keep the history values when we need to grow
+    if (frames > _block_frames) {
+      int in_stride = history + frames;
+      Vector<float> tmp{0};
+      tmp.resize(in_stride * _channels);
+      for (int ch = 0; ch < _channels; ++ch) {
+        for (int j = 0; j < _history; ++j) {
+          tmp[ch * in_stride + j] = _in[ch * _in_stride + j];
+        }
+      }
+      _in.swap(tmp);
+      _in_stride = in_stride;
+      _block_frames = frames;
+    }
+    int out_stride = static_cast<int>((frames + history + 1) / _step_size) + 2;
+    if (out_stride > _out_stride) {
+      _out_stride = out_stride;
+      _out.resize(_out_stride * _channels);
+    }
+  }
+
+  /**
+   * @brief Provides the address where the input values of the indicated
+   * channel need to be stored for the next processBlock().
+   */
+  float* blockInput(int channel) {
+    return _in.data() + channel * _in_stride + _history;
+  }
+
+  /**
+   * @brief Resamples the frames which were stored via blockInput().
+   * @param frames Number of input frames per channel.
+   * @return Number of output frames which are available via blockOutput().
+   */
+  int processBlock(int frames) {
+    if (_channels <= 0 || frames <= 0) return 0;
+    int size = _resamplers[0].vectorSize();
+    int total = _history + frames;
+    if (_step <= 0) return 0;
+    // outputs are possible as long as we have size values from int(pos)
+    const int64_t one = 4294967296LL;
+    int64_t limit = (total - size + 1) * one;
+    int count = 0;
+    if (_pos < limit) {
+      int64_t n = (limit - _pos + _step - 1) / _step;
+      count = n > _out_stride ? _out_stride : static_cast<int>(n);
+    }
+
+    for (int ch = 0; ch < _channels; ++ch) {
+      TInterpolator& interpolator = _resamplers[ch];
+      const float* in = _in.data() + ch * _in_stride;
+      float* out = _out.data() + ch * _out_stride;
+      int64_t pos = _pos;
+      for (int j = 0; j < count; ++j) {
+        // the position is never negative
+        int x = static_cast<int>(pos >> 32);
+        float dx = static_cast<uint32_t>(pos) * (1.0f / 4294967296.0f);
+        // qualified call to avoid the virtual dispatch
+        out[j] = interpolator.TInterpolator::value(const_cast<float*>(in) + x,
+                                                   dx);
+        pos += _step;
+      }
+    }
+
+    // keep the last values as history for the next block
+    int new_history = total < size - 1 ? total : size - 1;
+    for (int ch = 0; ch < _channels; ++ch) {
+      float* in = _in.data() + ch * _in_stride;
+      memmove(in, in + total - new_history, new_history * sizeof(float));
+    }
+    _pos += count * _step;
+    _pos -= (total - new_history) * one;
+    _history = new_history;
+    return count;
+  }
+
+  /**
+   * @brief Provides the result of the last processBlock() for the indicated
+   * channel.
+   */
+  float* blockOutput(int channel) {
+    return _out.data() + channel * _out_stride;
+  }
+
  protected:
   int _channels = 0;
   Vector<TInterpolator> _resamplers;
+  // block processing
+  Vector<float> _in{0};
+  Vector<float> _out{0};
+  int _in_stride = 0;
+  int _out_stride = 0;
+  int _block_frames = 0;
+  int _history = 0;
+  /// read position and step in Q32 fixed point: the positions do not depend
+  /// on the block size
+  int64_t _pos = 0;
+  int64_t _step = 4294967296LL;
+  float _step_size = 1.0f;
 };
 
 /**
@@ -399,6 +637,7 @@ class ResampleStreamT : public ReformatBaseStream {
       cfg.step_size = 1.0f;
       setStepSize(1.0f);
     }
+    preallocate(DEFAULT_BUFFER_SIZE);
     return true;
   }
 
@@ -485,6 +724,21 @@ class ResampleStreamT : public ReformatBaseStream {
   MultiChannelResampler<TInterpolator> _resampler;
   ResampleConfig cfg;
 
+  Vector<uint8_t> _out_buffer{0};
+
+  /// Allocates the buffers for writes of up to the indicated number of
+  /// bytes, so that write() does not need to allocate any memory
+  void preallocate(size_t bytes) {
+    int frame_size = info.channels * (info.bits_per_sample == 24
+                                          ? sizeof(int24_t)
+                                          : info.bits_per_sample / 8);
+    if (frame_size <= 0 || cfg.step_size <= 0.0f) return;
+    int frames = bytes / frame_size;
+    _resampler.resizeBlock(frames);
+    size_t out_bytes = (frames / cfg.step_size + 2) * frame_size;
+    if (_out_buffer.size() < out_bytes) _out_buffer.resize(out_bytes);
+  }
+
   /// Writes the buffer to defined output after resampling
   template <typename T>
   size_t writeT(Print* p_out, const uint8_t* buffer, size_t bytes,
@@ -496,41 +750,42 @@ class ResampleStreamT : public ReformatBaseStream {
       return p_out->write(buffer, bytes);
     }
 
-    // resample the data
     int channels = audioInfo().channels;
+    if (channels <= 0) return 0;
     T* data = (T*)buffer;
-    float frame[channels];
-    size_t frames = bytes / (sizeof(T) * channels);
-    size_t frames_written = 0;
-    for (size_t i = 0; i < frames; ++i) {
-      // fill frame (of floats) with values from data
-      for (int ch = 0; ch < channels; ++ch) {
-        frame[ch] = static_cast<float>(data[i * channels + ch]);
+    int frames = bytes / (sizeof(T) * channels);
+    if (frames == 0) return 0;
+
+    // de-interleave the data into float blocks
+    _resampler.resizeBlock(frames);
+    for (int ch = 0; ch < channels; ++ch) {
+      float* in = _resampler.blockInput(ch);
+      for (int i = 0; i < frames; ++i) {
+        in[i] = static_cast<float>(data[i * channels + ch]);
       }
+    }
 
-      // Add values to resampler
-      _resampler.addValues(frame);
-
-      // Get resampled values
-      float result[channels];
-      while (_resampler.getValues(result)) {
-        // Convert float to correct output type
-        T resultT[channels];
-        for (int ch = 0; ch < channels; ++ch) {
-          resultT[ch] = NumberConverter::clipT<T>(result[ch]);
-        }
-
-        // Write the frame
-        size_t to_write = sizeof(T) * channels;
-        size_t written = p_out->write((const uint8_t*)resultT, to_write);
-        if (written != to_write) {
-          LOGE("write error %zu -> %zu", to_write, written);
-        }
-        frames_written++;
+    // resample all channels
+    int frames_out = _resampler.processBlock(frames);
+    if (frames_out == 0) return 0;
+
+    // interleave the result and convert it to the output type
+    size_t to_write = frames_out * sizeof(T) * channels;
+    if (_out_buffer.size() < to_write) _out_buffer.resize(to_write);
+    T* out = (T*)_out_buffer.data();
+    for (int ch = 0; ch < channels; ++ch) {
+      const float* result = _resampler.blockOutput(ch);
+      for (int i = 0; i < frames_out; ++i) {
+        out[i * channels + ch] = NumberConverter::clipT<T>(result[i]);
       }
     }
 
-    return frames_written * sizeof(T) * channels;
+    // write all frames at once
+    written = p_out->write(_out_buffer.data(), to_write);
+    if (written != to_write) {
+      LOGE("write error %zu -> %zu", to_write, written);
+    }
+    return written;
   }
 };
 
@@ -36,6 +36,18 @@ class StreamCopyT {
             begin(to, from);
         }
 
+        StreamCopyT(BaseStream &to, AudioStream &from, int bufferSize=DEFAULT_BUFFER_SIZE){
+            TRACED();
+            this->buffer_size = bufferSize;
+            begin(to, from);
+        }
+
+        StreamCopyT(AudioOutput &to, AudioStream &from, int bufferSize=DEFAULT_BUFFER_SIZE){
+            TRACED();
+            this->buffer_size = bufferSize;
+            begin(to, from);
+        }
+
         StreamCopyT(int bufferSize=DEFAULT_BUFFER_SIZE){
             TRACED();
             this->buffer_size = bufferSize;
@@ -63,11 +75,15 @@ class StreamCopyT {
         /// Ends the processing
         void end() {
             this->from = nullptr;
+            this->from_audio = nullptr;
             this->to = nullptr;
+            this->to_stream = nullptr;
+            this->to_output = nullptr;
         }
 
         /// assign a new output and input stream
         void begin(Print &to, Stream &from){
+            end();
             this->from = &from;
             this->to = &to;
             begin();
@@ -75,12 +91,25 @@ class StreamCopyT {
 
         /// assign a new output and input stream
         void begin(Print &to, AudioStream &from){
+            end();
             this->from = &from;
             this->from_audio = &from;
             this->to = &to;
             begin();
         }
 
+        /// assign a new output and input stream: supports zero copy on both sides
+        void begin(BaseStream &to, AudioStream &from){
+            begin((Print&)to, from);
+            this->to_stream = &to;
+        }
+
+        /// assign a new output and input stream: supports zero copy on both sides
+        void begin(AudioOutput &to, AudioStream &from){
+            begin((Print&)to, from);
+            this->to_output = &to;
+        }
+
         /// Provides a pointer to the copy source. Can be used to check if the source is defined.
         Stream *getFrom(){
             return from;
@@ -106,6 +135,7 @@ class StreamCopyT {
         /// copies the inicated number of bytes from the source to the destination and returns the processed number of bytes
         inline size_t copyBytes(size_t bytes){
             LOGD("copy %d bytes %s", (int) bytes, log_name);
+            ALLOCATION_GUARD_SCOPE();
             if (!active) return 0;
             // if not initialized we do nothing
             if (from==nullptr && to==nullptr) return 0;
@@ -149,25 +179,28 @@ class StreamCopyT {
                     bytes_to_read = samples * minCopySize();
                 }
 
-                // get the data now
-                bytes_read = 0;
-                if (bytes_to_read>0){
-                    bytes_read = from->readBytes((uint8_t*)&buffer[0], bytes_to_read);
-                }
+                // try to avoid the copy buffer
+                if (bytes_to_read==0 || !copyZeroCopy(bytes_to_read, bytes_read, result, delayCount)){
+                    // get the data now
+                    bytes_read = 0;
+                    if (bytes_to_read>0){
+                        bytes_read = from->readBytes((uint8_t*)&buffer[0], bytes_to_read);
+                    }
 
-                // determine mime
-                if (p_mime_detector != nullptr){
-                    p_mime_detector->write(buffer.data(), bytes_to_read);
-                }
+                    // determine mime
+                    if (p_mime_detector != nullptr){
+                        p_mime_detector->write(buffer.data(), bytes_to_read);
+                    }
 
-                // convert data
-                if (p_converter!=nullptr) p_converter->convert((uint8_t*)buffer.data(),  bytes_read );
+                    // convert data
+                    if (p_converter!=nullptr) p_converter->convert((uint8_t*)buffer.data(),  bytes_read );
 
-                // write data
-                result = write(bytes_read, delayCount);
+                    // write data
+                    result = write(bytes_read, delayCount);
 
-                // callback with unconverted data
-                if (onWrite!=nullptr) onWrite(onWriteObj, &buffer[0], result);
+                    // callback with unconverted data
+                    if (onWrite!=nullptr) onWrite(onWriteObj, &buffer[0], result);
+                }
 
                 #ifndef COPY_LOG_OFF
                 LOGI("StreamCopy::copy %s %u -> %u -> %u bytes - in %u hops",log_name, (unsigned int)bytes_to_read,(unsigned int) bytes_read, (unsigned int)result, (unsigned int)delayCount);
@@ -351,10 +384,22 @@ class StreamCopyT {
             p_mime_detector = &mime;
         }
 
+        /// Activates/deactivates the zero copy processing if the source or target supports it - active by default
+        void setZeroCopy(bool flag){
+            is_zero_copy = flag;
+        }
+
+        /// Is zero copy activated ?
+        bool isZeroCopy() {
+            return is_zero_copy;
+        }
+
     protected:
         Stream *from = nullptr;
         AudioStream *from_audio = nullptr;
         Print *to = nullptr;
+        BaseStream *to_stream = nullptr;
+        AudioOutput *to_output = nullptr;
         Vector<uint8_t> buffer{0};
         int buffer_size = DEFAULT_BUFFER_SIZE;
         void (*onWrite)(void*obj, void*buffer, size_t len) = nullptr;
@@ -373,6 +418,7 @@ class StreamCopyT {
         AudioInfoSupport *p_audio_info_support = nullptr;
         BaseConverter* p_converter = nullptr;
         MimeDetector* p_mime_detector = nullptr;
+        bool is_zero_copy = true;
 
         void syncAudioInfo(){
             // synchronize audio info
@@ -386,15 +432,59 @@ class StreamCopyT {
             }
         }
 
+        /// Copies w/o the copy buffer: the target provides the memory or the source provides the data. Returns false if not supported.
+        bool copyZeroCopy(size_t len, size_t &bytesRead, size_t &result, size_t &delayCount){
+            if (!is_zero_copy) return false;
+            int copy_size = minCopySize();
+
+            // read directly into the memory of the target
+            uint8_t *data = nullptr;
+            size_t avail = 0;
+            if (to_stream != nullptr) avail = to_stream->acquireWrite(&data, len);
+            else if (to_output != nullptr) avail = to_output->acquireWrite(&data, len);
+            if (copy_size > 0) avail = avail / copy_size * copy_size;
+            if (avail > 0){
+                bytesRead = from->readBytes(data, avail);
+                if (p_mime_detector != nullptr) p_mime_detector->write(data, bytesRead);
+                if (p_converter!=nullptr) p_converter->convert(data, bytesRead);
+                result = to_stream != nullptr ? to_stream->commitWrite(bytesRead) : to_output->commitWrite(bytesRead);
+                delayCount++;
+                if (onWrite!=nullptr) onWrite(onWriteObj, data, result);
+                return true;
+            }
+
+            // write directly from the memory of the source: the converter would modify the source data
+            if (p_converter == nullptr && from_audio != nullptr){
+                const uint8_t *src = nullptr;
+                avail = from_audio->peekRead(&src, len);
+                if (copy_size > 0) avail = avail / copy_size * copy_size;
+                if (avail > 0){
+                    bytesRead = avail;
+                    if (p_mime_detector != nullptr) p_mime_detector->write((uint8_t*)src, avail);
+                    result = write(src, avail, delayCount);
+                    from_audio->commitRead(result);
+                    if (onWrite!=nullptr) onWrite(onWriteObj, (void*)src, result);
+                    return true;
+                }
+            }
+            return false;
+        }
+
         /// blocking write - until everything is processed
         size_t write(size_t len, size_t &delayCount ){
-            if (!buffer || len==0) return 0;
+            if (!buffer) return 0;
+            return write(buffer.data(), len, delayCount);
+        }
+
+        /// blocking write of the indicated data - until everything is processed
+        size_t write(const uint8_t *data, size_t len, size_t &delayCount ){
+            if (data == nullptr || len==0) return 0;
             LOGD("write: %d", (int)len);
             size_t total = 0;
             long open = len;
             int retry = 0;
             while(open > 0){
-                size_t written = to->write((const uint8_t*)buffer.data()+total, open);
+                size_t written = to->write(data+total, open);
                 LOGD("write: %d -> %d", (int) open, (int) written);
                 total += written;
                 open -= written;
@@ -7,6 +7,13 @@
 
 namespace audio_tools {
 
+/**
+ * @brief Defines how a volume change is applied: immediately or spread over
+ * the next block of samples
+ * @ingroup volume
+ */
+enum VolumeRamp { NO_RAMP, LINEAR_RAMP, EXPONENTIAL_RAMP };
+
 /**
  * @brief Config for VolumeStream
  * @author Phil Schatzmann
@@ -19,6 +26,8 @@ struct VolumeStreamConfig : public AudioInfo {
   }
   bool allow_boost = false;
   float volume=1.0;  // start_volume
+  VolumeRamp ramp = NO_RAMP; // use LINEAR_RAMP to avoid zipper noise
+  uint16_t ramp_ms = 10; // duration of a volume ramp
 };
 
 
@@ -26,6 +35,10 @@ struct VolumeStreamConfig : public AudioInfo {
  * @brief Adjust the volume of the related input or output: To work properly the class needs to know the 
  * bits per sample and number of channels!
  * AudioChanges are forwareded to the related Print or Stream class.
+ * Volume changes can be ramped over ramp_ms milliseconds independent of the
+ * size of the written blocks (see VolumeRamp), so no additional fade is
+ * needed. With PREFER_FIXEDPOINT the gain is applied as Q15 fixed point value
+ * (Q31 for 32 bit samples without boost).
  * @ingroup transform
  * @ingroup volume
  * @author Phil Schatzmann
@@ -128,6 +141,17 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
             cached_volume.setVolumeControl(pot_vc);
         }
 
+        /// Defines how volume changes are applied
+        void setVolumeRamp(VolumeRamp ramp){
+            info.ramp = ramp;
+        }
+
+        /// Defines how volume changes are applied and the duration of the ramp
+        void setVolumeRamp(VolumeRamp ramp, uint16_t ms){
+            info.ramp = ramp;
+            info.ramp_ms = ms;
+        }
+
         /// Read raw PCM audio data, which will be the input for the volume control 
         virtual size_t readBytes(uint8_t *data, size_t len) override { 
             TRACED();
@@ -156,6 +180,12 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
             return p_out==nullptr? 0 : p_out->availableForWrite();
         }
 
+        bool isInPlace() override { return true; }
+
+        void processInPlace(uint8_t *data, size_t len) override {
+            if (isVolumeUpdate()) applyVolume(data, len);
+        }
+
         /// Provides the nubmer of bytes we can write
         virtual int available() override { 
             return p_in==nullptr? 0 : p_in->available();
@@ -200,14 +230,18 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
                 float factor = volumeControl().getVolumeFactor(volume_value);
                 volume_values[channel]=volume_value;
                 #if PREFER_FIXEDPOINT
-                    //convert float to fixed point 2.6
-                    //Fixedpoint-Math from https://github.com/earlephilhower/ESP8266Audio/blob/0abcf71012f6128d52a6bcd155ed1404d6cc6dcd/src/AudioOutput.h#L67
-                    if(factor > 4.0) factor = 4.0;//factor can only be >1 if allow_boost == true TODO: should we update volume_values[channel] if factor got clipped to 4.0?
-                    uint8_t factorF2P6 = (uint8_t) (factor*(1<<6));
-                    factor_for_channel[channel] = factorF2P6;
-                #else
-                    factor_for_channel[channel]=factor;
+                // the fixed point gain is limited to 4.0
+                if (factor > 4.0f) factor = 4.0f;
                 #endif
+                factor_for_channel[channel] = factor;
+                // no ramp before we have started
+                if (!is_started || info.ramp == NO_RAMP) {
+                  current_factor[channel] = factor;
+                  ramp_frames[channel] = 0;
+                } else {
+                  // (re)start the ramp from the actual factor
+                  ramp_frames[channel] = rampFrames();
+                }
               }
               return true;
             } else {
@@ -242,13 +276,11 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
         SimulatedAudioPot pot_vc;
         CachedVolumeControl cached_volume{pot_vc};
         Vector<float> volume_values;
-        #if PREFER_FIXEDPOINT
-            Vector<uint8_t> factor_for_channel; //Fixed point 2.6
-        #else
-            Vector<float> factor_for_channel;
-        #endif
+        Vector<float> factor_for_channel; // target factor
+        Vector<float> current_factor; // factor at the end of the last block
+        Vector<int> ramp_frames; // open frames of the ramp to the target factor
         bool is_started = false;
-        float max_value = 32767; // max value for clipping
+        int32_t max_value = 32767; // max value for clipping
         int max_channels = 0;
 
         // checks if volume needs to be updated
@@ -261,6 +293,8 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
         bool isAllChannelsFullVolume(){
             for (int ch=0;ch<info.channels;ch++){
                 if (volume_values[ch]!=1.0) return false;
+                // we are still ramping
+                if (current_factor[ch]!=factor_for_channel[ch]) return false;
             }
             return true;
         }
@@ -268,6 +302,8 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
         /// Resizes the vectors
         void setupVectors() {
             factor_for_channel.resize(info.channels);
+            current_factor.resize(info.channels);
+            ramp_frames.resize(info.channels);
             volume_values.resize(info.channels);
         }
 
@@ -279,6 +315,8 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
             cfg1.bits_per_sample = cfg.bits_per_sample;
             // keep volume which might habe been defined befor calling begin
             cfg1.volume = info.volume;  
+            cfg1.ramp = info.ramp;
+            cfg1.ramp_ms = info.ramp_ms;
             return cfg1;
         }
 
@@ -305,74 +343,166 @@ class VolumeStream : public ModifyingStream, public VolumeSupport {
             return cached_volume;
         }
 
-        #if PREFER_FIXEDPOINT
-        uint8_t factorForChannel(int channel){
-        #else
         float factorForChannel(int channel){
-        #endif
-            return factor_for_channel.size()==0? 1.0 : factor_for_channel[channel];
+            return factor_for_channel.size()==0? 1.0f : factor_for_channel[channel];
         }
 
         void applyVolume(const uint8_t *buffer, size_t size){
             switch(info.bits_per_sample){
                 case 16:
-                    applyVolume16((int16_t*)buffer, size/2);
+                    applyVolumeT<int16_t>((int16_t*)buffer, size/2);
                     break;
                 case 24:
-                    applyVolume24((int24_t*)buffer, size/sizeof(int24_t));
+                    applyVolumeT<int24_t>((int24_t*)buffer, size/sizeof(int24_t));
                     break;
                 case 32:
-                    applyVolume32((int32_t*)buffer, size/4);
+                    applyVolumeT<int32_t>((int32_t*)buffer, size/4);
                     break;
                 default:
                     LOGE("Unsupported bits_per_sample: %d", info.bits_per_sample);
             }
         }
 
-        void applyVolume16(int16_t* data, size_t size){
-            for (size_t j=0;j<size;j++){
-                #if PREFER_FIXEDPOINT
-                int32_t result = (data[j] * factorForChannel(j%info.channels)) >> 6; //Fixedpoint-Math from https://github.com/earlephilhower/ESP8266Audio/blob/0abcf71012f6128d52a6bcd155ed1404d6cc6dcd/src/AudioOutput.h#L67
-                #else
-                float result = factorForChannel(j%info.channels) * data[j];
-                #endif
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int16_t>(result);
+        /// Number of frames of a volume ramp
+        int rampFrames() {
+            int frames = (int64_t)info.sample_rate * info.ramp_ms / 1000;
+            return frames > 0 ? frames : 1;
+        }
+
+        /// Factor which is reached after frames of the open ramp frames
+        float rampFactor(float start, float target, int frames, int open){
+            if (frames >= open) return target;
+            if (info.ramp == LINEAR_RAMP) {
+                return start + (target - start) * frames / open;
+            }
+            const float min_factor = 0.0001f; // -80 dB
+            float from = start < min_factor ? min_factor : start;
+            float to = target < min_factor ? min_factor : target;
+            return from * powf(to / from, static_cast<float>(frames) / open);
+        }
+
+        /// Applies the volume per channel: ramps from the current to the target
+        /// factor, which might take several blocks
+        template <typename T>
+        void applyVolumeT(T* data, size_t samples){
+            int channels = info.channels;
+            if (channels <= 0 || current_factor.size() < channels) return;
+            int frames = samples / channels;
+            if (frames == 0) return;
+            for (int ch=0; ch<channels; ch++){
+                float start = current_factor[ch];
+                float target = factorForChannel(ch);
+                int open = ramp_frames[ch];
+                if (start == target || open == 0 || info.ramp == NO_RAMP) {
+                    applyGainT<T>(data + ch, frames, channels, target, target);
+                    current_factor[ch] = target;
+                    ramp_frames[ch] = 0;
+                    continue;
+                }
+                int n = min(frames, open);
+                float end = rampFactor(start, target, n, open);
+                if (info.ramp == LINEAR_RAMP) {
+                    applyGainT<T>(data + ch, n, channels, start, end);
+                } else {
+                    applyExponentialRampT<T>(data + ch, n, channels, start, end);
+                }
+                // the ramp has ended within the block
+                if (n < frames) {
+                    applyGainT<T>(data + ch + n * channels, frames - n, channels, target, target);
+                }
+                current_factor[ch] = end;
+                ramp_frames[ch] = open - n;
             }
         }
 
-        void applyVolume24(int24_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                #if PREFER_FIXEDPOINT
-                int32_t result = (data[j] * factorForChannel(j%info.channels)) >> 6; //8bits * 24bits = fits into 32
-                #else
-                float result = factorForChannel(j%info.channels) * data[j];
-                #endif
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                int32_t result1 = result;
-                data[j]= static_cast<int24_t>(result1);
+        /// Exponential ramp: approximated by linear segments
+        template <typename T>
+        void applyExponentialRampT(T* data, int frames, int stride, float start, float end){
+            const int segment = 32;
+            const float min_factor = 0.0001f; // -80 dB
+            float from = start < min_factor ? min_factor : start;
+            float to = end < min_factor ? min_factor : end;
+            int segments = (frames + segment - 1) / segment;
+            float ratio = powf(to / from, 1.0f / segments);
+            float seg_start = start;
+            for (int j=0; j<segments; j++){
+                int pos = j * segment;
+                int len = min(segment, frames - pos);
+                from *= ratio;
+                float seg_end = j == segments - 1 ? end : from;
+                applyGainT<T>(data + pos * stride, len, stride, seg_start, seg_end);
+                seg_start = seg_end;
             }
         }
 
-        void applyVolume32(int32_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                #if PREFER_FIXEDPOINT
-                int64_t result = (static_cast<int64_t>(data[j]) * static_cast<int64_t>(factorForChannel(j%info.channels))) >> 6;
-                #else
-                float result = factorForChannel(j%info.channels) * data[j];
-                #endif
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int32_t>(result);
+        /// Applies a linear gain ramp: clipping is only needed if we boost
+        template <typename T>
+        void applyGainT(T* data, int frames, int stride, float start, float end){
+            bool clip = start > 1.0f || end > 1.0f;
+            #if PREFER_FIXEDPOINT
+            // 32 bit samples without boost: the gain fits into Q31
+            if (sizeof(T) == 4 && !clip){
+                int64_t start_q31 = static_cast<int64_t>(start * 2147483648.0f);
+                int64_t end_q31 = static_cast<int64_t>(end * 2147483648.0f);
+                applyGainFixedT<T, int64_t, 31, false>(data, frames, stride, start_q31, end_q31);
+                return;
+            }
+            int64_t start_q15 = static_cast<int64_t>(start * 32768.0f);
+            int64_t end_q15 = static_cast<int64_t>(end * 32768.0f);
+            // 16 bit samples with a gain < 2.0 can be calculated in 32 bits
+            if (sizeof(T) == 2 && start_q15 <= 0xFFFF && end_q15 <= 0xFFFF){
+                if (clip) applyGainFixedT<T, int32_t, 15, true>(data, frames, stride, start_q15, end_q15);
+                else applyGainFixedT<T, int32_t, 15, false>(data, frames, stride, start_q15, end_q15);
+            } else {
+                if (clip) applyGainFixedT<T, int64_t, 15, true>(data, frames, stride, start_q15, end_q15);
+                else applyGainFixedT<T, int64_t, 15, false>(data, frames, stride, start_q15, end_q15);
             }
+            #else
+            if (clip) applyGainFloatT<T, true>(data, frames, stride, start, end);
+            else applyGainFloatT<T, false>(data, frames, stride, start, end);
+            #endif
+        }
+
+        /// Fixed point kernel: the gain has FRAC fractional bits, the ramp uses 12
+        /// additional fractional bits. The gain is never negative, so the ramp is
+        /// scaled with a multiplication and only non negative values are shifted.
+        template <typename T, typename TProduct, int FRAC, bool CLIP>
+        void applyGainFixedT(T* data, int frames, int stride, int64_t start, int64_t end){
+            const TProduct round = static_cast<TProduct>(1) << (FRAC - 1);
+            if (start == end) {
+                const TProduct gain = start;
+                for (int j=0; j<frames; j++){
+                    TProduct result = (static_cast<TProduct>(static_cast<int32_t>(data[j*stride])) * gain + round) >> FRAC;
+                    data[j*stride] = toSampleT<T, CLIP>(result);
+                }
+                return;
+            }
+            int64_t acc = start * 4096;
+            const int64_t inc = (end - start) * 4096 / frames;
+            for (int j=0; j<frames; j++){
+                const TProduct gain = static_cast<TProduct>(acc >> 12);
+                acc += inc;
+                TProduct result = (static_cast<TProduct>(static_cast<int32_t>(data[j*stride])) * gain + round) >> FRAC;
+                data[j*stride] = toSampleT<T, CLIP>(result);
+            }
+        }
+
+        /// Floating point kernel: 32 bit results are always clamped because
+        /// 2147483647 is rounded up to 2^31 as float
+        template <typename T, bool CLIP>
+        void applyGainFloatT(T* data, int frames, int stride, float start, float end){
+            const float inc = (end - start) / frames;
+            for (int j=0; j<frames; j++){
+                float result = (start + inc * j) * static_cast<int32_t>(data[j*stride]);
+                data[j*stride] = toSampleT<T, CLIP || sizeof(T) == 4>(static_cast<int64_t>(result));
+            }
+        }
+
+        /// Converts the result to the sample type: clipping is done in the integer domain
+        template <typename T, bool CLIP>
+        T toSampleT(int64_t value){
+            if (CLIP) value = value > max_value ? max_value : (value < -max_value ? -max_value : value);
+            return static_cast<T>(static_cast<int32_t>(value));
         }
 };
 
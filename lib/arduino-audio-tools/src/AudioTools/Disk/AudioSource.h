@@ -61,6 +61,18 @@ class AudioSource {
   /// Returns default setting go to the next
   virtual bool isAutoNext() { return true; }
 
+  /// Returns true if the stream has been read completely: this is only
+  /// reliable for file based sources, for all others we rely on the timeout
+  virtual bool isEndOfStream(Stream& stream) { return false; }
+
+  /// Moves the actual stream to the indicated byte position: this is only
+  /// supported by file based sources
+  virtual bool seek(size_t pos) { return false; }
+
+  /// Provides the byte position of the actual stream: this is only
+  /// supported by file based sources
+  virtual size_t position() { return 0; }
+
   /// access with array syntax
   Stream* operator[](int idx) { return setIndex(idx); }
 
@@ -3,15 +3,28 @@
 #include "AudioLogger.h"
 #include "AudioTools/Disk/AudioSource.h"
 #include "AudioTools/AudioLibs/Desktop/File.h"
+#include "AudioTools/AudioLibs/Desktop/MappedFileStream.h"
 #include "AudioTools/CoreAudio/AudioBasic/StrView.h"
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace audio_tools {
 
 namespace fs = std::filesystem;
 
 /**
- * @brief AudioSource using the standard C++ api
+ * @brief AudioSource using the standard C++ api. The audio files are
+ * collected once into a sorted in memory index. The index is refreshed
+ * incrementally: we only re-read the directories with a changed modification
+ * time and we check at most every refreshInterval ms. Optionally the index can
+ * be stored in a file, so that the next start only needs to compare the
+ * directory times. With setMemoryMapped(true) the files are provided as
+ * MappedFileStream.
  * @ingroup player
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -28,6 +41,9 @@ public:
   virtual void begin() override {
     TRACED();
     idx_pos = 0;
+    if (!is_loaded && index_file != nullptr) loadIndex();
+    is_loaded = true;
+    refresh();
   }
 
   virtual void end() {
@@ -41,24 +57,32 @@ public:
   virtual Stream *selectStream(int index) override {
     LOGI("selectStream: %d", index);
     idx_pos = index;
-    file_name = get(index);
-    if (file_name==nullptr) return nullptr;
+    const char* name = get(index);
+    if (name==nullptr) return nullptr;
+    // the index might be rebuilt, so we keep a copy
+    current_name = name;
+    file_name = current_name.c_str();
     LOGI("Using file %s", file_name);
-    file = SD.open(file_name);
-    return file ? &file : nullptr;
+    return openStream(file_name);
   }
 
   virtual Stream *selectStream(const char *path) override {
-    file.close();
-    file = SD.open(path);
-    file_name = file.name();
     LOGI("-> selectStream: %s", path);
-    return file ? &file : nullptr;
+    current_name = path;
+    file_name = current_name.c_str();
+    return openStream(file_name);
   }
 
+  /// Provides the files as memory mapped MappedFileStream (default false)
+  void setMemoryMapped(bool flag) { is_mapped = flag; }
+
   /// Defines the regex filter criteria for selecting files. E.g. ".*Bob
   /// Dylan.*"
-  void setFileFilter(const char *filter) { file_name_pattern = filter; }
+  void setFileFilter(const char *filter) {
+    file_name_pattern = filter;
+    dirs.clear();
+    is_dirty = true;
+  }
 
   /// Provides the current index position
   int index() { return idx_pos; }
@@ -69,48 +93,232 @@ public:
   // provides default setting go to the next
   virtual bool isAutoNext() { return true; }
 
+  /// Files are at the end when there is no more data available
+  bool isEndOfStream(Stream &stream) override {
+    return stream.available() == 0;
+  }
+
+  /// Moves the actual file to the indicated position
+  bool seek(size_t pos) override {
+    if (is_mapped) return mapped_file.seek(pos);
+    return file && file.seek(pos);
+  }
+
+  /// Provides the position in the actual file
+  size_t position() override {
+    if (is_mapped) return mapped_file.position();
+    return file ? file.position() : 0;
+  }
+
   /// Allows to "correct" the start path if not defined in the constructor
-  virtual void setPath(const char *p) { start_path = p; }
-
-  /// Provides the number of files (The max index is size()-1): WARNING this is very slow if you have a lot of files in many subdirectories
-  long size() { 
-    long count = 0;
-    for (auto const& dir_entry : fs::recursive_directory_iterator(start_path)){
-        if (isValidAudioFile(dir_entry))
-          count++;
+  virtual void setPath(const char *p) {
+    start_path = p;
+    dirs.clear();
+    is_dirty = true;
+  }
+
+  /// Provides the number of files (The max index is size()-1)
+  long size() {
+    refreshIfDue();
+    return offsets.size();
+  }
+
+  /// Defines the minimum time in ms between two checks for changed
+  /// directories: 0 checks on each access
+  void setRefreshInterval(uint32_t ms) { refresh_interval_ms = ms; }
+
+  /// Defines a file which is used to persist the index
+  void setIndexFile(const char *path) { index_file = path; }
+
+  /// Updates the index by re-reading all directories which have been modified:
+  /// returns true if the index has changed
+  bool refresh() {
+    if (start_path == nullptr) return false;
+    last_refresh_ms = millis();
+    std::map<std::string, DirInfo> visited;
+    bool changed = false;
+    scanDir(fs::path(start_path), visited, changed);
+    // removed directories
+    if (visited.size() != dirs.size()) changed = true;
+    dirs.swap(visited);
+    if (changed && index_file != nullptr) saveIndex();
+    if (changed || is_dirty) {
+      rebuildIndex();
+      LOGI("Index with %d files", (int)offsets.size());
     }
-    return count;
+    is_dirty = false;
+    return changed;
   }
 
 protected:
+  /// Cached content of a directory
+  struct DirInfo {
+    int64_t mtime = 0;
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+  };
   File file;
+  MappedFileStream mapped_file;
+  bool is_mapped = false;
+  std::string current_name;
+  // sorted file names in one contiguous arena separated by 0
+  std::string names;
+  std::vector<uint32_t> offsets;
+  std::map<std::string, DirInfo> dirs;
+  const char *index_file = nullptr;
+  uint32_t refresh_interval_ms = 10000;
+  uint32_t last_refresh_ms = 0;
+  bool is_dirty = true;
+  bool is_loaded = false;
   size_t idx_pos = 0;
-  const char *file_name;
+  const char *file_name = nullptr;
   const char *exension = "";
   const char *start_path = nullptr;
   const char *file_name_pattern = "*";
-  fs::directory_entry entry;
+
+  Stream *openStream(const char *path) {
+    if (is_mapped) {
+      file.close();
+      return mapped_file.begin(path) ? &mapped_file : nullptr;
+    }
+    mapped_file.end();
+    file.close();
+    file = SD.open(path);
+    return file ? &file : nullptr;
+  }
 
   const char* get(int idx){
-      int count = 0;
-      const char* result = nullptr;
-      for (auto const& dir_entry : fs::recursive_directory_iterator(start_path)){
-        if (isValidAudioFile(dir_entry)){
-          if (count++==idx){
-            entry = dir_entry;
-            result = entry.path().c_str();
-            break;
-          }
+    refreshIfDue();
+    if (idx < 0 || idx >= (int)offsets.size()) return nullptr;
+    return names.c_str() + offsets[idx];
+  }
+
+  void refreshIfDue() {
+    if (is_dirty || millis() - last_refresh_ms >= refresh_interval_ms) {
+      refresh();
+    }
+  }
+
+  bool modificationTime(const fs::path &path, int64_t &mtime) {
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    mtime = (int64_t)time.time_since_epoch().count();
+    return !ec;
+  }
+
+  /// Reads the directory only if it has been modified and processes the
+  /// subdirectories
+  void scanDir(const fs::path &path, std::map<std::string, DirInfo> &visited,
+               bool &changed) {
+    std::string key = path.string();
+    int64_t mtime;
+    if (!modificationTime(path, mtime)) return;
+    auto it = dirs.find(key);
+    DirInfo &info = visited[key];
+    if (it != dirs.end() && it->second.mtime == mtime) {
+      info = std::move(it->second);
+    } else {
+      LOGD("Reading directory %s", key.c_str());
+      changed = true;
+      info.mtime = mtime;
+      std::error_code ec;
+      for (auto const &dir_entry : fs::directory_iterator(path, ec)) {
+        std::string name = dir_entry.path().filename().string();
+        if (dir_entry.is_directory(ec)) {
+          if (!StrView(name.c_str()).startsWith(".")) info.subdirs.push_back(name);
+        } else if (isValidAudioFile(dir_entry)) {
+          info.files.push_back(name);
+        }
+      }
+    }
+    // copy, because visited might be updated by the recursion
+    std::vector<std::string> subdirs = info.subdirs;
+    for (auto &subdir : subdirs) {
+      scanDir(path / subdir, visited, changed);
+    }
+  }
+
+  /// Collects all files into the sorted name arena
+  void rebuildIndex() {
+    std::vector<std::string> all;
+    for (auto &dir : dirs) {
+      for (auto &name : dir.second.files) {
+        all.push_back((fs::path(dir.first) / name).string());
+      }
+    }
+    std::sort(all.begin(), all.end());
+    names.clear();
+    offsets.clear();
+    offsets.reserve(all.size());
+    for (auto &name : all) {
+      offsets.push_back(names.size());
+      names.append(name);
+      names.push_back(0);
+    }
+  }
+
+  /// Index file key which identifies the selection criteria
+  std::string indexKey() {
+    return std::string(start_path) + "|" + exension + "|" + file_name_pattern;
+  }
+
+  /// Writes the directory cache: 'D mtime path' followed by the 'F file' and
+  /// 'S subdirectory' lines
+  void saveIndex() {
+    std::ofstream out(index_file);
+    if (!out) {
+      LOGE("Could not write %s", index_file);
+      return;
+    }
+    out << "#AudioSourceSTD 1 " << indexKey() << "\n";
+    for (auto &dir : dirs) {
+      out << "D " << dir.second.mtime << " " << dir.first << "\n";
+      for (auto &name : dir.second.files) out << "F " << name << "\n";
+      for (auto &name : dir.second.subdirs) out << "S " << name << "\n";
+    }
+  }
+
+  /// Restores the directory cache: the content is validated by refresh()
+  bool loadIndex() {
+    std::ifstream in(index_file);
+    std::string line;
+    if (!in || !std::getline(in, line) ||
+        line != "#AudioSourceSTD 1 " + indexKey()) {
+      LOGI("No valid index file: %s", index_file);
+      return false;
+    }
+    dirs.clear();
+    DirInfo *p_info = nullptr;
+    while (std::getline(in, line)) {
+      if (line.size() < 2) continue;
+      if (line[0] == 'D') {
+        // a corrupted entry invalidates the index: we rescan everything
+        size_t pos = line.find(' ', 2);
+        const char *start = line.c_str() + 2;
+        char *end = nullptr;
+        long long mtime = strtoll(start, &end, 10);
+        if (pos == std::string::npos || end == start ||
+            end != line.c_str() + pos) {
+          LOGW("Invalid index file: %s", index_file);
+          dirs.clear();
+          return false;
         }
+        p_info = &dirs[line.substr(pos + 1)];
+        p_info->mtime = mtime;
+      } else if (p_info != nullptr && line[0] == 'F') {
+        p_info->files.push_back(line.substr(2));
+      } else if (p_info != nullptr && line[0] == 'S') {
+        p_info->subdirs.push_back(line.substr(2));
       }
-      return result;
+    }
+    LOGI("Loaded index for %d directories", (int)dirs.size());
+    return true;
   }
 
   /// checks if the file is a valid audio file
   bool isValidAudioFile(fs::directory_entry file) {
-    const std::filesystem::path& path = file.path();
-
-    const char *file_name = path.filename().c_str();
+    std::string name = file.path().filename().string();
+    const char *file_name = name.c_str();
     if (file.is_directory()) {
       LOGD("-> isValidAudioFile: '%s': %d", file_name, false);
       return false;
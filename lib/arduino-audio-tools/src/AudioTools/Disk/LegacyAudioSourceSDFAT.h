@@ -131,6 +131,21 @@ public:
         return true;
     };
 
+    /// Files are at the end when there is no more data available
+    bool isEndOfStream(Stream &stream) override {
+        return stream.available() == 0;
+    }
+
+    /// Moves the actual file to the indicated position
+    bool seek(size_t pos) override {
+        return file && file.seek(pos);
+    }
+
+    /// Provides the position in the actual file
+    size_t position() override {
+        return file ? file.position() : 0;
+    }
+
     /// Allows to "correct" the start path if not defined in the constructor
     virtual void setPath(const char* p) {
         start_path = p;
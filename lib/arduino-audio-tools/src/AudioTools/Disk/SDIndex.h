@@ -12,9 +12,37 @@
 
 namespace audio_tools {
 
+/**
+ * @brief Header of the binary offset table of the SDIndex
+ */
+struct SDIndexHeader {
+  char magic[4] = {'S', 'I', 'D', 'X'};
+  uint16_t version = 1;
+  uint16_t record_size = 8;
+  /// number of entries
+  uint32_t count = 0;
+  /// checksum of the index definition (directory, extension, pattern)
+  uint32_t checksum = 0;
+  /// size of the name index file which was used to build the table
+  uint32_t index_size = 0;
+};
+
+/**
+ * @brief Fixed size record of the binary offset table of the SDIndex
+ */
+struct SDIndexRecord {
+  /// position of the name in the name index file
+  uint32_t offset = 0;
+  /// length of the name w/o line end
+  uint16_t len = 0;
+  uint16_t reserved = 0;
+};
+
 /**
  * @brief We store all the relevant file names in an sequential index
- * file. Form there we can access them via an index
+ * file. Form there we can access them via an index. In addition we maintain
+ * a binary table with the offset of each entry, so that a lookup only needs
+ * a seek and a read.
  */
 template <class SDT, class FileT>
 class SDIndex {
@@ -28,11 +56,13 @@ class SDIndex {
     this->file_name_pattern = file_name_pattern;
     idx_path = filePathString(startDir, "idx.txt");
     idx_defpath = filePathString(startDir, "idx-def.txt");
+    idx_tabpath = filePathString(startDir, "idx.bin");
     int idx_file_size = indexFileTSize();
     LOGI("Index file size: %d", idx_file_size);
     String keyNew =
         String(startDir) + "|" + extension + "|" + file_name_pattern;
     String keyOld = getIndexDef();
+    bool is_new_index = false;
     if (setupIndex && (keyNew != keyOld || idx_file_size == 0)) {
       FileT idxfile = p_sd->open(idx_path.c_str(), FILE_WRITE);
       LOGW("Creating index file");
@@ -41,6 +71,15 @@ class SDIndex {
       idxfile.close();
       // update index definition file
       saveIndexDef(keyNew);
+      is_new_index = true;
+    }
+    // setup the offset table
+    max_idx = -1;
+    uint32_t checksum = checksumOf(keyNew);
+    if (is_new_index || !loadOffsetTable(checksum)) {
+      if (!saveOffsetTable(checksum)) {
+        LOGW("No offset table: using sequential lookup");
+      }
     }
   }
 
@@ -56,6 +95,7 @@ class SDIndex {
 
   /// Access file name by index
   const char *operator[](int idx) {
+    if (is_table_valid) return lookup(idx);
     // return null when inx too big
     if (max_idx >= 0 && idx > max_idx) {
       LOGE("idx %d > size %d", idx, max_idx);
@@ -71,17 +111,9 @@ class SDIndex {
 
     bool found = false;
     while (idxfile.available() > 0 && !found) {
-      result = idxfile.readStringUntil('\n');
-
-      // result c-string
-      char *c_str = (char *)result.c_str();
-      // remove potential cr character - hax to avoid any allocations
-      int lastPos = result.length() - 1;
-      if (c_str[lastPos] == 13) {
-        c_str[lastPos] = 0;
-      }
-
-      LOGD("%d -> %s", count, c_str);
+      // empty lines are ignored like in scanIndexFile()
+      if (readLine(idxfile) == 0) continue;
+      LOGD("%d -> %s", count, entry);
       if (count == idx) {
         found = true;
       }
@@ -92,19 +124,17 @@ class SDIndex {
     }
     idxfile.close();
 
-    return found ? result.c_str() : nullptr;
+    return found ? entry : nullptr;
   }
 
   long size() {
+    if (is_table_valid) return table_count;
     if (max_idx == -1) {
       FileT idxfile = p_sd->open(idx_path.c_str());
       int count = 0;
 
       while (idxfile.available() > 0) {
-        result = idxfile.readStringUntil('\n');
-        // result c-string
-        char *c_str = (char *)result.c_str();
-        count++;
+        if (readLine(idxfile) > 0) count++;
       }
       idxfile.close();
       max_idx = count;
@@ -113,9 +143,12 @@ class SDIndex {
   }
 
  protected:
-  String result;
   String idx_path;
   String idx_defpath;
+  String idx_tabpath;
+  char entry[MAX_FILE_LEN];
+  bool is_table_valid = false;
+  long table_count = 0;
   SDT *p_sd = nullptr;
   List<String> file_path_stack;
   String file_path_str;
@@ -125,6 +158,141 @@ class SDIndex {
   const char *file_name_pattern = nullptr;
   long max_idx = -1;
 
+  /// Reads the next line into the entry w/o allocating any memory: longer
+  /// lines are truncated and the rest of the line is skipped. Returns the
+  /// length of the entry.
+  int readLine(FileT &idxfile) {
+    int n = idxfile.readBytesUntil('\n', entry, MAX_FILE_LEN - 1);
+    if (n == MAX_FILE_LEN - 1) {
+      while (idxfile.available() > 0 && idxfile.read() != '\n');
+    }
+    // remove potential cr character
+    if (n > 0 && entry[n - 1] == '\r') n--;
+    entry[n] = 0;
+    return n;
+  }
+
+  /// Determines the entry with the help of the offset table
+  const char *lookup(int idx) {
+    if (idx < 0 || idx >= table_count) {
+      LOGE("idx %d >= size %ld", idx, table_count);
+      return nullptr;
+    }
+    SDIndexRecord rec;
+    FileT tabfile = p_sd->open(idx_tabpath.c_str());
+    tabfile.seek(sizeof(SDIndexHeader) + (uint32_t)idx * sizeof(SDIndexRecord));
+    size_t len = tabfile.readBytes((char *)&rec, sizeof(rec));
+    tabfile.close();
+    if (len != sizeof(rec)) {
+      LOGE("Offset table read error: %d", idx);
+      return nullptr;
+    }
+    FileT idxfile = p_sd->open(idx_path.c_str());
+    idxfile.seek(rec.offset);
+    int n = rec.len < MAX_FILE_LEN ? rec.len : MAX_FILE_LEN - 1;
+    n = idxfile.readBytes(entry, n);
+    idxfile.close();
+    entry[n] = 0;
+    LOGD("%d -> %s", idx, entry);
+    return entry;
+  }
+
+  /// Reads the header of the offset table and checks if it is still valid
+  bool loadOffsetTable(uint32_t checksum) {
+    is_table_valid = false;
+    SDIndexHeader expected;
+    SDIndexHeader hdr;
+    FileT tabfile = p_sd->open(idx_tabpath.c_str());
+    size_t len = tabfile.readBytes((char *)&hdr, sizeof(hdr));
+    size_t tab_size = tabfile.size();
+    tabfile.close();
+    if (len != sizeof(hdr) || memcmp(hdr.magic, expected.magic, 4) != 0 ||
+        hdr.version != expected.version ||
+        hdr.record_size != sizeof(SDIndexRecord) ||
+        hdr.checksum != checksum || hdr.index_size != indexFileTSize() ||
+        tab_size != sizeof(hdr) + hdr.count * sizeof(SDIndexRecord)) {
+      LOGI("Offset table is not valid");
+      return false;
+    }
+    table_count = hdr.count;
+    is_table_valid = true;
+    LOGI("Offset table with %ld entries", table_count);
+    return true;
+  }
+
+  /// Builds the offset table from the name index file
+  bool saveOffsetTable(uint32_t checksum) {
+    is_table_valid = false;
+    SDIndexHeader hdr;
+    hdr.checksum = checksum;
+    hdr.index_size = indexFileTSize();
+    hdr.count = scanIndexFile(nullptr);
+    p_sd->remove(idx_tabpath.c_str());
+    FileT tabfile = p_sd->open(idx_tabpath.c_str(), FILE_WRITE);
+    if (!tabfile) return false;
+    bool ok = tabfile.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+    ok = ok && scanIndexFile(&tabfile) == hdr.count;
+    tabfile.close();
+    if (!ok) {
+      LOGE("Offset table write error");
+      return false;
+    }
+    table_count = hdr.count;
+    is_table_valid = true;
+    LOGI("Offset table created with %ld entries", table_count);
+    return true;
+  }
+
+  /// Determines the offset of each line: if a file is provided we write the
+  /// records to it. Empty lines are skipped. Returns the number of entries.
+  uint32_t scanIndexFile(FileT *p_tabfile) {
+    FileT idxfile = p_sd->open(idx_path.c_str());
+    uint8_t buffer[64];
+    uint32_t count = 0;
+    uint32_t pos = 0;
+    uint32_t line_start = 0;
+    uint8_t last = 0;
+    size_t len;
+    while ((len = idxfile.readBytes((char *)buffer, sizeof(buffer))) > 0) {
+      for (size_t j = 0; j < len; j++, pos++) {
+        if (buffer[j] == '\n') {
+          uint32_t end = last == '\r' ? pos - 1 : pos;
+          if (end > line_start) {
+            addRecord(p_tabfile, line_start, end - line_start);
+            count++;
+          }
+          line_start = pos + 1;
+        }
+        last = buffer[j];
+      }
+    }
+    // last line w/o line end
+    if (pos > line_start) {
+      addRecord(p_tabfile, line_start, pos - line_start);
+      count++;
+    }
+    idxfile.close();
+    return count;
+  }
+
+  void addRecord(FileT *p_tabfile, uint32_t offset, uint32_t len) {
+    if (p_tabfile == nullptr) return;
+    SDIndexRecord rec;
+    rec.offset = offset;
+    rec.len = len;
+    p_tabfile->write((const uint8_t *)&rec, sizeof(rec));
+  }
+
+  /// FNV-1a hash
+  uint32_t checksumOf(String &str) {
+    uint32_t hash = 2166136261u;
+    const char *c_str = str.c_str();
+    for (int j = 0; j < str.length(); j++) {
+      hash = (hash ^ (uint8_t)c_str[j]) * 16777619u;
+    }
+    return hash;
+  }
+
   String filePathString(const char *name, const char *suffix) {
     String result = name;
     return result.endsWith("/") ? result + suffix : result + "/" + suffix;
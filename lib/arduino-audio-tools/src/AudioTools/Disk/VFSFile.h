@@ -133,6 +133,8 @@ class VFSFile : public Stream {
   virtual int peek() override { return stream.peek(); }
 
   bool seek(uint32_t pos, SeekMode mode) {
+    // reset the eof state
+    stream.clear();
     if (is_read) {
       switch (mode) {
         case SeekSet:
@@ -16,6 +16,7 @@
 #  include "AudioTools/AudioLibs/Desktop/Time.h"
 #  include "AudioTools/AudioLibs/Desktop/Main.h"
 #  define USE_STREAM_READ_OVERRIDE
+#  define USE_STD_CONCURRENCY
 #  define USE_SD_NO_NS
 #  ifndef EXIT_ON_STOP
 #    define EXIT_ON_STOP
@@ -34,6 +35,7 @@
 #  define USE_SD_NO_NS
 #  define USE_WIFI
 #  define USE_URL_ARDUINO
+#  define USE_STD_CONCURRENCY
 #  define USE_STREAM_WRITE_OVERRIDE
 #  define USE_STREAM_READ_OVERRIDE
 #  define USE_STREAM_READCHAR_OVERRIDE